@@ -5,6 +5,12 @@
 ; ---------------
 ; v1.01 25/1/18 Added Select/Reset as alternative to joysitck for menu navigation
 ; v1.02 28/3/18 Adds read to $1FF4 on init, to unlock the comms area on the cartridge
+; v1.03 18/10/26 Shows the first items of a folder while the cart is still reading the rest
+; v1.04 18/10/26 Fetches items from the cart a window at a time, so folders can be any size
+; v1.05 18/10/26 Shows a progress bar under the SD logo while a rom is loading
+; v1.06 18/10/26 Draws lines the cart has already rendered into font bytes
+; v1.07 18/10/26 With the left difficulty switch on A, left/right jump between first letters
+; v1.08 18/10/26 Starts a listing on the item the cart asks for, so going back keeps the place
 
 ; @com.wudsn.ide.asm.hardware=ATARI2600
 	icl "vcs.asm"
@@ -56,17 +62,32 @@ MENU_SEL_BK_COL =	$52
 ;------------------------------------------------------------------
 ; atari->cart comms addresses
 ;------------------------------------------------------------------
+CART_CMD_WINDOW_n = 	$1D00	// out
 CART_CMD_SEL_ITEM_n = 	$1E00	// out
+CART_CMD_NEXT_LETTER_n = $1E40	// out, from item n to the next first letter
+CART_CMD_PREV_LETTER_n = $1E80	// out, from item n to the previous first letter
 CART_CMD_ROOT_DIR = 	$1EF0	// out
+CART_CMD_DIR_MORE = 	$1EF1	// out
+CART_CMD_BENCHMARK = 	$1EF2	// out, reset and select together
 CART_CMD_START_CART = 	$1EFF	// out
-
-WaitCart = $84 ; routine to run from 2600 RAM while cart busy copied here
+CART_GLYPH_LINE_n =	$1480	// out, selects the line served at CART_GLYPH_WINDOW
+CART_GLYPH_WINDOW =	$1500	// in, 12 characters of 8 font bytes
+GLYPH_LINE_TITLE =	WINDOW_ITEMS	; lines after the window's items
+GLYPH_LINE_STATUS =	WINDOW_ITEMS+1
+GLYPH_LINE_BLANK =	WINDOW_ITEMS+2
+
+WaitCart = $82 ; routine to run from 2600 RAM while cart busy copied here
+CartCmd = $C0 ; routine to run from 2600 RAM to send a cmd during the overscan
+STATUS_DIR_GROWING = $01 ; StatusByteFlags: cart is still reading the folder
+STATUS_MORE_WINDOWS = $02 ; StatusByteFlags: there are items after this window
+WINDOW_ITEMS = 63 ; items the cart serves at a time, a multiple of ITEMS_PER_SCREEN
 ITEMS_PER_SCREEN = 9
 ;------------------------------------------------------------------
-; non-volatile memory $80-$83
+; non-volatile memory $80-$81
 ;------------------------------------------------------------------
 	org $80
 CurItem		.ds 1; current item selected in the menu
+WindowNum	.ds 1; window of items the cart is serving
 ;------------------------------------------------------------------
 ; volatile memory ($88+) overwritten by RAM routine        
 ;------------------------------------------------------------------
@@ -93,6 +114,8 @@ TopItem		.ds 1	; item # at the top of the page
 RowItem		.ds 1	; item # we are drawing
 RowCount	.ds 1	; 0 ->  ITEMS_PER_SCREEN-1
 StickDelayCount	.ds 1
+LoadWindow	.ds 1	; WindowNum has changed, fetch it in the overscan
+JumpCmd		.ds 1	; letter jump to send in the overscan, low byte of the cmd
 ;------------------------------------------------------------------
 ; Cartridge ROM
 ;------------------------------------------------------------------
@@ -133,12 +156,20 @@ loop	jsr InitMenu
 ; Menu
 ;------------------------------------------------------------------
 	.proc InitMenu
+	; start where the cart says, e.g. on the folder we just went back from
+	lda StatusByteJumpWindow
+	sta WindowNum
+	lda StatusByteJumpItem
+	sta CurItem
 	lda #0
 	sta StickDelayCount
-	sta CurItem
+	sta LoadWindow
+	sta JumpCmd
 	sta TopItem
 	sta ItemCount
 	
+	jsr PrepareCartCmdRoutine
+	
 	; count items
 	mwa #ItemsList ItemTextPtr
         ldy #0
@@ -154,75 +185,6 @@ NextItem
 DoneItems
 	rts
 	.endp
-;------------------------------------------------------------------
-	.proc ReadControls
-	lda StickDelayCount
-	beq _0
-	dec StickDelayCount
-	rts
-_0
-	; check down
-	lda #$20
-	and swcha
-	beq _0X
-	; check select
-	lda #$02
-	and swchb
-	beq _0X
-	jmp _1
-_0X	; down/select pressed
-	ldx CurItem
-	inx
-	cpx ItemCount
-	beq _1
-	inc CurItem
-	lda #10
-	sta StickDelayCount
-	
-_1	; check up
-	lda #$10
-	and swcha
-	bne _2
-	; up pressed
-	ldx CurItem
-	beq _2
-	dec CurItem
-	lda #10
-	sta StickDelayCount
-
-_2	; check left
-	lda #$40
-	and swcha
-	bne _3
-	; left pressed
-	lda CurItem
-	cmp #ITEMS_PER_SCREEN
-	bcc _3
-	sec
-	sbc #ITEMS_PER_SCREEN
-	sta CurItem
-	lda #10
-	sta StickDelayCount
-	
-_3	; check right
-	lda #$80
-	and swcha
-	bne _4
-	; right pressed
-	lda CurItem
-	clc
-	adc #ITEMS_PER_SCREEN
-	cmp ItemCount
-	bcc _3a
-	ldy ItemCount
-	dey
-	tya
-_3a	sta CurItem
-	lda #10
-	sta StickDelayCount
-_4
-	rts
-	.endp
 ;------------------------------------------------------------------
 	.proc Menu       
         
@@ -265,6 +227,7 @@ NextFrame
 	lda #$25
 	ldx #1
 	jsr PositionASpriteSubroutine
+	jsr SetGlyphPointersSubroutine
 	
 ; from the current item, set topItem and the item text pointer
 	mwa #ItemsList ItemTextPtr
@@ -298,10 +261,9 @@ DoneTopItem
 	TIMER_SETUP 192+15
 	
 ; menu heading
-	mwa #MenuTitle TextBlockPointer
-	lda #0
-       	sta TextLineCounter        
-  	jsr SetTextPointersSubroutine
+	lda CART_GLYPH_LINE_n+GLYPH_LINE_TITLE
+	ldx #8
+	jsr SkipLinesSubroutine
 	lda #TITLE_COL
 	sta COLUP0
 	sta COLUP1
@@ -329,7 +291,10 @@ NextItem
 	bcs DrawBlankItem
 DrawItem	
 	mwa ItemTextPtr TextBlockPointer
-  	jsr SetTextPointersSubroutine
+	ldx RowItem
+	lda CART_GLYPH_LINE_n,x
+	ldx #8
+	jsr SkipLinesSubroutine
   	sta wsync
 ; check if we are drawing the current selection	
   	lda RowItem
@@ -367,10 +332,9 @@ OutputLine
 	jmp EndDrawItem
 	
 DrawBlankItem
-	mwa #BlankLine TextBlockPointer
-	lda #0
-       	sta TextLineCounter        
-  	jsr SetTextPointersSubroutine
+	lda CART_GLYPH_LINE_n+GLYPH_LINE_BLANK
+	ldx #8
+	jsr SkipLinesSubroutine
   	lda #MENU_BK_COL
 	sta wsync
 	sta COLUBK	
@@ -402,10 +366,9 @@ DoneItems
 	TIMER_SETUP 50-15
 
 ; menu footer
-	mwa #StatusBytes TextBlockPointer
-	lda #0
-       	sta TextLineCounter        
-  	jsr SetTextPointersSubroutine
+	lda CART_GLYPH_LINE_n+GLYPH_LINE_STATUS
+	ldx #8
+	jsr SkipLinesSubroutine
 	lda #STATUS_COL
 	sta COLUP0
 	sta COLUP1
@@ -424,6 +387,43 @@ DoneItems
 	sta vblank
 	sta wsync
 	TIMER_SETUP 30
+; jump to a letter, fetch a new window of items, or let the cart add items to a folder
+; it is still reading
+	lda JumpCmd
+	beq NoJump
+	sta CartCmd+1
+	lda #>CART_CMD_NEXT_LETTER_n
+	sta CartCmd+2
+	jsr CartCmd
+	lda StatusByteJumpWindow
+	sta WindowNum
+	lda StatusByteJumpItem
+	sta CurItem
+	lda #0
+	sta JumpCmd
+	beq CmdDone
+NoJump
+	lda LoadWindow
+	beq NoLoad
+	lda WindowNum
+	sta CartCmd+1
+	lda #>CART_CMD_WINDOW_n
+	bne SendCmd
+NoLoad
+	lda StatusByteFlags
+	and #STATUS_DIR_GROWING
+	beq NoCmd
+	lda #<CART_CMD_DIR_MORE
+	sta CartCmd+1
+	lda #>CART_CMD_DIR_MORE
+SendCmd
+	sta CartCmd+2
+	jsr CartCmd
+CmdDone
+	lda #0
+	sta LoadWindow
+	jsr GetItemCount
+NoCmd
         TIMER_WAIT
         sta wsync
         
@@ -431,12 +431,18 @@ DoneItems
 	bit inpt4
 	bmi NotFire
 	jmp FirePressed
-; check reset
-NotFire	lda #$01
+; check reset, and reset with select for the card benchmark
+NotFire	lda #$03
 	and swchb
+	beq Benchmark
+	and #$01
 	beq FirePressed
 NoSelection
 	jmp NextFrame
+Benchmark
+	lda #<CART_CMD_BENCHMARK
+	sta CurItem
+	rts
 FirePressed
 	lda ItemCount	; check there is an item to select
 	beq NoSelection
@@ -508,13 +514,18 @@ scan2
 	lda WaitCart + (SDLogo-WaitCartRoutine),x
 	sta pf1
 	iny
-	cpy #24	; 24 scanlines
+	cpy #32	; 24 scanlines of logo, then 8 for the progress bar
 	bcc scan2
 	
-	ldx #176 ; 176 scanlines
+	ldx #168 ; 168 scanlines
 scan3
 	sta wsync
-	dex
+; the cart answers the progress poll between sd card transfers. a bar always
+; has its leftmost pixel set, anything else is the bus floating.
+	lda StatusByteProgress
+	bpl @+
+	sta WaitCart + (SDBar-WaitCartRoutine)
+@	dex
 	bne scan3
 
 ; Enable VBLANK again
@@ -550,6 +561,7 @@ reboot
 	sta wsync
 	jmp ($fffc)
 SDLogo	.byte $EE, $89, $E9, $29, $EE, $0
+SDBar	.byte $0, $0
 	.endp
 	
 ;-------------------------------------------------------------------------
@@ -578,30 +590,26 @@ Ret
         rts             ;+6      9
 
 ;-------------------------------------------------------------------------
-SetTextPointersSubroutine
-	ldx #0
-	lda TextLineCounter ;input ascii character
-	sta Temp
-SetCharPtrsLoop
-	ldy Temp
-	lda (TextBlockPointer),y
-	and #$7F
-	tay
-	lda ASCIILookupTable,y
-        asl
-        asl
-        asl
-	sta Char1Ptr,x
-	lda #>FontData
-	sta Char1Ptr+1,x
-        bcc NoCarry
-        inc Char1Ptr+1,x
-NoCarry
-	inx
-	inx
-	inc Temp
-	cpx #24
-	bne SetCharPtrsLoop
+SetGlyphPointersSubroutine
+; the cart serves the glyphs of the selected line at CART_GLYPH_WINDOW
+	ldx #22
+	lda #<[CART_GLYPH_WINDOW+88]
+@	sta Char1Ptr,x
+	ldy #>CART_GLYPH_WINDOW
+	sty Char1Ptr+1,x
+	sec
+	sbc #8
+	dex
+	dex
+	bpl @-
+	rts
+
+;-------------------------------------------------------------------------
+; wait x scanlines, the time that looking up the glyphs of a line used to take
+SkipLinesSubroutine
+	sta wsync
+	dex
+	bne SkipLinesSubroutine
 	rts
         
 ;-------------------------------------------------------------------------
@@ -684,420 +692,55 @@ LF38C: LDA    #0
        STA    GRP1    
        STA    GRP0    
        RTS            
+
+;------------------------------------------------------------------
+	.proc PrepareCartCmdRoutine
+; copy routine to ram
+	ldy #.len[CartCmdRoutine]
+@
+	lda CartCmdRoutine-1,y
+	sta CartCmd-1,y
+	dey
+	bne @-
+	rts
+	.endp
+;------------------------------------------------------------------
+; copied to CartCmd in ram, called at the start of the overscan with
+; the cmd address stored at CartCmd+1. if the cart isn't back before
+; the timer runs out, output blank frames until it is.
+	.proc CartCmdRoutine
+	lda CART_CMD_DIR_MORE	; sent cmd to cart
+wait	lda $1000
+	cmp #$D8 ;D8 for cart
+	beq done
+	lda intim
+	bne wait
+frame	lda #2
+	sta vsync
+	sta wsync
+	sta wsync
+	sta wsync
+	lda #0
+	sta vsync
+	ldx #154 ; 2 scanlines each
+line	sta wsync
+	sta wsync
+	lda $1000
+	cmp #$D8
+	beq done
+	dex
+	bne line
+	beq frame
+done	rts
+	.endp
 	
 ;------------------------------------------------------------------
 ; Data
 ;------------------------------------------------------------------
-; convert from ascii to internal representation
-; maps characters to '_' (41) if we don't have a font glyph
- 	org $f480
-ASCIILookupTable
-	.byte 41,41,41,41,41,41,41,41
-	.byte 41,41,41,41,41,41,41,41
-	.byte 41,41,41,41,41,41,41,41
-	.byte 41,41,41,41,41,41,41,41
-	.byte 26,41,41,41,41,41,41,41
-	.byte 40,39,41,41,37,41,38,41
-	.byte 27,28,29,30,31,32,33,34
-	.byte 35,36,41,41,41,41,41,41
-	.byte 41,0,1,2,3,4,5,6
-	.byte 7,8,9,10,11,12,13,14
-	.byte 15,16,17,18,19,20,21,22
-	.byte 23,24,25,41,41,41,41,41
-	.byte 41,41,41,41,41,41,41,41
-	.byte 41,41,41,41,41,41,41,41
-	.byte 41,41,41,41,41,41,41,41
-	.byte 41,41,41,41,41,41,41,41
-	
-; 8x8 Font data.
-; Beginning must be aligned to page boundary
-       org $f500
-FontData
-
-       .byte $00 ; |        |
-       .byte $C6 ; |XX   XX |
-       .byte $C6 ; |XX   XX |
-       .byte $FE ; |XXXXXXX |
-       .byte $C6 ; |XX   XX |
-       .byte $C6 ; |XX   XX |
-       .byte $6C ; | XX XX  |
-       .byte $38 ; |  XXX   |
-
-       .byte $00 ; |        |
-       .byte $FC ; |XXXXXX  |
-       .byte $C6 ; |XX   XX |
-       .byte $C6 ; |XX   XX |
-       .byte $FC ; |XXXXXX  |
-       .byte $C6 ; |XX   XX |
-       .byte $C6 ; |XX   XX |
-       .byte $FC ; |XXXXXX  |
-
-       .byte $00 ; |        |
-       .byte $3C ; |  XXXX  |
-       .byte $66 ; | XX  XX |
-       .byte $C0 ; |XX      |
-       .byte $C0 ; |XX      |
-       .byte $C0 ; |XX      |
-       .byte $66 ; | XX  XX |
-       .byte $3C ; |  XXXX  |
-
-       .byte $00 ; |        |
-       .byte $F8 ; |XXXXX   |
-       .byte $CC ; |XX  XX  |
-       .byte $C6 ; |XX   XX |
-       .byte $C6 ; |XX   XX |
-       .byte $C6 ; |XX   XX |
-       .byte $CC ; |XX  XX  |
-       .byte $F8 ; |XXXXX   |
-
-       .byte $00 ; |        |
-       .byte $FE ; |XXXXXXX |
-       .byte $C0 ; |XX      |
-       .byte $C0 ; |XX      |
-       .byte $F8 ; |XXXXX   |
-       .byte $C0 ; |XX      |
-       .byte $C0 ; |XX      |
-       .byte $FE ; |XXXXXXX |
-
-       .byte $00 ; |        |
-       .byte $C0 ; |XX      | 
-       .byte $C0 ; |XX      |
-       .byte $C0 ; |XX      |
-       .byte $FC ; |XXXXXX  |
-       .byte $C0 ; |XX      |
-       .byte $C0 ; |XX      |
-       .byte $FE ; |XXXXXXX |
-
-       .byte $00 ; |        |
-       .byte $3E ; |  XXXXX |
-       .byte $66 ; | XX  XX |
-       .byte $C6 ; |XX   XX |
-       .byte $CE ; |XX  XXX |
-       .byte $C0 ; |XX      |
-       .byte $60 ; | XX     |
-       .byte $3E ; |  XXXXX |
-
-       .byte $00 ; |        |
-       .byte $C6 ; |XX   XX |
-       .byte $C6 ; |XX   XX |
-       .byte $C6 ; |XX   XX |
-       .byte $FE ; |XXXXXXX |
-       .byte $C6 ; |XX   XX |
-       .byte $C6 ; |XX   XX |
-       .byte $C6 ; |XX   XX |
-
-       .byte $00 ; |        |
-       .byte $78 ; | XXXX   |
-       .byte $30 ; |  XX    |
-       .byte $30 ; |  XX    |
-       .byte $30 ; |  XX    |
-       .byte $30 ; |  XX    |
-       .byte $30 ; |  XX    |
-       .byte $78 ; | XXXX   |
-
-       .byte $00 ; |        |
-       .byte $7C ; | XXXXX  |
-       .byte $C6 ; |XX   XX |
-       .byte $06 ; |     XX |
-       .byte $06 ; |     XX |
-       .byte $06 ; |     XX |
-       .byte $06 ; |     XX |
-       .byte $06 ; |     XX |
-
-       .byte $00 ; |        |
-       .byte $CE ; |XX  XXX |
-       .byte $DC ; |XX XXX  |
-       .byte $F8 ; |XXXXX   |
-       .byte $F0 ; |XXXX    |
-       .byte $D8 ; |XX XX   |
-       .byte $CC ; |XX  XX  |
-       .byte $C6 ; |XX   XX |
-
-       .byte $00 ; |        |
-       .byte $FE ; |XXXXXXX |
-       .byte $C0 ; |XX      |
-       .byte $C0 ; |XX      |
-       .byte $C0 ; |XX      |
-       .byte $C0 ; |XX      |
-       .byte $C0 ; |XX      |
-       .byte $C0 ; |XX      |
-
-       .byte $00 ; |        |
-       .byte $C6 ; |XX   XX |
-       .byte $C6 ; |XX   XX |
-       .byte $D6 ; |XX X XX |
-       .byte $FE ; |XXXXXXX |
-       .byte $FE ; |XXXXXXX |
-       .byte $EE ; |XXX XXX |
-       .byte $C6 ; |XX   XX |
-
-       .byte $00 ; |        |
-       .byte $C6 ; |XX   XX |
-       .byte $CE ; |XX  XXX |
-       .byte $DE ; |XX XXXX |
-       .byte $FE ; |XXXXXXX |
-       .byte $F6 ; |XXXX XX |
-       .byte $E6 ; |XXX  XX |
-       .byte $C6 ; |XX   XX |
-
-       .byte $00 ; |        |
-       .byte $7C ; | XXXXX  |
-       .byte $C6 ; |XX   XX |
-       .byte $C6 ; |XX   XX |
-       .byte $C6 ; |XX   XX |
-       .byte $C6 ; |XX   XX |
-       .byte $C6 ; |XX   XX |
-       .byte $7C ; | XXXXX  |
-
-       .byte $00 ; |        |
-       .byte $C0 ; |XX      |
-       .byte $C0 ; |XX      |
-       .byte $FC ; |XXXXXX  |
-       .byte $C6 ; |XX   XX |
-       .byte $C6 ; |XX   XX |
-       .byte $C6 ; |XX   XX |
-       .byte $FC ; |XXXXXX  |
-
-       .byte $00 ; |        |
-       .byte $76 ; | XXX XX |
-       .byte $CC ; |XX  XX  |
-       .byte $DA ; |XX XX X |
-       .byte $C6 ; |XX   XX |
-       .byte $C6 ; |XX   XX |
-       .byte $C6 ; |XX   XX |
-       .byte $7C ; | XXXXX  |
-
-       .byte $00 ; |        |
-       .byte $CE ; |XX  XXX |
-       .byte $DC ; |XX XXX  |
-       .byte $F8 ; |XXXXX   |
-       .byte $CE ; |XX  XXX |
-       .byte $C6 ; |XX   XX |
-       .byte $C6 ; |XX   XX |
-       .byte $FC ; |XXXXXX  |
-
-       .byte $00 ; |        |
-       .byte $7C ; | XXXXX  |
-       .byte $C6 ; |XX   XX |
-       .byte $06 ; |     XX |
-       .byte $7C ; | XXXXX  |
-       .byte $C0 ; |XX      |
-       .byte $CC ; |XX  XX  |
-       .byte $78 ; | XXXX   |
-
-       .byte $00 ; |        |
-       .byte $30 ; |  XX    |
-       .byte $30 ; |  XX    |
-       .byte $30 ; |  XX    |
-       .byte $30 ; |  XX    |
-       .byte $30 ; |  XX    |
-       .byte $30 ; |  XX    |
-       .byte $FC ; |XXXXXX  |
-
-       .byte $00 ; |        |
-       .byte $7C ; | XXXXX  |
-       .byte $C6 ; |XX   XX |
-       .byte $C6 ; |XX   XX |
-       .byte $C6 ; |XX   XX |
-       .byte $C6 ; |XX   XX |
-       .byte $C6 ; |XX   XX |
-       .byte $C6 ; |XX   XX |
-
-       .byte $00 ; |        |
-       .byte $10 ; |   X    |
-       .byte $38 ; |  XXX   |
-       .byte $7C ; | XXXXX  |
-       .byte $EE ; |XXX XXX |
-       .byte $C6 ; |XX   XX |
-       .byte $C6 ; |XX   XX |
-       .byte $C6 ; |XX   XX |
-
-       .byte $00 ; |        |
-       .byte $C6 ; |XX   XX |
-       .byte $EE ; |XXX XXX |
-       .byte $FE ; |XXXXXXX |
-       .byte $FE ; |XXXXXXX |
-       .byte $D6 ; |XX X XX |
-       .byte $C6 ; |XX   XX |
-       .byte $C6 ; |XX   XX |
-
-       .byte $00 ; |        |
-       .byte $C6 ; |XX   XX |
-       .byte $EE ; |XXX XXX |
-       .byte $7C ; | XXXXX  |
-       .byte $38 ; |  XXX   |
-       .byte $7C ; | XXXXX  |
-       .byte $EE ; |XXX XXX |
-       .byte $C6 ; |XX   XX |
-
-       .byte $00 ; |        |
-       .byte $30 ; |  XX    |
-       .byte $30 ; |  XX    |
-       .byte $30 ; |  XX    |
-       .byte $78 ; | XXXX   |
-       .byte $CC ; |XX  XX  |
-       .byte $CC ; |XX  XX  |
-       .byte $CC ; |XX  XX  |
-
-       .byte $00 ; |        |
-       .byte $FE ; |XXXXXXX |
-       .byte $E0 ; |XXX     |
-       .byte $70 ; | XXX    |
-       .byte $38 ; |  XXX   |
-       .byte $1C ; |   XXX  |
-       .byte $0E ; |    XXX |
-       .byte $FE ; |XXXXXXX |
-
-       .byte $00 ; |        |
-       .byte $00 ; |        |
-       .byte $00 ; |        |
-       .byte $00 ; |        |
-       .byte $00 ; |        |
-       .byte $00 ; |        |
-       .byte $00 ; |        |
-       .byte $00 ; |        |
-
-       .byte $00 ; |        |
-       .byte $7C ; | XXXXX  |
-       .byte $C6 ; |XX   XX |
-       .byte $E6 ; |XXX  XX |
-       .byte $D6 ; |XX X XX |
-       .byte $CE ; |XX  XXX |
-       .byte $C6 ; |XX   XX |
-       .byte $7C ; | XXXXX  |
-
-       .byte $00 ; |        |
-       .byte $FC ; |XXXXXX  |
-       .byte $30 ; |  XX    |
-       .byte $30 ; |  XX    |
-       .byte $30 ; |  XX    |
-       .byte $30 ; |  XX    |
-       .byte $70 ; | XXX    |
-       .byte $30 ; |  XX    |
-
-       .byte $00 ; |        |
-       .byte $FE ; |XXXXXXX |
-       .byte $E0 ; |XXX     |
-       .byte $78 ; | XXXX   |
-       .byte $3C ; |  XXXX  |
-       .byte $0E ; |    XXX |
-       .byte $C6 ; |XX   XX |
-       .byte $7C ; | XXXXX  |
-
-       .byte $00 ; |        |
-       .byte $7C ; | XXXXX  |
-       .byte $C6 ; |XX   XX |
-       .byte $06 ; |     XX |
-       .byte $3C ; |  XXXX  |
-       .byte $18 ; |   XX   |
-       .byte $0C ; |    XX  |
-       .byte $7E ; | XXXXXX |
-
-       .byte $00 ; |        |
-       .byte $0C ; |    XX  |
-       .byte $0C ; |    XX  |
-       .byte $FE ; |XXXXXXX |
-       .byte $CC ; |XX  XX  |
-       .byte $6C ; | XX XX  |
-       .byte $3C ; |  XXXX  |
-       .byte $1C ; |   XXX  |
-
-
-       .byte $00 ; |        |
-       .byte $7C ; | XXXXX  |
-       .byte $C6 ; |XX   XX |
-       .byte $06 ; |     XX |
-       .byte $06 ; |     XX |
-       .byte $FC ; |XXXXXX  |
-       .byte $C0 ; |XX      |
-       .byte $FC ; |XXXXXX  |
-
-       .byte $00 ; |        |
-       .byte $7C ; | XXXXX  |
-       .byte $C6 ; |XX   XX |
-       .byte $C6 ; |XX   XX |
-       .byte $FC ; |XXXXXX  |
-       .byte $C0 ; |XX      |
-       .byte $60 ; | XX     |
-       .byte $3C ; |  XXXX  |
-
-       .byte $00 ; |        |
-       .byte $30 ; |  XX    |
-       .byte $30 ; |  XX    |
-       .byte $30 ; |  XX    |
-       .byte $18 ; |   XX   |
-       .byte $0C ; |    XX  |
-       .byte $C6 ; |XX   XX |
-       .byte $FE ; |XXXXXXX |
-
-       .byte $00 ; |        |
-       .byte $7C ; | XXXXX  |
-       .byte $C6 ; |XX   XX |
-       .byte $C6 ; |XX   XX |
-       .byte $7C ; | XXXXX  |
-       .byte $C6 ; |XX   XX |
-       .byte $C6 ; |XX   XX |
-       .byte $7C ; | XXXXX  |
-
-       .byte $00 ; |        |
-       .byte $78 ; | XXXX   |
-       .byte $0C ; |    XX  |
-       .byte $06 ; |     XX |
-       .byte $7E ; | XXXXXX |
-       .byte $C6 ; |XX   XX |
-       .byte $C6 ; |XX   XX |
-       .byte $7C ; | XXXXX  |
-
-       .byte $00 ; |        |
-       .byte $60 ; | XX     |
-       .byte $30 ; |  XX    |
-       .byte $30 ; |  XX    |
-       .byte $00 ; |        |
-       .byte $00 ; |        |
-       .byte $00 ; |        |
-       .byte $00 ; |        |
-        
-       .byte $00 ; |        |
-       .byte $60 ; | XX     |
-       .byte $60 ; | XX     |
-       .byte $00 ; |        |
-       .byte $00 ; |        |
-       .byte $00 ; |        |
-       .byte $00 ; |        |
-       .byte $00 ; |        |
-        
-       .byte $00 ; |        |
-       .byte $60 ; | XX    |
-       .byte $30 ; |  XX    |
-       .byte $18 ; |   XX   |
-       .byte $18 ; |   XX   |
-       .byte $18 ; |   XX   |
-       .byte $30 ; |  XX    |
-       .byte $60 ; | XX     |
-       
-       .byte $00 ; |        |
-       .byte $18 ; |   XX   |
-       .byte $30 ; |  XX    |
-       .byte $60 ; | XX     |
-       .byte $60 ; | XX     |
-       .byte $60 ; | XX     |
-       .byte $30 ; |  XX    |
-       .byte $18 ; |   XX   |
-
-       .byte $00 ; |        |
-       .byte $FE ; |XXXXXXX |
-       .byte $00 ; |        |
-       .byte $00 ; |        |
-       .byte $00 ; |        |
-       .byte $00 ; |        |
-       .byte $00 ; |        |
-       .byte $00 ; |        |
-
-	org $f700
-MenuTitle
-	.byte 'UNOCART 2600'
-BlankLine
-	.byte '            '
+;------------------------------------------------------------------
+; Cart glyph area ($f480-$f57f), see CART_GLYPH_LINE_n
+;------------------------------------------------------------------
+	org $f480
 
 ; List of directory entries dynamically filled by the cart
 	org $f800
@@ -1133,19 +776,157 @@ ItemsList
 	.byte 'TESTING 28  '
 	.byte 'TESTING 29  '
 	.byte 0
+
+;------------------------------------------------------------------
+; More subroutines, after the items list
+;------------------------------------------------------------------
+	org $fc00
+	.proc ReadControls
+	lda StickDelayCount
+	beq _0
+	dec StickDelayCount
+	rts
+_0
+	; check down
+	lda #$20
+	and swcha
+	beq _0X
+	; check select
+	lda #$02
+	and swchb
+	beq _0X
+	jmp _1
+_0X	; down/select pressed
+	ldx CurItem
+	inx
+	cpx ItemCount
+	bcc _0a
+	; end of this window, move to the next one if there is one
+	lda StatusByteFlags
+	and #STATUS_MORE_WINDOWS
+	beq _1
+	inc WindowNum
+	inc LoadWindow
+	ldx #0
+_0a	stx CurItem
+	lda #10
+	sta StickDelayCount
+	
+_1	; check up
+	lda #$10
+	and swcha
+	bne _2
+	; up pressed
+	ldx CurItem
+	bne _1a
+	; start of this window, move to the previous one if there is one
+	lda WindowNum
+	beq _2
+	dec WindowNum
+	inc LoadWindow
+	ldx #WINDOW_ITEMS
+_1a	dex
+	stx CurItem
+	lda #10
+	sta StickDelayCount
+
+_2	; check left
+	lda #$40
+	and swcha
+	bne _3
+	; left pressed
+	lda #<CART_CMD_PREV_LETTER_n
+	bit swchb	; left difficulty on A jumps between letters instead of pages
+	bvs _jump
+	lda CurItem
+	sec
+	sbc #ITEMS_PER_SCREEN
+	bcs _2a
+	; previous window
+	ldx WindowNum
+	beq _3
+	dec WindowNum
+	inc LoadWindow
+	adc #WINDOW_ITEMS
+_2a	sta CurItem
+	lda #10
+	sta StickDelayCount
+	
+_3	; check right
+	lda #$80
+	and swcha
+	bne _4
+	; right pressed
+	lda #<CART_CMD_NEXT_LETTER_n
+	bit swchb
+	bvs _jump
+	lda CurItem
+	clc
+	adc #ITEMS_PER_SCREEN
+	cmp ItemCount
+	bcc _3a
+	tax
+	lda StatusByteFlags
+	and #STATUS_MORE_WINDOWS
+	beq _3b
+	; next window
+	inc WindowNum
+	inc LoadWindow
+	txa
+	sbc #WINDOW_ITEMS
+	bcs _3a
+_3b	ldy ItemCount
+	dey
+	tya
+_3a	sta CurItem
+	lda #10
+	sta StickDelayCount
+_4
+	rts
+_jump	ora CurItem
+	sta JumpCmd
+	lda #10
+	sta StickDelayCount
+	rts
+	.endp
+;------------------------------------------------------------------
+; take the number of items from the cart, keeping the selection
+; within them
+	.proc GetItemCount
+	lda StatusByteItemCount
+	sta ItemCount
+	beq _1
+	cmp CurItem
+	beq _0
+	bcs _1
+_0	tax
+	dex
+	stx CurItem
+_1	rts
+	.endp
 	.endp
 	
 ;------------------------------------------------------------------
-; Atari->Cart Command Area
+; Atari->Cart Command Area ($fd00-$feff)
 ;------------------------------------------------------------------
 	org $fe00
 	
 ;------------------------------------------------------------------
 ; Status area dynamically filled by the cart
 ;------------------------------------------------------------------
-	org $ffe0
+	org $ffde
+StatusByteJumpWindow
+	.byte 0	; window and item of the last letter jump
+StatusByteJumpItem
+	.byte 0
 StatusBytes
 	.byte 'STATUS MSG..'
+StatusByteProgress
+	.byte 0	; progress bar pattern while the cart is busy
+StatusByteItemCount
+	.byte 0	; number of items in the list
+StatusByteFlags
+	.byte 0	; STATUS_DIR_GROWING
 	org $ffef
 StatusByteReboot
 	.byte 0	; tells us to reboot after selecting an item
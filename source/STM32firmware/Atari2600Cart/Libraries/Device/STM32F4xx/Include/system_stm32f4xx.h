@@ -84,6 +84,8 @@ extern uint32_t SystemCoreClock;          /*!< System Clock Frequency (Core Cloc
   */
   
 extern void SystemInit(void);
+extern void SystemInitStart(void);
+extern void SystemInitFinish(void);
 extern void SystemCoreClockUpdate(void);
 /**
   * @}
@@ -39,6 +39,11 @@ static void init_spi (void) {
 	/* Init SPI */
 	TM_SPI_Init(FATFS_SPI, FATFS_SPI_PINSPACK);
 	
+#ifdef FATFS_SPI_DMA_RX_STREAM
+	/* Block reads go through DMA */
+	RCC_AHB1PeriphClockCmd(FATFS_SPI_DMA_RCC, ENABLE);
+#endif
+	
 	/* Set CS high */
 	FATFS_CS_HIGH;
 	
@@ -47,12 +52,90 @@ static void init_spi (void) {
 }
 
 
+/* Called while waiting on the card, does nothing unless the application overrides it */
+__weak void TM_FATFS_SD_WaitCallback(void) {
+}
+
+
+#ifdef FATFS_SPI_DMA_RX_STREAM
+/* Start receiving multiple bytes with DMA */
+static void rcvr_spi_dma_start (
+	BYTE *buff,		/* Pointer to data buffer */
+	UINT btr		/* Number of bytes to receive */
+)
+{
+	static BYTE dummy = 0xFF;
+	DMA_InitTypeDef DMA_InitStruct;
+	
+	DMA_DeInit(FATFS_SPI_DMA_RX_STREAM);
+	DMA_DeInit(FATFS_SPI_DMA_TX_STREAM);
+	
+	DMA_StructInit(&DMA_InitStruct);
+	DMA_InitStruct.DMA_Channel = FATFS_SPI_DMA_CHANNEL;
+	DMA_InitStruct.DMA_PeripheralBaseAddr = (uint32_t)&FATFS_SPI->DR;
+	DMA_InitStruct.DMA_BufferSize = btr;
+	DMA_InitStruct.DMA_Priority = DMA_Priority_High;
+	
+	/* Receive into the buffer */
+	DMA_InitStruct.DMA_DIR = DMA_DIR_PeripheralToMemory;
+	DMA_InitStruct.DMA_Memory0BaseAddr = (uint32_t)buff;
+	DMA_InitStruct.DMA_MemoryInc = DMA_MemoryInc_Enable;
+	DMA_Init(FATFS_SPI_DMA_RX_STREAM, &DMA_InitStruct);
+	
+	/* Clock out 0xFF for every byte */
+	DMA_InitStruct.DMA_DIR = DMA_DIR_MemoryToPeripheral;
+	DMA_InitStruct.DMA_Memory0BaseAddr = (uint32_t)&dummy;
+	DMA_InitStruct.DMA_MemoryInc = DMA_MemoryInc_Disable;
+	DMA_InitStruct.DMA_Priority = DMA_Priority_Low;
+	DMA_Init(FATFS_SPI_DMA_TX_STREAM, &DMA_InitStruct);
+	
+	/* Drop anything left in the receive register, then start */
+	(void)FATFS_SPI->DR;
+	SPI_I2S_DMACmd(FATFS_SPI, SPI_I2S_DMAReq_Rx | SPI_I2S_DMAReq_Tx, ENABLE);
+	DMA_Cmd(FATFS_SPI_DMA_RX_STREAM, ENABLE);
+	DMA_Cmd(FATFS_SPI_DMA_TX_STREAM, ENABLE);
+}
+
+/* Check if a transfer from rcvr_spi_dma_start() has completed, and stop it if so */
+static int rcvr_spi_dma_done (void)	/* 1:Completed, 0:Still going */
+{
+	if (DMA_GetFlagStatus(FATFS_SPI_DMA_RX_STREAM, FATFS_SPI_DMA_RX_FLAG_TC) == RESET) {
+		return 0;
+	}
+	
+	SPI_I2S_DMACmd(FATFS_SPI, SPI_I2S_DMAReq_Rx | SPI_I2S_DMAReq_Tx, DISABLE);
+	DMA_Cmd(FATFS_SPI_DMA_RX_STREAM, DISABLE);
+	DMA_Cmd(FATFS_SPI_DMA_TX_STREAM, DISABLE);
+	return 1;
+}
+
+/* Receive multiple bytes with DMA, calling TM_FATFS_SD_WaitCallback() until the transfer completes */
+static void rcvr_spi_dma (
+	BYTE *buff,		/* Pointer to data buffer */
+	UINT btr		/* Number of bytes to receive */
+)
+{
+	rcvr_spi_dma_start(buff, btr);
+	while (!rcvr_spi_dma_done()) {
+		TM_FATFS_SD_WaitCallback();
+	}
+}
+#endif
+
+
 /* Receive multiple byte */
 static void rcvr_spi_multi (
 	BYTE *buff,		/* Pointer to data buffer */
 	UINT btr		/* Number of bytes to receive (even number) */
 )
 {
+#ifdef FATFS_SPI_DMA_RX_STREAM
+	/* DMA can not reach CCM data RAM */
+	if (((uint32_t)buff & 0xFFF00000) != CCMDATARAM_BASE) {
+		rcvr_spi_dma(buff, btr);
+		return;
+	}
+#endif
 	/* Read multiple bytes, send 0xFF as dummy */
 	TM_SPI_ReadMulti(FATFS_SPI, buff, 0xFF, btr);
 }
@@ -86,6 +169,7 @@ static int wait_ready (	/* 1:Ready, 0:Timeout */
 	
 	do {
 		d = TM_SPI_Send(FATFS_SPI, 0xFF);
+		TM_FATFS_SD_WaitCallback();
 	} while (d != 0xFF && TM_DELAY_Time2());	/* Wait for card goes ready or timeout */
 	if (d == 0xFF) {
 		FATFS_DEBUG_SEND_USART("wait_ready: OK");
@@ -146,7 +230,8 @@ static int rcvr_datablock (	/* 1:OK, 0:Error */
 	TM_DELAY_SetTime2(200);
 	do {							// Wait for DataStart token in timeout of 200ms 
 		token = TM_SPI_Send(FATFS_SPI, 0xFF);
-		// This loop will take a time. Insert rot_rdq() here for multitask envilonment. 
+		// This loop will take a time, let the application do something else
+		if (token == 0xFF) TM_FATFS_SD_WaitCallback();
 	} while ((token == 0xFF) && TM_DELAY_Time2());
 	if (token != 0xFE) {
 		FATFS_DEBUG_SEND_USART("rcvr_datablock: token != 0xFE");
@@ -397,6 +482,92 @@ DRESULT TM_FATFS_SD_disk_read (
 
 
 
+/*-----------------------------------------------------------------------*/
+/* Split single sector read                                              */
+/*-----------------------------------------------------------------------*/
+
+#define SPLIT_TOKEN_POLLS	8	/* Bytes clocked per poll while waiting for the DataStart token */
+
+static enum {
+	SPLIT_IDLE,		/* No read started */
+	SPLIT_TOKEN,	/* Waiting for the DataStart token */
+	SPLIT_DATA		/* Receiving the data with DMA */
+} TM_FATFS_SD_Split = SPLIT_IDLE;
+
+static BYTE *TM_FATFS_SD_SplitBuff;
+
+DRESULT TM_FATFS_SD_ReadStart (
+	BYTE *buff,		/* Data buffer to store read data */
+	DWORD sector	/* Sector address (LBA) */
+)
+{
+	if (!TM_FATFS_Detect() || (TM_FATFS_SD_Stat & STA_NOINIT)) {
+		return RES_NOTRDY;
+	}
+	if (TM_FATFS_SD_Split != SPLIT_IDLE) {
+		return RES_ERROR;	/* One read at a time */
+	}
+
+	if (!(TM_FATFS_SD_CardType & CT_BLOCK)) {
+		sector *= 512;	/* LBA ot BA conversion (byte addressing cards) */
+	}
+
+	if (send_cmd(CMD17, sector) != 0) {	/* READ_SINGLE_BLOCK */
+		_deselect();
+		return RES_ERROR;
+	}
+	TM_FATFS_SD_SplitBuff = buff;
+	TM_FATFS_SD_Split = SPLIT_TOKEN;
+	TM_DELAY_SetTime2(200);		/* DataStart token timeout, as in rcvr_datablock() */
+	return RES_OK;
+}
+
+DRESULT TM_FATFS_SD_ReadPoll (void)
+{
+	BYTE token = 0xFF;
+	int n;
+	
+	if (TM_FATFS_SD_Split == SPLIT_TOKEN) {
+		for (n = 0; n < SPLIT_TOKEN_POLLS && token == 0xFF; n++) {
+			token = TM_SPI_Send(FATFS_SPI, 0xFF);
+		}
+		if (token == 0xFF && TM_DELAY_Time2()) {
+			return RES_NOTRDY;
+		}
+		if (token != 0xFE) {
+			TM_FATFS_SD_Split = SPLIT_IDLE;
+			_deselect();
+			return RES_ERROR;
+		}
+#ifdef FATFS_SPI_DMA_RX_STREAM
+		/* DMA can not reach CCM data RAM */
+		if (((uint32_t)TM_FATFS_SD_SplitBuff & 0xFFF00000) != CCMDATARAM_BASE) {
+			rcvr_spi_dma_start(TM_FATFS_SD_SplitBuff, 512);
+			TM_FATFS_SD_Split = SPLIT_DATA;
+			return RES_NOTRDY;
+		}
+#endif
+		TM_SPI_ReadMulti(FATFS_SPI, TM_FATFS_SD_SplitBuff, 0xFF, 512);
+	}
+#ifdef FATFS_SPI_DMA_RX_STREAM
+	else if (TM_FATFS_SD_Split == SPLIT_DATA) {
+		if (!rcvr_spi_dma_done()) {
+			return RES_NOTRDY;
+		}
+	}
+#endif
+	else {
+		return RES_ERROR;	/* No read started */
+	}
+	
+	TM_FATFS_SD_Split = SPLIT_IDLE;
+	TM_SPI_Send(FATFS_SPI, 0xFF); TM_SPI_Send(FATFS_SPI, 0xFF);			/* Discard CRC */
+	_deselect();
+	return RES_OK;
+}
+
+
+
 /*-----------------------------------------------------------------------*/
 /* Write Sector(s)                                                       */
 /*-----------------------------------------------------------------------*/
@@ -55,6 +55,33 @@
 #endif
 #endif
 
+/* Define FATFS_SPI_DMA_RX_STREAM (with the TX stream, channel, RX transfer complete
+   flag and DMA clock) in defines.h to read data blocks with DMA */
+
+/**
+ * @brief  Called by the driver while it waits on the card or a DMA transfer
+ * @note   With __weak parameter to prevent link errors if not defined by user
+ */
+void TM_FATFS_SD_WaitCallback(void);
+
+/**
+ * @brief  Starts reading one sector, without waiting for the card to send it
+ * @note   Call TM_FATFS_SD_ReadPoll() until the read is over, and make no other
+ *         card access in between. The card stays selected until then.
+ * @param  *buff: Where the sector goes, read with DMA unless it is in CCM RAM
+ * @param  sector: Sector address (LBA)
+ * @retval RES_OK if the card took the read command
+ */
+DRESULT TM_FATFS_SD_ReadStart(BYTE *buff, DWORD sector);
+
+/**
+ * @brief  Moves a read started by TM_FATFS_SD_ReadStart() on, without waiting
+ * @note   Clocks a few bytes while the card looks for the sector, then starts DMA.
+ * @retval RES_NOTRDY while the read is going, RES_OK once the sector is in the
+ *         buffer, RES_ERROR if the read failed
+ */
+DRESULT TM_FATFS_SD_ReadPoll(void);
+
 #define FATFS_CS_LOW						FATFS_CS_PORT->BSRRH = FATFS_CS_PIN
 #define FATFS_CS_HIGH						FATFS_CS_PORT->BSRRL = FATFS_CS_PIN
 
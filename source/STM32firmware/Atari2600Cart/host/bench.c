@@ -0,0 +1,435 @@
+/* Storage benchmark
+ * Runs the firmware's own folder reading, cart detection and supercharger
+ * loading on FAT card images, through the real FatFs and diskio.c, and reports
+ * what each costs on the card: sectors and commands, and the SPI time
+ * sd_image.c works out for them. With no images given it builds the standard
+ * ones (a deep folder tree, a 10K file folder and fragmented files, each on
+ * FAT16 and FAT32) in memory.
+ *
+ *   bench [-s dir] [-c spi_hz] [-a access_us] [image...]
+ *
+ * -s saves the standard images to dir, to look at or to run again.
+ */
+#define main firmware_main
+#include "main.c"
+#undef main
+#include "cartridge_supercharger.c"
+
+#include <getopt.h>
+#include <time.h>
+#include "sd_image.h"
+
+#define BENCH_MAX_FOLDERS	256
+#define BENCH_MAX_ROMS		512
+
+typedef struct {
+	const char *name;
+	int runs;
+	uint32_t sectors_read, read_cmds, sectors_written;
+	uint64_t ns, max_ns;
+} BENCH_CASE;
+
+typedef struct {
+	const char *name;
+	uint32_t sectors;
+	UINT au;		// cluster size, which decides FAT16 or FAT32
+	void (*build)(void);
+} BENCH_IMAGE;
+
+char bench_folders[BENCH_MAX_FOLDERS][256];
+int bench_num_folders;
+char bench_roms[BENCH_MAX_ROMS][256];
+int bench_num_roms;
+uint32_t bench_rom_sizes[BENCH_MAX_ROMS];
+
+/*************************************************************************
+ * Standard images
+ *************************************************************************/
+
+static void bench_fail(const char *what, const char *path) {
+	fprintf(stderr, "bench: %s %s failed\n", what, path);
+	exit(1);
+}
+
+static void bench_fill(uint8_t *dst, uint32_t len, uint32_t seed) {
+	for (uint32_t i = 0; i < len; i++) {
+		seed = seed * 1103515245 + 12345;
+		dst[i] = seed >> 16;
+	}
+}
+
+static void bench_mkdir(const char *path) {
+	if (f_mkdir(path) != FR_OK)
+		bench_fail("mkdir", path);
+}
+
+static void bench_rom(const char *path, uint32_t size, uint32_t seed) {
+	static uint8_t data[32 * 1024];
+	FIL fil;
+	UINT written;
+	bench_fill(data, size, seed);
+	if (f_open(&fil, path, FA_WRITE | FA_CREATE_ALWAYS) != FR_OK ||
+		f_write(&fil, data, size, &written) != FR_OK || written != size)
+		bench_fail("write", path);
+	f_close(&fil);
+}
+
+static const uint32_t bench_rom_size[] = { 2048, 4096, 8192, 16384, 32768 };
+
+// twelve levels, each with 20 roms, three side folders and the next level
+static void bench_build_deep(void) {
+	char path[128] = "/Deep Tree", name[256];	// the deepest path is 118 characters
+	bench_mkdir(path);
+	for (int level = 1; level <= 12; level++) {
+		for (int i = 0; i < 20; i++) {
+			sprintf(name, "%s/Level %02d Game %02d.bin", path, level, i);
+			bench_rom(name, bench_rom_size[i % 5], level * 100 + i);
+		}
+		for (int side = 0; side < 3; side++) {
+			sprintf(name, "%s/Side Folder %c", path, 'A' + side);
+			bench_mkdir(name);
+			for (int i = 0; i < 6; i++) {
+				sprintf(name, "%s/Side Folder %c/Side Game %d.a26", path, 'A' + side, i);
+				bench_rom(name, 4096, level * 1000 + side * 10 + i);
+			}
+		}
+		sprintf(path + strlen(path), "/Level %02d", level);
+		bench_mkdir(path);
+	}
+}
+
+// one folder of 10000 2K roms, more than a listing holds
+static void bench_build_flat(void) {
+	char name[64];
+	bench_mkdir("/Flat 10K");
+	for (int i = 0; i < 10000; i++) {
+		sprintf(name, "/Flat 10K/Homebrew Game %05d.bin", i);
+		bench_rom(name, 2048, i);
+	}
+}
+
+// roms and multiload supercharger files written a sector at a time in turn,
+// so that their clusters interleave
+#define BENCH_FRAG_ROMS	16
+#define BENCH_FRAG_SC	4
+#define BENCH_SC_LOADS	3
+
+static void bench_build_fragmented(void) {
+	static FIL fil[BENCH_FRAG_ROMS + BENCH_FRAG_SC];
+	uint32_t size[BENCH_FRAG_ROMS + BENCH_FRAG_SC];
+	static uint8_t sc[BENCH_SC_LOADS * 8448];
+	uint8_t sector[512];
+	char name[64];
+	int n = BENCH_FRAG_ROMS + BENCH_FRAG_SC;
+
+	bench_mkdir("/Fragmented");
+	for (int i = 0; i < n; i++) {
+		if (i < BENCH_FRAG_ROMS)
+			sprintf(name, "/Fragmented/Split Game %02d.bin", i), size[i] = bench_rom_size[2 + i % 3];
+		else
+			sprintf(name, "/Fragmented/Multiload %d.ar", i - BENCH_FRAG_ROMS), size[i] = sizeof(sc);
+		if (f_open(&fil[i], name, FA_WRITE | FA_CREATE_ALWAYS) != FR_OK)
+			bench_fail("open", name);
+	}
+	// each load ends with its header: 8 blocks, and the load's own number
+	bench_fill(sc, sizeof(sc), 7);
+	for (int load = 0; load < BENCH_SC_LOADS; load++) {
+		LoadHeader *header = (LoadHeader *)(sc + (load + 1) * 8448 - 256);
+		header->block_count = 8;
+		header->multiload_id = BENCH_SC_LOADS - 1 - load;
+		for (int i = 0; i < 8; i++)
+			header->block_location[i] = i << 2;
+	}
+	for (uint32_t pos = 0, more = 1; more; pos += sizeof(sector)) {
+		more = 0;
+		for (int i = 0; i < n; i++) {
+			if (pos >= size[i]) continue;
+			UINT len = size[i] - pos < sizeof(sector) ? size[i] - pos : sizeof(sector), written;
+			if (i < BENCH_FRAG_ROMS)
+				bench_fill(sector, len, i * 65536 + pos);
+			else
+				memcpy(sector, sc + pos, len);
+			f_write(&fil[i], sector, len, &written);
+			more = 1;
+		}
+	}
+	for (int i = 0; i < n; i++)
+		f_close(&fil[i]);
+}
+
+static const BENCH_IMAGE bench_images[] = {
+	{ "fat16-deep", 64 * 2048, 2048, bench_build_deep },
+	{ "fat16-flat10k", 64 * 2048, 2048, bench_build_flat },
+	{ "fat16-fragmented", 64 * 2048, 2048, bench_build_fragmented },
+	{ "fat32-deep", 128 * 2048, 1024, bench_build_deep },
+	{ "fat32-flat10k", 128 * 2048, 1024, bench_build_flat },
+	{ "fat32-fragmented", 128 * 2048, 1024, bench_build_fragmented },
+};
+
+static void bench_build(const BENCH_IMAGE *image) {
+	FATFS fs;
+	if (!sd_image_create(image->sectors))
+		bench_fail("create", image->name);
+	f_mount(&fs, "", 0);
+	if (f_mkfs("", 0, image->au) != FR_OK || f_mount(&fs, "", 1) != FR_OK)
+		bench_fail("mkfs", image->name);
+	image->build();
+	f_mount(0, "", 1);
+}
+
+/*************************************************************************
+ * Cases
+ *************************************************************************/
+
+// lists every folder (but ours) and rom on the card, breadth first
+static void bench_walk(void) {
+	FATFS fs;
+	DIR dir;
+	FILINFO info;
+	char name[_MAX_LFN + 1];
+
+	info.lfname = name;
+	info.lfsize = sizeof(name);
+	bench_num_folders = 1;
+	bench_num_roms = 0;
+	strcpy(bench_folders[0], "");
+	f_mount(&fs, "", 1);
+	for (int i = 0; i < bench_num_folders; i++) {
+		if (f_opendir(&dir, bench_folders[i][0] ? bench_folders[i] : "/") != FR_OK)
+			continue;
+		while (f_readdir(&dir, &info) == FR_OK && info.fname[0]) {
+			char *fn = name[0] ? name : info.fname;
+			char path[256];
+			if (fn[0] == '.' || snprintf(path, sizeof(path), "%s/%s", bench_folders[i], fn) >= (int)sizeof(path))
+				continue;
+			if (info.fattrib & AM_DIR) {
+				if (bench_num_folders < BENCH_MAX_FOLDERS)
+					strcpy(bench_folders[bench_num_folders++], path);
+			}
+			else if (is_valid_file(fn) && bench_num_roms < BENCH_MAX_ROMS) {
+				bench_rom_sizes[bench_num_roms] = info.fsize;
+				strcpy(bench_roms[bench_num_roms++], path);
+			}
+		}
+		f_closedir(&dir);
+	}
+	f_mount(0, "", 1);
+}
+
+static void bench_begin() {
+	sd_image_reset_stats();
+}
+
+static void bench_end(BENCH_CASE *c) {
+	c->runs++;
+	c->sectors_read += sd_image_stats.sectors_read;
+	c->read_cmds += sd_image_stats.read_cmds;
+	c->sectors_written += sd_image_stats.sectors_written;
+	c->ns += sd_image_stats.ns;
+	if (sd_image_stats.ns > c->max_ns)
+		c->max_ns = sd_image_stats.ns;
+}
+
+// a call that is timed within a case, e.g. a slice of a folder scan
+static void bench_slice(BENCH_CASE *c, uint64_t ns) {
+	c->runs++;
+	c->ns += ns;
+	if (ns > c->max_ns)
+		c->max_ns = ns;
+}
+
+static void bench_print(const char *image, BENCH_CASE *c) {
+	if (!c->runs) return;
+	printf("%-18s %-16s %5d %9u %7u %7u %10.1f %8.2f %8.2f\n", image, c->name, c->runs,
+		c->sectors_read, c->read_cmds, c->sectors_written,
+		c->ns / 1e6, c->ns / 1e6 / c->runs, c->max_ns / 1e6);
+}
+
+static void bench_run(const char *image) {
+	BENCH_CASE mount = { "mount" }, dir_cold = { "read_directory" }, dir_slice = { "  scan slice" },
+		dir_index = { "  from index" }, identify = { "identify" }, sc = { "supercharger" },
+		catalog = { "catalog" }, catalog_cached = { "  rebuilt" };
+	FATFS fs;
+
+	bench_walk();
+
+	bench_begin();
+	if (mount_card(&fs) != FR_OK) {
+		printf("%-18s can't mount\n", image);
+		return;
+	}
+	bench_end(&mount);
+	f_mount(0, "", 1);
+
+	// each folder twice, the second time from the index the first one saved
+	for (int pass = 0; pass < 2; pass++)
+		for (int i = 0; i < bench_num_folders; i++) {
+			bench_begin();
+			readDirectoryForAtari(bench_folders[i]);
+			while (dir_scan.active) {
+				uint64_t ns = sd_image_stats.ns;
+				continue_directory();
+				if (dir_scan.active)	// the last one sorts and saves the listing too
+					bench_slice(&dir_slice, sd_image_stats.ns - ns);
+			}
+			bench_end(pass ? &dir_index : &dir_cold);
+		}
+
+	for (int i = 0; i < bench_num_roms; i++) {
+		num_dir_entries = 0;	// the rom takes the whole buffer
+		strcpy(cartridge_image_path, bench_roms[i]);
+		bench_begin();
+		int cart_type = identify_cartridge(cartridge_image_path, CART_TYPE_NONE);
+		bench_end(&identify);
+		if (cart_type == CART_TYPE_AR) {
+			uint8_t *ram = buffer, *rom = ram + 0x1800, *map = rom + 0x0800, *load = map + 0x0100;
+			uint32_t loads = bench_rom_sizes[i] / 8448;
+			bench_begin();
+			setup_multiload_map(map, loads, cartridge_image_path);
+			for (uint32_t n = 0; n < loads; n++)
+				load_multiload(ram, rom, map[n], cartridge_image_path, load);
+			bench_end(&sc);
+		}
+	}
+
+	// built from the roms, then rebuilt with the first one as its cache
+	for (int pass = 0; pass < 2; pass++) {
+		catalog_rebuild = 1;
+		bench_begin();
+		if (!readDirectoryForAtari(CATALOG_PATH))
+			bench_fail("catalog", image);
+		bench_end(pass ? &catalog_cached : &catalog);
+	}
+
+	bench_print(image, &mount);
+	bench_print(image, &dir_cold);
+	bench_print(image, &dir_slice);
+	bench_print(image, &dir_index);
+	bench_print(image, &identify);
+	bench_print(image, &sc);
+	bench_print(image, &catalog);
+	bench_print(image, &catalog_cached);
+}
+
+/*************************************************************************
+ * Sorting
+ *************************************************************************/
+
+// A listing holds at most DIR_MAX_ENTRIES entries, which the sort's key and
+// index arrays in CCM RAM are sized for, and one of them is kept for the
+// "(LIST FULL)" note: a folder with more (the 10K file ones above, or 50K)
+// lists, and sorts, only the first ones that fit. So sorting is timed up to
+// that many, and no further, as the firmware never sorts more. Times are this
+// PC's, to compare the two sorts by.
+#define BENCH_SORT_RUNS	20
+#define BENCH_SORT_MAX	(DIR_MAX_ENTRIES - 1)
+
+static const int bench_sort_sizes[] = { 1024, 2048, 3072, BENCH_SORT_MAX };
+
+// what the menu sorted with before the radix sort
+static int bench_entry_compare(const void *p1, const void *p2) {
+	DIR_ENTRY e1 = *(DIR_ENTRY *)p1, e2 = *(DIR_ENTRY *)p2;
+	if (dir_entry_is_dir(e1) != dir_entry_is_dir(e2))
+		return dir_entry_is_dir(e1) ? -1 : 1;
+	return strcasecmp(dir_entry_long_filename(e1), dir_entry_long_filename(e2));
+}
+
+static uint64_t bench_now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// n entries in no order, one in 16 a folder, most with 8.3 names so that n of
+// them fit the arena, and in runs sharing a prefix as rom sets do
+static void bench_sort_entries(int n) {
+	static const char *sets[] = { "ACTI", "ATAR", "GAME", "HB", "IMAG", "PARK" };
+	uint32_t seed = n;
+	char sfn[13], lfn[DIR_MAX_LFN + 1];
+
+	num_dir_entries = dir_names_size = 0;
+	for (int i = 0; i < n; i++) {
+		seed = seed * 1103515245 + 12345;
+		const char *set = sets[(seed >> 16) % 6];
+		sprintf(sfn, "%s%04u.BIN", set, i % 10000);
+		if (seed >> 30)
+			strcpy(lfn, sfn);
+		else
+			sprintf(lfn, "%s Collection %04u.bin", set, (seed >> 8) % 10000);
+		if (!add_dir_entry(i % 16 ? 0 : DIR_ENTRY_IS_DIR, sfn, lfn))
+			bench_fail("add", sfn);
+	}
+}
+
+static void bench_sort(void) {
+	static DIR_ENTRY radix[BENCH_SORT_MAX];
+
+	printf("\n%-18s %5s %12s %12s\n", "sort", "runs", "radix us", "qsort us");
+	printf("(a listing sorts %d entries at most)\n", BENCH_SORT_MAX);
+	for (unsigned int s = 0; s < sizeof(bench_sort_sizes) / sizeof(bench_sort_sizes[0]); s++) {
+		int n = bench_sort_sizes[s];
+		uint64_t radix_ns = 0, qsort_ns = 0;
+		for (int run = 0; run < BENCH_SORT_RUNS; run++) {
+			bench_sort_entries(n);
+			uint64_t start = bench_now_ns();
+			sort_directory(0);
+			radix_ns += bench_now_ns() - start;
+			memcpy(radix, dir_entries, n * sizeof(DIR_ENTRY));
+
+			bench_sort_entries(n);
+			start = bench_now_ns();
+			qsort(dir_entries, n, sizeof(DIR_ENTRY), bench_entry_compare);
+			qsort_ns += bench_now_ns() - start;
+			if (memcmp(radix, dir_entries, n * sizeof(DIR_ENTRY)))
+				bench_fail("sort", "order");
+		}
+		printf("%-18d %5d %12.1f %12.1f\n", n, BENCH_SORT_RUNS,
+			radix_ns / 1e3 / BENCH_SORT_RUNS, qsort_ns / 1e3 / BENCH_SORT_RUNS);
+	}
+	num_dir_entries = dir_names_size = 0;
+}
+
+int main(int argc, char *argv[]) {
+	const char *save_dir = 0;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "s:c:a:")) != -1) {
+		switch (opt) {
+			case 's': save_dir = optarg; break;
+			case 'c': sd_image_timing.spi_hz = atoi(optarg); break;
+			case 'a': sd_image_timing.access_us = atoi(optarg); break;
+			default:
+				fprintf(stderr, "usage: %s [-s dir] [-c spi_hz] [-a access_us] [image...]\n", argv[0]);
+				return 2;
+		}
+	}
+
+	init();
+	printf("SPI %u Hz, access %u us, %u us between blocks\n\n", sd_image_timing.spi_hz,
+		sd_image_timing.access_us, sd_image_timing.block_gap_us);
+	printf("%-18s %-16s %5s %9s %7s %7s %10s %8s %8s\n", "image", "case", "runs",
+		"sectors", "cmds", "written", "total ms", "avg ms", "max ms");
+
+	if (optind < argc) {
+		for (int i = optind; i < argc; i++) {
+			if (!sd_image_load(argv[i]))
+				bench_fail("load", argv[i]);
+			bench_run(argv[i]);
+		}
+	}
+	else {
+		for (unsigned int i = 0; i < sizeof(bench_images) / sizeof(bench_images[0]); i++) {
+			bench_build(&bench_images[i]);
+			if (save_dir) {
+				char path[256];
+				snprintf(path, sizeof(path), "%s/%s.img", save_dir, bench_images[i].name);
+				if (!sd_image_save(path))
+					bench_fail("save", path);
+			}
+			bench_run(bench_images[i].name);
+		}
+	}
+	sd_image_free();
+	bench_sort();
+	return 0;
+}
@@ -0,0 +1,223 @@
+/* Cart detection test
+ * Checks detect_cart_type(), which takes the signature counts of one sig_scan()
+ * pass (for the sizes that need them, sig_scan_needed()), against the detection
+ * it replaced (old_detect.h), which searched the image once for every
+ * signature: the cart type of every image, and whether each signature is found
+ * once and twice. With no roms given it makes up images of every size the old
+ * code handled, from random bytes and from the bytes the signatures are made
+ * of, with signatures planted at the start, at the end and back to back,
+ * mirrored 4K banks and supercharger RAM, and of the FA2 sizes, which the old
+ * code didn't know (detect_test_added).
+ *
+ * It also times both, here and on the cartridge's Cortex-M4. The M4 has no
+ * cache to speak of and runs one instruction after another from 0 wait state
+ * SRAM, so its time is close to a count of the loop iterations each does
+ * times what one costs. Those costs were taken by running the -Os code of
+ * the two loops in tools/kernel_cycles.py's Thumb model:
+ *
+ *   old_searchForBytes()  26 cycles a position, 13 more a signature byte matched there
+ *   sig_scan()            18 cycles a byte, 47 more a signature ending on it
+ *
+ * The rest, isProbablySC() and the memcmp() of an 8K image's halves, is the same
+ * both ways and left out. A PC keeps several of the old code's independent
+ * compares in flight at once but has to wait out each of sig_scan()'s table
+ * loads in turn, so the times measured here don't carry over.
+ *
+ *   detect_test [rom...]
+ */
+#define main firmware_main
+#include "main.c"
+#undef main
+#include "cartridge_supercharger.c"
+#include "old_detect.h"
+
+#include <time.h>
+
+#define DETECT_TEST_IMAGES	20000
+
+#define DETECT_CYCLES_POSITION	26
+#define DETECT_CYCLES_MATCHED	13
+#define DETECT_CYCLES_BYTE	18
+#define DETECT_CYCLES_REPORT	47
+#define DETECT_CPU_MHZ		168
+
+static const uint32_t detect_test_sizes[] = { 2048, 4096, 8192, 10240, 12288, 16384, 20480, 24576, 28672,
+	29696, 30720, 32768, 65536 };
+#define DETECT_TEST_SIZES	(sizeof(detect_test_sizes) / sizeof(detect_test_sizes[0]))
+
+typedef struct {
+	int images, types_differ, signatures_differ;
+	uint64_t old_ns, new_ns;
+	uint64_t old_cycles, new_cycles;
+} DETECT_TEST_SIZE;
+
+static DETECT_TEST_SIZE detect_test_results[DETECT_TEST_SIZES];
+
+// sizes detected since old_detect.h, with what they have to be detected as
+static const struct { uint32_t size; int cart_type; } detect_test_added[] = {
+	{ 24 * 1024, CART_TYPE_FA2 }, { 28 * 1024, CART_TYPE_FA2 }, { 29 * 1024, CART_TYPE_FA2 }
+};
+#define DETECT_TEST_ADDED	(sizeof(detect_test_added) / sizeof(detect_test_added[0]))
+static uint32_t detect_test_seed = 12345;
+
+static uint32_t detect_test_random() {
+	detect_test_seed = detect_test_seed * 1103515245 + 12345;
+	return detect_test_seed >> 8;
+}
+
+static uint64_t detect_test_ns() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// the signatures sig_scan() reports for the len bytes, as it walks the automaton
+static uint64_t detect_test_reports(const unsigned char *bytes, uint32_t len) {
+	SIG_AUTOMATON *ac = &sig_automaton;
+	uint64_t reports = 0;
+	int state = 0;
+	for (uint32_t i = 0; i < len; i++) {
+		state = ac->next[state][ac->byte_class[bytes[i]]];
+		for (int o = ac->report[state]; o; o = ac->dict[o])
+			for (int sig = ac->output[o]; sig; sig = ac->next_output[sig - 1])
+				reports++;
+	}
+	return reports;
+}
+
+static void detect_test_image(const char *name, uint32_t size) {
+	DETECT_TEST_SIZE *result = 0;
+	for (unsigned int i = 0; i < DETECT_TEST_SIZES; i++)
+		if (detect_test_sizes[i] == size)
+			result = &detect_test_results[i];
+	if (!result) {
+		printf("%s: %u bytes, skipped\n", name, size);
+		return;
+	}
+	result->images++;
+
+	uint64_t start = detect_test_ns();
+	old_detect_positions = old_detect_matched = 0;
+	int old_type = old_detect_cart_type(size, size);
+	uint64_t old_ns = detect_test_ns() - start;
+	for (unsigned int i = 0; i < DETECT_TEST_ADDED; i++)
+		if (detect_test_added[i].size == size)
+			old_type = detect_test_added[i].cart_type;
+	result->old_cycles += old_detect_positions * DETECT_CYCLES_POSITION + old_detect_matched * DETECT_CYCLES_MATCHED;
+
+	// as load_image() does it
+	SIG_SCAN scan;
+	start = detect_test_ns();
+	sig_scan_init(&scan, size);
+	if (sig_scan_needed(size))
+		sig_scan(&scan, buffer, size);
+	int new_type = detect_cart_type(size, size, &scan);
+	uint64_t new_ns = detect_test_ns() - start;
+	if (sig_scan_needed(size))
+		result->new_cycles += size * DETECT_CYCLES_BYTE + detect_test_reports(buffer, size) * DETECT_CYCLES_REPORT;
+
+	result->old_ns += old_ns;
+	result->new_ns += new_ns;
+	if (old_type != new_type) {
+		if (result->types_differ++ < 10)
+			printf("%s: %u bytes, type %d, was %d\n", name, size, new_type, old_type);
+	}
+	// every signature, whether or not the size needs them
+	sig_scan_init(&scan, size);
+	sig_scan(&scan, buffer, size);
+	for (int sig = 0; sig < SIG_COUNT; sig++)
+		for (int minhits = 1; minhits <= 2; minhits++) {
+			int found = old_searchForBytes(buffer, size, (unsigned char *)cart_signatures[sig].bytes,
+				cart_signatures[sig].len, minhits);
+			if (found != (scan.hits[sig] >= minhits)) {
+				if (result->signatures_differ++ < 10)
+					printf("%s: %u bytes, signature %d %s %d hits\n", name, size, sig,
+						found ? "doesn't get" : "gets", minhits);
+			}
+		}
+}
+
+// the bytes that make up the signatures, so they turn up half formed as in 6502 code
+static const unsigned char detect_test_alphabet[] = {
+	0x8D, 0xAD, 0x0C, 0x20, 0xD0, 0x85, 0x3F, 0x3E, 0xE0, 0x1F, 0xFF, 0x00,
+	0x08, 0xA9, 0xE7, 0xF9, 0x4C, 0x9D, 0x99, 0xF3, 0xF4, 0xE5, 0x40, 0x2C
+};
+
+static void detect_test_make_image(uint32_t size) {
+	int from_alphabet = detect_test_random() % 3;
+	for (uint32_t i = 0; i < size; i++)
+		buffer[i] = from_alphabet ? detect_test_alphabet[detect_test_random() % sizeof(detect_test_alphabet)]
+			: detect_test_random();
+
+	int plants = detect_test_random() % 6;
+	for (int k = 0; k < plants; k++) {
+		const CART_SIGNATURE *sig = &cart_signatures[detect_test_random() % SIG_COUNT];
+		int pos;
+		switch (detect_test_random() % 4) {
+			case 0:	// searchForBytes() never looks at the last position
+				pos = size - sig->len - detect_test_random() % 3;
+				break;
+			case 1:
+				pos = detect_test_random() % 4;
+				break;
+			default:
+				pos = detect_test_random() % (size - sig->len);
+				break;
+		}
+		memcpy(buffer + pos, sig->bytes, sig->len);
+		// again, overlapping, just after or a byte apart
+		if (detect_test_random() % 2) {
+			int pos2 = pos + sig->len + detect_test_random() % 3 - 1;
+			if (pos2 + sig->len <= (int)size)
+				memcpy(buffer + pos2, sig->bytes, sig->len);
+		}
+	}
+	// supercharger RAM, the first 128 bytes of each bank written twice
+	if (detect_test_random() % 8 == 0)
+		for (uint32_t bank = 0; bank < size / 4096; bank++)
+			memcpy(buffer + bank*4096 + 128, buffer + bank*4096, 128);
+	// a 4K rom padded out to 8K
+	if (size == 8192 && detect_test_random() % 10 == 0)
+		memcpy(buffer + 4096, buffer, 4096);
+}
+
+int main(int argc, char *argv[]) {
+	if (argc > 1) {
+		for (int i = 1; i < argc; i++) {
+			FILE *f = fopen(argv[i], "rb");
+			if (!f) {
+				fprintf(stderr, "detect_test: can't open %s\n", argv[i]);
+				return 1;
+			}
+			uint32_t size = fread(buffer, 1, BUFFER_SIZE * 1024, f);
+			fclose(f);
+			detect_test_image(argv[i], size);
+		}
+	}
+	else {
+		char name[16];
+		for (int i = 0; i < DETECT_TEST_IMAGES; i++) {
+			uint32_t size = detect_test_sizes[detect_test_random() % DETECT_TEST_SIZES];
+			snprintf(name, sizeof(name), "image %d", i);
+			detect_test_make_image(size);
+			detect_test_image(name, size);
+		}
+	}
+
+	int errors = 0;
+	printf("%6s %6s %6s %6s %10s %10s %12s %12s\n", "size", "images", "types", "sigs",
+		"old us", "new us", "old M4 us", "new M4 us");
+	for (unsigned int i = 0; i < DETECT_TEST_SIZES; i++) {
+		DETECT_TEST_SIZE *result = &detect_test_results[i];
+		if (!result->images)
+			continue;
+		printf("%6u %6d %6d %6d %10.1f %10.1f %12.0f %12.0f\n", detect_test_sizes[i], result->images,
+			result->types_differ, result->signatures_differ,
+			result->old_ns / 1000.0 / result->images, result->new_ns / 1000.0 / result->images,
+			(double)result->old_cycles / DETECT_CPU_MHZ / result->images,
+			(double)result->new_cycles / DETECT_CPU_MHZ / result->images);
+		errors += result->types_differ + result->signatures_differ;
+	}
+	printf("detect_test: %d differ\n", errors);
+	return errors != 0;
+}
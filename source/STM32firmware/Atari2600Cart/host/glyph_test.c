@@ -0,0 +1,76 @@
+/* Menu glyph test
+ * The menu kernel draws a line with the same LDA (CharNPtr),Y / STA loop as it
+ * always has. It used to point CharNPtr at the font in its own rom, looking up
+ * every character of the line itself; it now points them at CART_GLYPH_WINDOW,
+ * where the firmware serves the line it rendered (render_menu_items()). This
+ * checks that every row of every line the menu can draw comes out the same
+ * both ways: the window's items, with every character and the directory flag,
+ * the title, the status message and the blank line.
+ *
+ *   glyph_test
+ */
+#include <stdio.h>
+
+#include "cartridge_firmware.c"
+#include "old_menu_rom.h"
+
+#define GLYPH_TEST_ROWS	7	// the kernel counts Y down from 8 and stops at 0
+
+static int glyph_test_rows, glyph_test_errors;
+
+static uint8_t glyph_test_old_rom(uint16_t addr) {
+	return old_menu_rom[addr - OLD_MENU_ROM_BASE];
+}
+
+// what the old kernel read for character c at row y: SetTextPointersSubroutine shifted
+// the glyph number left 3 times, carrying the last bit out into the font's page
+static uint8_t glyph_test_old_row(const char *text, int c, int y) {
+	uint8_t glyph = glyph_test_old_rom(0xF480 + (text[c] & 0x7F));
+	uint16_t ptr = 0xF500 + (uint8_t)(glyph << 3) + ((glyph << 2) & 0x80 ? 0x100 : 0);
+	return glyph_test_old_rom(ptr + y);
+}
+
+// what the kernel reads now: the line selected at CART_GLYPH_LINE_n, and character c at
+// CART_GLYPH_WINDOW + 8*c (SetGlyphPointersSubroutine), served as emulate_firmware_cartridge() does
+static uint8_t glyph_test_new_row(int line, int c, int y) {
+	glyph_line = menu_glyphs[line];
+	return glyph_line[(CART_GLYPH_WINDOW + 8*c + y) & 0x7F];
+}
+
+static void glyph_test_line(const char *what, int line, const char *text) {
+	for (int c = 0; c < 12; c++)
+		for (int y = GLYPH_TEST_ROWS; y > 0; y--) {
+			uint8_t old_row = glyph_test_old_row(text, c, y), new_row = glyph_test_new_row(line, c, y);
+			glyph_test_rows++;
+			if (old_row != new_row) {
+				if (glyph_test_errors++ < 10)
+					printf("%s: character %d ($%02X) row %d is $%02X, was $%02X\n",
+						what, c, (uint8_t)text[c], y, new_row, old_row);
+			}
+		}
+}
+
+int main(void) {
+	// every byte value in some item, so each character is drawn with and without the
+	// directory flag
+	for (int i = 0; i < MENU_WINDOW_ITEMS * 12; i++)
+		menu_ram[i] = i;
+	set_menu_status_msg("BY R.EDWARDS");
+	render_menu_items();
+
+	char name[16];
+	for (int i = 0; i < MENU_WINDOW_ITEMS; i++) {
+		snprintf(name, sizeof(name), "item %d", i);
+		glyph_test_line(name, i, (char *)menu_ram + i*12);
+	}
+	glyph_test_line("title", GLYPH_LINE_TITLE, (const char *)old_menu_rom + 0xF700 - OLD_MENU_ROM_BASE);
+	glyph_test_line("blank", GLYPH_LINE_BLANK, (const char *)old_menu_rom + 0xF70C - OLD_MENU_ROM_BASE);
+	glyph_test_line("status", GLYPH_LINE_STATUS, menu_status);
+
+	// a new status message is rendered as it is set
+	set_menu_status_msg("Bad rom, 2K?");
+	glyph_test_line("new status", GLYPH_LINE_STATUS, menu_status);
+
+	printf("glyph_test: %d rows, %d differ\n", glyph_test_rows, glyph_test_errors);
+	return glyph_test_errors != 0;
+}
@@ -0,0 +1,19 @@
+/* Host stand-in for drivers/fatfs_sd.h, so that diskio.c dispatches to the
+ * TM_FATFS_SD_disk_* functions of sd_image.c instead of the SPI driver.
+ */
+#ifndef _DISKIO_DEFINED_SD
+#define _DISKIO_DEFINED_SD
+
+#define _USE_WRITE	1	/* 1: Enable disk_write function */
+#define _USE_IOCTL	1	/* 1: Enable disk_ioctl fucntion */
+
+#include "diskio.h"
+#include "integer.h"
+
+#include "stm32f4xx.h"
+
+void TM_FATFS_SD_WaitCallback(void);
+DRESULT TM_FATFS_SD_ReadStart(BYTE *buff, DWORD sector);
+DRESULT TM_FATFS_SD_ReadPoll(void);
+
+#endif
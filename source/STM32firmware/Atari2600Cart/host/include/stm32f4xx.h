@@ -0,0 +1,110 @@
+/* Host stand-in for the CMSIS device header: just the registers and library
+ * calls the firmware sources touch, backed by plain variables (see stm32_host.c).
+ * The bus is never driven on the host, so GPIO reads return whatever the
+ * variables hold. DWT->CYCCNT is advanced by the simulated SD card time.
+ */
+#ifndef HOST_STM32F4XX_H
+#define HOST_STM32F4XX_H
+
+#include <stdint.h>
+
+#define __IO	volatile
+#define __INLINE	inline
+
+typedef enum { DISABLE = 0, ENABLE = !DISABLE } FunctionalState;
+
+typedef struct {
+	__IO uint32_t MODER, OTYPER, OSPEEDR, PUPDR, IDR, ODR;
+	__IO uint16_t BSRRL, BSRRH;
+	__IO uint32_t LCKR, AFR[2];
+} GPIO_TypeDef;
+
+typedef struct { __IO uint32_t CR, AHB1ENR; } RCC_TypeDef;
+typedef struct { __IO uint32_t CTRL, LOAD, VAL, CALIB; } SysTick_Type;
+typedef struct { __IO uint32_t ACR, KEYR, OPTKEYR, SR, CR, OPTCR; } FLASH_TypeDef;
+typedef struct { __IO uint32_t CTRL, CYCCNT; } DWT_Type;
+typedef struct { __IO uint32_t DEMCR; } CoreDebug_Type;
+
+extern GPIO_TypeDef host_gpioc, host_gpiod, host_gpioe;
+extern RCC_TypeDef host_rcc;
+extern FLASH_TypeDef host_flash;
+extern SysTick_Type host_systick;
+extern DWT_Type host_dwt;
+extern CoreDebug_Type host_coredebug;
+
+#define GPIOC		(&host_gpioc)
+#define GPIOD		(&host_gpiod)
+#define GPIOE		(&host_gpioe)
+#define RCC			(&host_rcc)
+#define FLASH		(&host_flash)
+#define SysTick		(&host_systick)
+#define DWT			(&host_dwt)
+#define CoreDebug	(&host_coredebug)
+
+#define RCC_CR_PLLRDY				(1UL << 25)
+#define RCC_AHB1ENR_GPIOCEN			(1UL << 2)
+#define RCC_AHB1ENR_GPIODEN			(1UL << 3)
+#define RCC_AHB1ENR_GPIOEEN			(1UL << 4)
+#define RCC_AHB1Periph_CRC			(1UL << 12)
+#define CoreDebug_DEMCR_TRCENA_Msk	(1UL << 24)
+#define DWT_CTRL_CYCCNTENA_Msk		(1UL << 0)
+#define FLASH_SR_BSY				(1UL << 16)
+#define FLASH_CR_PG					(1UL << 0)
+#define FLASH_CR_SER				(1UL << 1)
+#define FLASH_CR_STRT				(1UL << 16)
+
+#define HSI_VALUE	16000000
+
+extern uint32_t SystemCoreClock;
+
+void SystemInitStart(void);
+void SystemInitFinish(void);
+
+// the boot code's linker symbols, _edata is taken by the host linker
+#define _edata	host_edata
+
+static inline void __disable_irq(void) {}
+static inline void __enable_irq(void) {}
+static inline uint32_t __get_PRIMASK(void) { return 0; }
+static inline void __set_PRIMASK(uint32_t mask) { (void)mask; }
+static inline uint32_t SysTick_Config(uint32_t ticks) { (void)ticks; return 0; }
+static inline void RCC_AHB1PeriphClockCmd(uint32_t periph, FunctionalState state) { (void)periph; (void)state; }
+
+static inline uint32_t __RBIT(uint32_t value) {
+	uint32_t result = 0;
+	for (int i = 0; i < 32; i++, value >>= 1)
+		result = (result << 1) | (value & 1);
+	return result;
+}
+
+// the flash library, on the cart ram snapshot sectors only (_ssave, see stm32_host.c)
+typedef enum { FLASH_BUSY = 1, FLASH_ERROR_PGS, FLASH_ERROR_PGP, FLASH_ERROR_PGA, FLASH_ERROR_WRP,
+	FLASH_ERROR_PROGRAM, FLASH_ERROR_OPERATION, FLASH_COMPLETE } FLASH_Status;
+#define FLASH_Sector_10		0x0050
+#define FLASH_Sector_11		0x0058
+#define VoltageRange_3		2
+#define FLASH_PSIZE_WORD	0x0200
+#define FLASH_FLAG_EOP		0x0001
+#define FLASH_FLAG_OPERR	0x0002
+#define FLASH_FLAG_WRPERR	0x0010
+#define FLASH_FLAG_PGAERR	0x0020
+#define FLASH_FLAG_PGPERR	0x0040
+#define FLASH_FLAG_PGSERR	0x0080
+void FLASH_Unlock(void);
+void FLASH_Lock(void);
+void FLASH_ClearFlag(uint32_t flags);
+void host_flash_erase(int i);	// sector 10 + i, see stm32_host.c
+FLASH_Status FLASH_ProgramWord(uintptr_t address, uint32_t data);	// uint32_t on the STM32
+
+// the CRC unit: CRC-32 (poly 0x04C11DB7), MSB first, a word at a time
+extern uint32_t host_crc;
+static inline void CRC_ResetDR(void) { host_crc = 0xFFFFFFFF; }
+static inline uint32_t CRC_GetCRC(void) { return host_crc; }
+static inline uint32_t CRC_CalcCRC(uint32_t data) {
+	host_crc ^= data;
+	for (int i = 0; i < 32; i++)
+		host_crc = (host_crc & 0x80000000) ? (host_crc << 1) ^ 0x04C11DB7 : host_crc << 1;
+	return host_crc;
+}
+
+#endif // HOST_STM32F4XX_H
@@ -0,0 +1,10 @@
+/* Host stand-in for tm_stm32f4_delay.h: the pauses cost nothing. */
+#ifndef HOST_TM_STM32F4_DELAY_H
+#define HOST_TM_STM32F4_DELAY_H
+
+#include <stdint.h>
+
+static inline void TM_DELAY_Init(void) {}
+static inline void Delayms(uint32_t ms) { (void)ms; }
+
+#endif // HOST_TM_STM32F4_DELAY_H
@@ -0,0 +1,11 @@
+/* Host stand-in for tm_stm32f4_fatfs.h: FatFs without the pin setup. */
+#ifndef HOST_TM_STM32F4_FATFS_H
+#define HOST_TM_STM32F4_FATFS_H
+
+#include "ff.h"
+#include "diskio.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#endif // HOST_TM_STM32F4_FATFS_H
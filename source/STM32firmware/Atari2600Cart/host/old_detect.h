@@ -0,0 +1,260 @@
+/* Cart type detection as it was before the signatures were counted in one pass
+ * (sig_scan()), for detect_test.c to check the new one against: the Stella
+ * routines, each calling old_searchForBytes() once per signature. The only
+ * change is that old_searchForBytes() counts the positions it tries and the
+ * signature bytes it matches there, for detect_test.c's cycle model.
+ */
+static uint64_t old_detect_positions, old_detect_matched;
+
+static int old_isProbablySC(int size, unsigned char *bytes)
+{
+	int banks = size/4096;
+	for (int i = 0; i < banks; i++)
+	{
+		for (int j = 0; j < 128; j++)
+		{
+			if (bytes[i*4096+j] != bytes[i*4096+j+128])
+				return 0;
+		}
+	}
+	return 1;
+}
+
+static int old_searchForBytes(unsigned char *bytes, int size, unsigned char *signature, int sigsize, int minhits)
+{
+	int count = 0;
+	for(int i = 0; i < size - sigsize; ++i)
+	{
+		int matches = 0;
+		old_detect_positions++;
+		for(int j = 0; j < sigsize; ++j)
+		{
+			if(bytes[i+j] == signature[j])
+				++matches, old_detect_matched++;
+			else
+				break;
+		}
+		if(matches == sigsize)
+		{
+			++count;
+			i += sigsize;  // skip past this signature 'window' entirely
+		}
+		if(count >= minhits)
+			break;
+	}
+	return (count >= minhits);
+}
+
+static int old_isProbablyFE(int size, unsigned char *bytes)
+{	// These signatures are attributed to the MESS project
+	unsigned char signature[4][5] = {
+		{ 0x20, 0x00, 0xD0, 0xC6, 0xC5 },  // JSR $D000; DEC $C5
+		{ 0x20, 0xC3, 0xF8, 0xA5, 0x82 },  // JSR $F8C3; LDA $82
+		{ 0xD0, 0xFB, 0x20, 0x73, 0xFE },  // BNE $FB; JSR $FE73
+		{ 0x20, 0x00, 0xF0, 0x84, 0xD6 }   // JSR $F000; STY $D6
+	};
+	for (int i = 0; i < 4; ++i)
+		if(old_searchForBytes(bytes, size, signature[i], 5, 1))
+			return 1;
+
+	return 0;
+}
+
+static int old_isProbably3F(int size, unsigned char *bytes)
+{	// 3F cart bankswitching is triggered by storing the bank number
+	// in address 3F using 'STA $3F'
+	// We expect it will be present at least 2 times, since there are
+	// at least two banks
+	unsigned char signature[] = { 0x85, 0x3F };  // STA $3F
+	return old_searchForBytes(bytes, size, signature, 2, 2);
+}
+
+static int old_isProbably3E(int size, unsigned char *bytes)
+{	// 3E cart bankswitching is triggered by storing the bank number
+	// in address 3E using 'STA $3E', commonly followed by an
+	// immediate mode LDA
+	unsigned char  signature[] = { 0x85, 0x3E, 0xA9, 0x00 };  // STA $3E; LDA #$00
+	return old_searchForBytes(bytes, size, signature, 4, 1);
+}
+
+static int old_isProbablyE0(int size, unsigned char *bytes)
+{	// E0 cart bankswitching is triggered by accessing addresses
+	// $FE0 to $FF9 using absolute non-indexed addressing
+	// These signatures are attributed to the MESS project
+	unsigned char signature[8][3] = {
+			{ 0x8D, 0xE0, 0x1F },  // STA $1FE0
+			{ 0x8D, 0xE0, 0x5F },  // STA $5FE0
+			{ 0x8D, 0xE9, 0xFF },  // STA $FFE9
+			{ 0x0C, 0xE0, 0x1F },  // NOP $1FE0
+			{ 0xAD, 0xE0, 0x1F },  // LDA $1FE0
+			{ 0xAD, 0xE9, 0xFF },  // LDA $FFE9
+			{ 0xAD, 0xED, 0xFF },  // LDA $FFED
+			{ 0xAD, 0xF3, 0xBF }   // LDA $BFF3
+		};
+	for (int i = 0; i < 8; ++i)
+		if(old_searchForBytes(bytes, size, signature[i], 3, 1))
+			return 1;
+	return 0;
+}
+
+static int old_isProbably0840(int size, unsigned char *bytes)
+{	// 0840 cart bankswitching is triggered by accessing addresses 0x0800
+	// or 0x0840 at least twice
+	unsigned char signature1[3][3] = {
+			{ 0xAD, 0x00, 0x08 },  // LDA $0800
+			{ 0xAD, 0x40, 0x08 },  // LDA $0840
+			{ 0x2C, 0x00, 0x08 }   // BIT $0800
+		};
+	for (int i = 0; i < 3; ++i)
+		if(old_searchForBytes(bytes, size, signature1[i], 3, 2))
+			return 1;
+
+	unsigned char signature2[2][4] = {
+			{ 0x0C, 0x00, 0x08, 0x4C },  // NOP $0800; JMP ...
+			{ 0x0C, 0xFF, 0x0F, 0x4C }   // NOP $0FFF; JMP ...
+		};
+	for (int i = 0; i < 2; ++i)
+		if(old_searchForBytes(bytes, size, signature2[i], 4, 2))
+			return 1;
+
+	return 0;
+}
+
+static int old_isProbablyCV(int size, unsigned char *bytes)
+{ 	// CV RAM access occurs at addresses $f3ff and $f400
+	// These signatures are attributed to the MESS project
+	unsigned char signature[2][3] = {
+			{ 0x9D, 0xFF, 0xF3 },  // STA $F3FF.X
+			{ 0x99, 0x00, 0xF4 }   // STA $F400.Y
+		};
+	for (int i = 0; i < 2; ++i)
+		if(old_searchForBytes(bytes, size, signature[i], 3, 1))
+			return 1;
+	return 0;
+}
+
+static int old_isProbablyEF(int size, unsigned char *bytes)
+{ 	// EF cart bankswitching switches banks by accessing addresses
+	// 0xFE0 to 0xFEF, usually with either a NOP or LDA
+	// It's likely that the code will switch to bank 0, so that's what is tested
+	unsigned char signature[4][3] = {
+			{ 0x0C, 0xE0, 0xFF },  // NOP $FFE0
+			{ 0xAD, 0xE0, 0xFF },  // LDA $FFE0
+			{ 0x0C, 0xE0, 0x1F },  // NOP $1FE0
+			{ 0xAD, 0xE0, 0x1F }   // LDA $1FE0
+		};
+	for (int i = 0; i < 4; ++i)
+		if(old_searchForBytes(bytes, size, signature[i], 3, 1))
+			return 1;
+	return 0;
+}
+
+static int old_isProbablyE7(int size, unsigned char *bytes)
+{ 	// These signatures are attributed to the MESS project
+	unsigned char signature[7][3] = {
+			{ 0xAD, 0xE2, 0xFF },  // LDA $FFE2
+			{ 0xAD, 0xE5, 0xFF },  // LDA $FFE5
+			{ 0xAD, 0xE5, 0x1F },  // LDA $1FE5
+			{ 0xAD, 0xE7, 0x1F },  // LDA $1FE7
+			{ 0x0C, 0xE7, 0x1F },  // NOP $1FE7
+			{ 0x8D, 0xE7, 0xFF },  // STA $FFE7
+			{ 0x8D, 0xE7, 0x1F }   // STA $1FE7
+		};
+	for (int i = 0; i < 7; ++i)
+		if(old_searchForBytes(bytes, size, signature[i], 3, 1))
+			return 1;
+	return 0;
+}
+
+/*************************************************************************
+ * File/Directory Handling
+ *************************************************************************/
+
+// auto-detects the cart type of the image in the buffer - largely follows code
+// in Stella's CartDetector.cpp
+static int old_detect_cart_type(unsigned int image_size, unsigned int bytes_read)
+{
+	int cart_type = CART_TYPE_NONE;
+
+	if (image_size == 2*1024)
+	{
+		if (old_isProbablyCV(bytes_read, buffer))
+			cart_type = CART_TYPE_CV;
+		else
+			cart_type = CART_TYPE_2K;
+	}
+	else if (image_size == 4*1024)
+	{
+		cart_type = CART_TYPE_4K;
+	}
+	else if (image_size == 8*1024)
+	{
+		// First check for *potential* F8
+		unsigned char  signature[] = { 0x8D, 0xF9, 0x1F };  // STA $1FF9
+		int f8 = old_searchForBytes(buffer, bytes_read, signature, 3, 2);
+
+		if (old_isProbablySC(bytes_read, buffer))
+			cart_type = CART_TYPE_F8SC;
+		else if (memcmp(buffer, buffer + 4096, 4096) == 0)
+			cart_type = CART_TYPE_4K;
+		else if (old_isProbablyE0(bytes_read, buffer))
+			cart_type = CART_TYPE_E0;
+		else if (old_isProbably3E(bytes_read, buffer))
+			cart_type = CART_TYPE_3E;
+		else if (old_isProbably3F(bytes_read, buffer))
+			cart_type = CART_TYPE_3F;
+		else if (old_isProbablyFE(bytes_read, buffer) && !f8)
+			cart_type = CART_TYPE_FE;
+		else if (old_isProbably0840(bytes_read, buffer))
+			cart_type = CART_TYPE_0840;
+		else
+			cart_type = CART_TYPE_F8;
+	}
+	else if(image_size >= 10240 && image_size <= 10496)
+	{  // ~10K - Pitfall II
+		cart_type = CART_TYPE_DPC;
+	}
+	else if (image_size == 12*1024)
+	{
+		cart_type = CART_TYPE_FA;
+	}
+	else if (image_size == 16*1024)
+	{
+		if (old_isProbablySC(bytes_read, buffer))
+			cart_type = CART_TYPE_F6SC;
+		else if (old_isProbablyE7(bytes_read, buffer))
+			cart_type = CART_TYPE_E7;
+		else if (old_isProbably3E(bytes_read, buffer))
+			cart_type = CART_TYPE_3E;
+		else
+			cart_type = CART_TYPE_F6;
+	}
+	else if (image_size == 32*1024)
+	{
+		if (old_isProbablySC(bytes_read, buffer))
+			cart_type = CART_TYPE_F4SC;
+		else if (old_isProbably3E(bytes_read, buffer))
+			cart_type = CART_TYPE_3E;
+		else if (old_isProbably3F(bytes_read, buffer))
+			cart_type = CART_TYPE_3F;
+		else
+			cart_type = CART_TYPE_F4;
+	}
+	else if (image_size == 64*1024)
+	{
+		if (old_isProbably3E(bytes_read, buffer))
+			cart_type = CART_TYPE_3E;
+		else if (old_isProbably3F(bytes_read, buffer))
+			cart_type = CART_TYPE_3F;
+		else if (old_isProbablyEF(bytes_read, buffer))
+		{
+			if (old_isProbablySC(bytes_read, buffer))
+				cart_type = CART_TYPE_EFSC;
+			else
+				cart_type = CART_TYPE_EF;
+		}
+		else
+			cart_type = CART_TYPE_F0;
+	}
+	return cart_type;
+}
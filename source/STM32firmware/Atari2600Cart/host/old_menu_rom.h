@@ -0,0 +1,64 @@
+/* $f480-$f717 of the NTSC menu rom as it was while the menu kernel looked up its
+ * own glyphs: the ASCII lookup at $f480, the font at $f500, and the title and
+ * blank line at $f700. glyph_test.c draws lines with them the way that kernel did.
+ */
+#define OLD_MENU_ROM_BASE	0xF480
+
+static unsigned const char old_menu_rom[] = {
+  0x29, 0x29, 0x29, 0x29, 0x29, 0x29, 0x29, 0x29, 0x29, 0x29, 0x29, 0x29,
+  0x29, 0x29, 0x29, 0x29, 0x29, 0x29, 0x29, 0x29, 0x29, 0x29, 0x29, 0x29,
+  0x29, 0x29, 0x29, 0x29, 0x29, 0x29, 0x29, 0x29, 0x1a, 0x29, 0x29, 0x29,
+  0x29, 0x29, 0x29, 0x29, 0x28, 0x27, 0x29, 0x29, 0x25, 0x29, 0x26, 0x29,
+  0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x20, 0x21, 0x22, 0x23, 0x24, 0x29, 0x29,
+  0x29, 0x29, 0x29, 0x29, 0x29, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06,
+  0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x10, 0x11, 0x12,
+  0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x29, 0x29, 0x29, 0x29, 0x29,
+  0x29, 0x29, 0x29, 0x29, 0x29, 0x29, 0x29, 0x29, 0x29, 0x29, 0x29, 0x29,
+  0x29, 0x29, 0x29, 0x29, 0x29, 0x29, 0x29, 0x29, 0x29, 0x29, 0x29, 0x29,
+  0x29, 0x29, 0x29, 0x29, 0x29, 0x29, 0x29, 0x29, 0x00, 0xc6, 0xc6, 0xfe,
+  0xc6, 0xc6, 0x6c, 0x38, 0x00, 0xfc, 0xc6, 0xc6, 0xfc, 0xc6, 0xc6, 0xfc,
+  0x00, 0x3c, 0x66, 0xc0, 0xc0, 0xc0, 0x66, 0x3c, 0x00, 0xf8, 0xcc, 0xc6,
+  0xc6, 0xc6, 0xcc, 0xf8, 0x00, 0xfe, 0xc0, 0xc0, 0xf8, 0xc0, 0xc0, 0xfe,
+  0x00, 0xc0, 0xc0, 0xc0, 0xfc, 0xc0, 0xc0, 0xfe, 0x00, 0x3e, 0x66, 0xc6,
+  0xce, 0xc0, 0x60, 0x3e, 0x00, 0xc6, 0xc6, 0xc6, 0xfe, 0xc6, 0xc6, 0xc6,
+  0x00, 0x78, 0x30, 0x30, 0x30, 0x30, 0x30, 0x78, 0x00, 0x7c, 0xc6, 0x06,
+  0x06, 0x06, 0x06, 0x06, 0x00, 0xce, 0xdc, 0xf8, 0xf0, 0xd8, 0xcc, 0xc6,
+  0x00, 0xfe, 0xc0, 0xc0, 0xc0, 0xc0, 0xc0, 0xc0, 0x00, 0xc6, 0xc6, 0xd6,
+  0xfe, 0xfe, 0xee, 0xc6, 0x00, 0xc6, 0xce, 0xde, 0xfe, 0xf6, 0xe6, 0xc6,
+  0x00, 0x7c, 0xc6, 0xc6, 0xc6, 0xc6, 0xc6, 0x7c, 0x00, 0xc0, 0xc0, 0xfc,
+  0xc6, 0xc6, 0xc6, 0xfc, 0x00, 0x76, 0xcc, 0xda, 0xc6, 0xc6, 0xc6, 0x7c,
+  0x00, 0xce, 0xdc, 0xf8, 0xce, 0xc6, 0xc6, 0xfc, 0x00, 0x7c, 0xc6, 0x06,
+  0x7c, 0xc0, 0xcc, 0x78, 0x00, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0xfc,
+  0x00, 0x7c, 0xc6, 0xc6, 0xc6, 0xc6, 0xc6, 0xc6, 0x00, 0x10, 0x38, 0x7c,
+  0xee, 0xc6, 0xc6, 0xc6, 0x00, 0xc6, 0xee, 0xfe, 0xfe, 0xd6, 0xc6, 0xc6,
+  0x00, 0xc6, 0xee, 0x7c, 0x38, 0x7c, 0xee, 0xc6, 0x00, 0x30, 0x30, 0x30,
+  0x78, 0xcc, 0xcc, 0xcc, 0x00, 0xfe, 0xe0, 0x70, 0x38, 0x1c, 0x0e, 0xfe,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x7c, 0xc6, 0xe6,
+  0xd6, 0xce, 0xc6, 0x7c, 0x00, 0xfc, 0x30, 0x30, 0x30, 0x30, 0x70, 0x30,
+  0x00, 0xfe, 0xe0, 0x78, 0x3c, 0x0e, 0xc6, 0x7c, 0x00, 0x7c, 0xc6, 0x06,
+  0x3c, 0x18, 0x0c, 0x7e, 0x00, 0x0c, 0x0c, 0xfe, 0xcc, 0x6c, 0x3c, 0x1c,
+  0x00, 0x7c, 0xc6, 0x06, 0x06, 0xfc, 0xc0, 0xfc, 0x00, 0x7c, 0xc6, 0xc6,
+  0xfc, 0xc0, 0x60, 0x3c, 0x00, 0x30, 0x30, 0x30, 0x18, 0x0c, 0xc6, 0xfe,
+  0x00, 0x7c, 0xc6, 0xc6, 0x7c, 0xc6, 0xc6, 0x7c, 0x00, 0x78, 0x0c, 0x06,
+  0x7e, 0xc6, 0xc6, 0x7c, 0x00, 0x60, 0x30, 0x30, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x60, 0x60, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x60, 0x30, 0x18,
+  0x18, 0x18, 0x30, 0x60, 0x00, 0x18, 0x30, 0x60, 0x60, 0x60, 0x30, 0x18,
+  0x00, 0xfe, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0x55, 0x4e, 0x4f, 0x43, 0x41, 0x52, 0x54, 0x20,
+  0x32, 0x36, 0x30, 0x30, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
+  0x20, 0x20, 0x20, 0x20
+};
@@ -0,0 +1,164 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "stm32f4xx.h"
+#include "fatfs_sd.h"
+#include "sd_image.h"
+
+// SPI2 runs at 42MHz / 32 (TM_SPI2_PRESCALER), the card timings are typical
+SD_IMAGE_TIMING sd_image_timing = { 42000000 / 32, 250, 20, 400 };
+SD_IMAGE_STATS sd_image_stats;
+
+static uint8_t *image;
+static uint32_t image_sectors;
+static uint64_t cycles_charged;	// the part of sd_image_stats.ns already on DWT->CYCCNT
+static BYTE *split_buff;		// a read from TM_FATFS_SD_ReadStart(), 0 if none
+static DWORD split_sector;
+static uint64_t split_done_ns;	// when its data has all arrived
+
+// bytes send_cmd() clocks: deselect, select and wait_ready, the command and its response
+#define CMD_BYTES		10
+#define STOP_BYTES		8	// CMD12 is sent without reselecting and skips a byte
+#define BLOCK_BYTES		(1 + 512 + 2)	// token, data and CRC
+#define WAIT_SLICE		64	// bytes between the driver's wait callbacks
+#define POLL_NS			1000	// a TM_FATFS_SD_ReadPoll() that finds the read still going
+
+static void charge(uint32_t bytes, uint32_t wait_us) {
+	sd_image_stats.spi_bytes += bytes;
+	sd_image_stats.ns += (uint64_t)bytes * 8 * 1000000000 / sd_image_timing.spi_hz + (uint64_t)wait_us * 1000;
+	uint64_t cycles = sd_image_stats.ns * (SystemCoreClock / 1000000) / 1000;
+	DWT->CYCCNT += (uint32_t)(cycles - cycles_charged);
+	cycles_charged = cycles;
+}
+
+// a data block with the callbacks the driver makes while it waits on the card and DMA
+static void charge_block(uint32_t wait_us) {
+	charge(BLOCK_BYTES, wait_us);
+	for (int i = 0; i <= 512 / WAIT_SLICE; i++)
+		TM_FATFS_SD_WaitCallback();
+}
+
+int sd_image_create(uint32_t sectors) {
+	sd_image_free();
+	image = calloc(sectors, 512);
+	if (!image) return 0;
+	image_sectors = sectors;
+	return 1;
+}
+
+int sd_image_load(const char *path) {
+	FILE *f = fopen(path, "rb");
+	if (!f) return 0;
+	fseek(f, 0, SEEK_END);
+	long size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	int ok = size >= 512 && sd_image_create(size / 512) && fread(image, 512, image_sectors, f) == image_sectors;
+	fclose(f);
+	if (!ok) sd_image_free();
+	return ok;
+}
+
+int sd_image_save(const char *path) {
+	FILE *f = fopen(path, "wb");
+	if (!f) return 0;
+	int ok = fwrite(image, 512, image_sectors, f) == image_sectors;
+	return fclose(f) == 0 && ok;
+}
+
+void sd_image_free(void) {
+	free(image);
+	image = 0;
+	image_sectors = 0;
+}
+
+void sd_image_reset_stats(void) {
+	memset(&sd_image_stats, 0, sizeof(sd_image_stats));
+	cycles_charged = 0;
+}
+
+DSTATUS TM_FATFS_SD_disk_initialize(void) {
+	return image ? 0 : STA_NOINIT;
+}
+
+DSTATUS TM_FATFS_SD_disk_status(void) {
+	return image ? 0 : STA_NOINIT;
+}
+
+DRESULT TM_FATFS_SD_disk_read(BYTE *buff, DWORD sector, UINT count) {
+	if (!image) return RES_NOTRDY;
+	if (sector >= image_sectors || count > image_sectors - sector) return RES_ERROR;
+	sd_image_stats.read_cmds++;
+	charge(CMD_BYTES, 0);
+	for (UINT i = 0; i < count; i++) {
+		memcpy(buff + i * 512, image + (size_t)(sector + i) * 512, 512);
+		charge_block(i ? sd_image_timing.block_gap_us : sd_image_timing.access_us);
+	}
+	if (count > 1)
+		charge(STOP_BYTES, 0);
+	charge(1, 0);	// deselect
+	sd_image_stats.sectors_read += count;
+	return RES_OK;
+}
+
+// the card's access time and the DMA transfer pass between polls, as the
+// caller gets on with other things
+DRESULT TM_FATFS_SD_ReadStart(BYTE *buff, DWORD sector) {
+	if (!image) return RES_NOTRDY;
+	if (split_buff || sector >= image_sectors) return RES_ERROR;
+	sd_image_stats.read_cmds++;
+	charge(CMD_BYTES, 0);
+	split_buff = buff;
+	split_sector = sector;
+	split_done_ns = sd_image_stats.ns + sd_image_timing.access_us * 1000ull +
+		(uint64_t)BLOCK_BYTES * 8 * 1000000000 / sd_image_timing.spi_hz;
+	return RES_OK;
+}
+
+DRESULT TM_FATFS_SD_ReadPoll(void) {
+	if (!split_buff) return RES_ERROR;
+	if (sd_image_stats.ns < split_done_ns) {
+		sd_image_stats.ns += POLL_NS;
+		charge(0, 0);
+		return RES_NOTRDY;
+	}
+	memcpy(split_buff, image + (size_t)split_sector * 512, 512);
+	split_buff = 0;
+	charge(1, 0);	// deselect
+	sd_image_stats.sectors_read++;
+	return RES_OK;
+}
+
+DRESULT TM_FATFS_SD_disk_write(const BYTE *buff, DWORD sector, UINT count) {
+	if (!image) return RES_NOTRDY;
+	if (sector >= image_sectors || count > image_sectors - sector) return RES_ERROR;
+	sd_image_stats.write_cmds++;
+	charge(count > 1 ? 3 * CMD_BYTES : CMD_BYTES, 0);	// ACMD23 first for a multiple block write
+	for (UINT i = 0; i < count; i++) {
+		memcpy(image + (size_t)(sector + i) * 512, buff + i * 512, 512);
+		charge(1 + BLOCK_BYTES + 1, sd_image_timing.program_us);	// wait_ready, the block and its response
+	}
+	if (count > 1)
+		charge(2, sd_image_timing.program_us);	// the stop token
+	charge(1, 0);
+	sd_image_stats.sectors_written += count;
+	return RES_OK;
+}
+
+DRESULT TM_FATFS_SD_disk_ioctl(BYTE cmd, void *buff) {
+	if (!image) return RES_NOTRDY;
+	switch (cmd) {
+		case CTRL_SYNC:
+			return RES_OK;
+		case GET_SECTOR_COUNT:
+			*(DWORD *)buff = image_sectors;
+			return RES_OK;
+		case GET_SECTOR_SIZE:
+			*(WORD *)buff = 512;
+			return RES_OK;
+		case GET_BLOCK_SIZE:
+			*(DWORD *)buff = 1;
+			return RES_OK;
+	}
+	return RES_PARERR;
+}
@@ -0,0 +1,36 @@
+#ifndef SD_IMAGE_H
+#define SD_IMAGE_H
+
+#include <stdint.h>
+
+/* A FAT16/FAT32 card image held in memory, standing in for the SD card behind
+ * diskio.c. Every transfer is costed as fatfs_sd.c would clock it over SPI,
+ * and the time is added to DWT->CYCCNT so the firmware's own profile phases
+ * see it too. Writes only change the copy in memory.
+ */
+typedef struct {
+	uint32_t spi_hz;		// SPI clock
+	uint32_t access_us;		// from a read command to its first data token
+	uint32_t block_gap_us;	// between the blocks of a multiple block read
+	uint32_t program_us;	// busy time after each block written
+} SD_IMAGE_TIMING;
+
+typedef struct {
+	uint32_t sectors_read;
+	uint32_t sectors_written;
+	uint32_t read_cmds;		// CMD17 and CMD18
+	uint32_t write_cmds;	// CMD24 and CMD25
+	uint64_t spi_bytes;
+	uint64_t ns;			// simulated time
+} SD_IMAGE_STATS;
+
+extern SD_IMAGE_TIMING sd_image_timing;
+extern SD_IMAGE_STATS sd_image_stats;
+
+int sd_image_create(uint32_t sectors);
+int sd_image_load(const char *path);
+int sd_image_save(const char *path);
+void sd_image_free(void);
+void sd_image_reset_stats(void);
+
+#endif // SD_IMAGE_H
@@ -0,0 +1,47 @@
+/* The peripherals and linker symbols the firmware sources expect, as plain variables. */
+#include <string.h>
+
+#include "stm32f4xx.h"
+
+GPIO_TypeDef host_gpioc, host_gpiod, host_gpioe;
+RCC_TypeDef host_rcc = { RCC_CR_PLLRDY, 0 };
+FLASH_TypeDef host_flash;
+SysTick_Type host_systick;
+DWT_Type host_dwt;
+CoreDebug_Type host_coredebug;
+uint32_t host_crc;
+
+uint32_t SystemCoreClock = 168000000;
+
+uint32_t _sidata[1], _sdata[1], host_edata[1];
+uint32_t _siramfunc[1], _sramfunc[1], _eramfunc[1];
+uint32_t _sbss[1], _ebss[1];
+
+// flash sectors 10 and 11, erased at start
+#define HOST_SAVE_SECTOR_WORDS	(128 * 1024 / 4)
+uint32_t _ssave[2 * HOST_SAVE_SECTOR_WORDS];
+
+static void __attribute__((constructor)) host_flash_init(void) {
+	memset(_ssave, 0xFF, sizeof(_ssave));
+}
+
+void FLASH_Unlock(void) {}
+void FLASH_Lock(void) {}
+void FLASH_ClearFlag(uint32_t flags) { (void)flags; }
+
+// the erase the firmware starts through FLASH->CR, which a test has to do for it
+void host_flash_erase(int i) {
+	memset(_ssave + i * HOST_SAVE_SECTOR_WORDS, 0xFF, HOST_SAVE_SECTOR_WORDS * 4);
+}
+
+// like the flash, programming only clears bits
+FLASH_Status FLASH_ProgramWord(uintptr_t address, uint32_t data) {
+	uint32_t *p = (uint32_t *)address;
+	if (p < _ssave || p >= _ssave + 2 * HOST_SAVE_SECTOR_WORDS)
+		return FLASH_ERROR_WRP;
+	*p &= data;
+	return FLASH_COMPLETE;
+}
+
+void SystemInitStart(void) {}
+void SystemInitFinish(void) {}
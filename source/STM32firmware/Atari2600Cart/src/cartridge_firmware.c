@@ -1,37 +1,84 @@
 #include <string.h>
 
 #include "cartridge_firmware.h"
+#include "profile.h"
 
 #include "firmware_pal_rom.h"
 #include "firmware_pal60_rom.h"
 #include "firmware_ntsc_rom.h"
+#include "menu_font.h"
 
-static unsigned char menu_ram[1024];	// < NUM_DIR_ITEMS * 12
+static unsigned char menu_ram[1024];	// 12 bytes per item, zero terminated
 static char menu_status[16];
-static unsigned const char *firmware_rom = firmware_ntsc_rom;
+static uint8_t menu_jump[2];
+// the menu rom for the current tv mode, copied to SRAM so the kernel's reads don't wait on flash
+static unsigned char firmware_rom[4096];
+
+// 128 bytes per line (96 used) so the glyph window can be served without a bounds check
+static unsigned char menu_glyphs[GLYPH_LINES][128] __attribute__((section(".ccmram")));
+static unsigned char *glyph_line = menu_glyphs[GLYPH_LINE_BLANK];
+
+// render 12 characters of text into the font bytes the menu kernel reads for each one
+static void render_menu_line(int line, const char *text) {
+	unsigned char *dst = menu_glyphs[line];
+	for (int i = 0; i < 12; i++, dst += 8) {
+		// the high bit of the first character marks a directory
+		const unsigned char *glyph = menu_font + menu_font_lookup[text[i] & 0x7F] * 8;
+		memcpy(dst, glyph, 8);
+	}
+}
+
+void render_menu_items() {
+	for (int i = 0; i < MENU_WINDOW_ITEMS; i++)
+		render_menu_line(i, (char *)menu_ram + i*12);
+	render_menu_line(GLYPH_LINE_TITLE, "UNOCART 2600");
+	render_menu_line(GLYPH_LINE_STATUS, menu_status);
+	render_menu_line(GLYPH_LINE_BLANK, "            ");
+}
 
 void set_menu_status_msg(const char* message) {
-	strncpy(menu_status, message, 15);
+	strncpy(menu_status, message, 12);
+	render_menu_line(GLYPH_LINE_STATUS, menu_status);
+}
+
+void set_menu_item_count(uint8_t count) {
+	menu_status[13] = count;
+}
+
+void set_menu_status_flags(char flags) {
+	menu_status[14] = flags;
 }
 
 void set_menu_status_byte(char status_byte) {
 	menu_status[15] = status_byte;
 }
 
-void set_tv_mode(int tv_mode) {
-	switch (tv_mode) {
-		case TV_MODE_NTSC:
-			firmware_rom = firmware_ntsc_rom;
-			break;
+void set_menu_jump(uint8_t window, uint8_t item) {
+	menu_jump[0] = window;
+	menu_jump[1] = item;
+}
 
+// the bar is drawn straight from this byte, filled from the left in eighths
+void set_menu_progress(uint32_t done, uint32_t total) {
+	uint32_t eighths = total ? (done * 8) / total : 0;
+	if (eighths > 8) eighths = 8;
+	menu_status[12] = (uint8_t)(0xFF00 >> eighths);
+}
+
+// the menu rom image in flash, which the boot kernel serves before SRAM is set up
+const unsigned char *get_firmware_rom(int tv_mode) {
+	switch (tv_mode) {
 		case TV_MODE_PAL:
-			firmware_rom = firmware_pal_rom;
-			break;
+			return firmware_pal_rom;
 
 		case TV_MODE_PAL60:
-			firmware_rom = firmware_pal60_rom;
-			break;
+			return firmware_pal60_rom;
 	}
+	return firmware_ntsc_rom;
+}
+
+void set_tv_mode(int tv_mode) {
+	memcpy(firmware_rom, get_firmware_rom(tv_mode), sizeof(firmware_rom));
 }
 
 uint8_t* get_menu_ram() {
@@ -43,7 +90,57 @@ uint8_t* get_menu_ram() {
 // spurious reads until it has started the cartridge in 2600 mode.
 bool comms_enabled = false;
 
-int emulate_firmware_cartridge() {
+// Cleared once a cartridge has taken over the bus, after which any SD access (e.g. a
+// supercharger multiload) must leave the bus alone.
+static bool menu_running = true;
+
+// Keeps the menu going while the SD card is busy. This is a keep-alive, not a
+// scheduler: the card is still read in the foreground, one command at a time, and
+// the SD driver calls this from its wait loops (on the card, and on each DMA
+// transfer it has started) while the menu waits from 2600 RAM in its WaitCart or
+// CartCmd routine. Outside those waits the menu's reads go unanswered, and it
+// can't send another command before the one under way is done. The menu rom and
+// the status area are answered, all but $1000, which the menu reads to tell when
+// emulate_firmware_cartridge() is back. Running from RAM, the 6507 only gets to
+// the cart in the last cycle of an instruction whose three bytes it fetches from
+// RAM, so this returns at the start of the access after one to the cart: the
+// caller has those three bus cycles to check on the card before it calls again.
+// Interrupts are left as the caller had them.
+RAMFUNC void serve_busy_bus() {
+	uint16_t addr, addr_prev, addr_last = ADDR_IN;
+	if (!comms_enabled || !menu_running) return;
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();	// don't hold the bus through an interrupt
+	while (1)
+	{
+		// wait for the next access, the one under way may be half over
+		while ((addr = ADDR_IN) == addr_last) ;
+		do {
+			addr_prev = addr;
+			addr = ADDR_IN;
+		} while (addr != addr_prev);
+		// got a stable address
+		if (!(addr & 0x1000))
+		{
+			if (addr_last & 0x1000) break;	// the cart was just accessed
+		}
+		else if (addr != 0x1000)
+		{ // A12 high
+			if ((addr & 0x1FF0) == CART_STATUS_BYTES)
+				DATA_OUT = ((uint16_t)menu_status[addr&0xF])<<8;
+			else
+				DATA_OUT = ((uint16_t)firmware_rom[addr&0xFFF])<<8;
+			SET_DATA_MODE_OUT
+			// wait for address bus to change
+			while (ADDR_IN == addr) ;
+			SET_DATA_MODE_IN
+		}
+		addr_last = addr;
+	}
+	__set_PRIMASK(primask);
+}
+
+RAMFUNC int emulate_firmware_cartridge() {
 	__disable_irq();	// Disable interrupts
 	uint16_t addr, addr_prev = 0;
 	while (1)
@@ -56,11 +153,21 @@ int emulate_firmware_cartridge() {
 			if (comms_enabled)
 			{	// normal mode, once the cartridge code has done its init.
 				// on a 7800, we know we are in 2600 mode now.
-				if ((addr & 0x1F00) == 0x1E00) break;	// atari 2600 has sent a command
+				if (addr >= CART_CMD_WINDOW_n && addr < 0x1F00) break;	// atari 2600 has sent a command
 				if (addr >= 0x1800 && addr < 0x1C00)
 					DATA_OUT = ((uint16_t)menu_ram[addr&0x3FF])<<8;
+				else if ((addr & 0x1F80) == CART_GLYPH_WINDOW)
+					DATA_OUT = ((uint16_t)glyph_line[addr&0x7F])<<8;
+				else if ((addr & 0x1F80) == CART_GLYPH_LINE_n)
+				{
+					if ((addr & 0x7F) < GLYPH_LINES)
+						glyph_line = menu_glyphs[addr&0x7F];
+					DATA_OUT = ((uint16_t)firmware_rom[addr&0xFFF])<<8;
+				}
 				else if ((addr & 0x1FF0) == CART_STATUS_BYTES)
 					DATA_OUT = ((uint16_t)menu_status[addr&0xF])<<8;
+				else if ((addr & 0x1FFE) == CART_JUMP_BYTES)
+					DATA_OUT = ((uint16_t)menu_jump[addr&1])<<8;
 				else
 					DATA_OUT = ((uint16_t)firmware_rom[addr&0xFFF])<<8;
 				SET_DATA_MODE_OUT
@@ -87,8 +194,48 @@ int emulate_firmware_cartridge() {
 	return addr;
 }
 
+// Called by a cart kernel to leave the game for the menu, as the access after the
+// game's read of the console switches starts. That access is the fetch of the
+// game's next instruction, and if it is from the cart it is answered with a JMP to
+// the menu's reset vector: the menu starts over as after power on, and the first
+// command it sends is returned. A game running from its RAM isn't left, 0 is
+// returned for the kernel to carry on, and it is tried again on its next read.
+RAMFUNC int return_to_firmware_cartridge() {
+	uint16_t addr = ADDR_IN, addr_prev;
+	do {
+		addr_prev = addr;
+		addr = ADDR_IN;
+	} while (addr != addr_prev);
+	if (!(addr & 0x1000))
+		return 0;
+	uint8_t jmp[3] = { 0x4C, firmware_rom[0xFFC], firmware_rom[0xFFD] };
+	for (int i = 0; i < 3; )
+	{
+		if (addr & 0x1000)
+		{ // A12 high
+			DATA_OUT = ((uint16_t)jmp[i++])<<8;
+			SET_DATA_MODE_OUT
+			// wait for address bus to change
+			while (ADDR_IN == addr) ;
+			SET_DATA_MODE_IN
+		}
+		while ((addr = ADDR_IN) != addr_prev)
+			addr_prev = addr;
+	}
+	comms_enabled = false;
+	menu_running = true;
+	set_menu_status_byte(0);
+	return emulate_firmware_cartridge();
+}
+
 bool reboot_into_cartridge() {
+	profile_begin(PHASE_HANDSHAKE);
 	set_menu_status_byte(1);
 
-	return emulate_firmware_cartridge() == CART_CMD_START_CART;
+	if (emulate_firmware_cartridge() != CART_CMD_START_CART)
+		return false;
+	menu_running = false;
+	profile_end(PHASE_HANDSHAKE);
+	profile_launched();
+	return true;
 }
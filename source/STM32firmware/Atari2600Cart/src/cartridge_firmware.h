@@ -6,11 +6,36 @@
 
 #include "cartridge_io.h"
 
+#define CART_CMD_WINDOW_n	0x1D00
 #define CART_CMD_SEL_ITEM_n	0x1E00
+#define CART_CMD_NEXT_LETTER_n	0x1E40	// from item n of the window to the next first letter
+#define CART_CMD_PREV_LETTER_n	0x1E80	// and to the previous one
 #define CART_CMD_ROOT_DIR	0x1EF0
+#define CART_CMD_DIR_MORE	0x1EF1
+#define CART_CMD_BENCHMARK	0x1EF2	// reset and select together, not shown in the menu
 #define CART_CMD_START_CART	0x1EFF
 
-#define CART_STATUS_BYTES	0x1FE0	// 16 bytes of status
+// 16 bytes of status: a 12 character message, then the progress bar (12), the number of
+// items in the window (13), flags (14) and the reboot byte (15)
+#define CART_STATUS_BYTES	0x1FE0
+#define CART_STATUS_PROGRESS	(CART_STATUS_BYTES + 12)
+// the window and item a letter jump landed on
+#define CART_JUMP_BYTES		0x1FDE
+
+#define STATUS_DIR_GROWING	0x01	// the directory is still being read
+#define STATUS_MORE_WINDOWS	0x02	// there are items after the current window
+
+#define MENU_WINDOW_ITEMS	63	// items in menu_ram, a multiple of the 7 or 9 shown per screen
+
+// Every line of the menu is pre-rendered into font bytes. Reading CART_GLYPH_LINE_n+n
+// selects line n (a menu_ram item, or one of the lines below) and CART_GLYPH_WINDOW then
+// serves its 12 characters, 8 bytes each, ready for the menu kernel to store to the sprites.
+#define CART_GLYPH_LINE_n	0x1480
+#define CART_GLYPH_WINDOW	0x1500
+#define GLYPH_LINE_TITLE	MENU_WINDOW_ITEMS
+#define GLYPH_LINE_STATUS	(MENU_WINDOW_ITEMS + 1)
+#define GLYPH_LINE_BLANK	(MENU_WINDOW_ITEMS + 2)
+#define GLYPH_LINES			(MENU_WINDOW_ITEMS + 3)
 
 #define TV_MODE_NTSC	1
 #define TV_MODE_PAL     2
@@ -18,14 +43,57 @@
 
 void set_menu_status_msg(const char* message);
 
+void render_menu_items();
+
+void set_menu_item_count(uint8_t count);
+
+void set_menu_status_flags(char flags);
+
 void set_menu_status_byte(char status_byte);
 
+void set_menu_progress(uint32_t done, uint32_t total);
+
+void set_menu_jump(uint8_t window, uint8_t item);
+
+void serve_busy_bus();
+
+const unsigned char *get_firmware_rom(int tv_mode);
+
 void set_tv_mode(int tv_mode);
 
 uint8_t* get_menu_ram();
 
+extern bool comms_enabled;
+
 int emulate_firmware_cartridge();
 
 bool reboot_into_cartridge();
 
+int return_to_firmware_cartridge();
+
+// the game reading the console switches (SWCHB, $0282 and its mirrors), and the
+// reset switch in it, as read from the data pins
+#define IS_SWCHB(addr)	(((addr) & 0x1287) == 0x0282)
+#define SWCHB_RESET		0x0100
+
+extern int boot_command;
+extern uint32_t reset_hold_cycles, reset_held, reset_last;
+
+// for the cart kernels, once the game's read of the switches is in data_prev and the
+// read before it in switches: holding reset down goes back to the menu (see Leaving
+// a Game in main.c)
+#define cart_switches_read() \
+	if (~(switches | data_prev) & SWCHB_RESET) { \
+		uint32_t now = DWT->CYCCNT; \
+		reset_held = reset_held ? reset_held + (now - reset_last) : 1; \
+		reset_last = now; \
+		if (reset_held > reset_hold_cycles && (boot_command = return_to_firmware_cartridge())) { \
+			__enable_irq(); \
+			return; \
+		} \
+	} \
+	else \
+		reset_held = 0; \
+	switches = data_prev;
+
 #endif // CARTRIDGE_FIRMWARE_H
@@ -10,4 +10,8 @@
 #define SET_DATA_MODE_IN GPIOE->MODER = 0x00000000;
 #define SET_DATA_MODE_OUT GPIOE->MODER = 0x55550000;
 
+// Bus kernels run from SRAM, copied there by the Reset_Handler, so that their timing
+// doesn't depend on flash wait states and ART cache misses.
+#define RAMFUNC __attribute__((section(".ramfunc"), noinline))
+
 #endif // CARTRIDGE_IO_H
@@ -109,13 +109,13 @@ static void load_multiload(uint8_t *ram, uint8_t *rom, uint8_t physical_index, c
 	rom[0x7f3] = header->entry_hi;
 }
 
-void emulate_supercharger_cartridge(const char* cartridge_path, unsigned int image_size, uint8_t* buffer, int tv_mode) {
+RAMFUNC void emulate_supercharger_cartridge(const char* cartridge_path, unsigned int image_size, uint8_t* buffer, int tv_mode) {
 	uint8_t *ram = buffer;
 	uint8_t *rom = ram + 0x1800;
 	uint8_t *multiload_map = rom + 0x0800;
 	uint8_t *multiload_buffer = multiload_map + 0x0100;
 
-	uint16_t addr = 0, addr_prev = 0, addr_prev2 = 0, last_address = 0, data_prev = 0, data = 0;
+	uint16_t addr = 0, addr_prev = 0, addr_prev2 = 0, last_address = 0, data_prev = 0, data = 0, switches = 0xFFFF;
 
 	uint8_t *bank0 = ram, *bank1 = rom;
 	uint32_t transition_count = 0;
@@ -140,7 +140,13 @@ void emulate_supercharger_cartridge(const char* cartridge_path, unsigned int ima
 			addr_prev = addr;
 		}
 
-		if (!(addr & 0x1000)) goto finish_cycle;
+		if (!(addr & 0x1000)) {
+			if (IS_SWCHB(addr)) {	// the game reading the console switches
+				while (ADDR_IN == addr) { data_prev = data; data = DATA_IN; }
+				cart_switches_read();
+			}
+			goto finish_cycle;
+		}
 
 		if (write_ram_enabled && transition_count == 5 && (addr < 0x1800 || bank1 != rom))
 			value_out = data_hold;
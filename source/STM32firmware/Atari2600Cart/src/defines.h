@@ -35,4 +35,11 @@
 #define FATFS_SPI				SPI2
 #define FATFS_SPI_PINSPACK		TM_SPI_PinsPack_2
 
+/* SPI2 RX/TX DMA requests, RM0090 table 42 */
+#define FATFS_SPI_DMA_RCC			RCC_AHB1Periph_DMA1
+#define FATFS_SPI_DMA_CHANNEL		DMA_Channel_0
+#define FATFS_SPI_DMA_RX_STREAM		DMA1_Stream3
+#define FATFS_SPI_DMA_RX_FLAG_TC	DMA_FLAG_TCIF3
+#define FATFS_SPI_DMA_TX_STREAM		DMA1_Stream4
+
 #endif
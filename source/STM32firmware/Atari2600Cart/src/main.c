@@ -30,12 +30,16 @@
 #include "stm32f4xx.h"
 #include "tm_stm32f4_fatfs.h"
 #include "tm_stm32f4_delay.h"
+#include "fatfs_sd.h"
 
 #include <ctype.h>
+#include <stdlib.h>
 
 #include "cartridge_io.h"
 #include "cartridge_firmware.h"
 #include "cartridge_supercharger.h"
+#include "unpack.h"
+#include "profile.h"
 
 /*************************************************************************
  * Cartridge Definitions
@@ -44,10 +48,11 @@
 #define MAX_CART_RAM_SIZE	32	// in kilobytes, historical to be removed
 #define BUFFER_SIZE			96  // kilobytes
 
-uint8_t buffer[BUFFER_SIZE * 1024];
+uint8_t buffer[BUFFER_SIZE * 1024] __attribute__((section(".noinit")));	// not zeroed at boot
 
 char cartridge_image_path[256];
 unsigned int cart_size_bytes;
+uint32_t cart_crc;	// CRC-32 of the image, before any patches
 int tv_mode;
 
 #define CART_TYPE_NONE	0
@@ -72,6 +77,7 @@ int tv_mode;
 #define CART_TYPE_E7	19	// 16k+ram
 #define CART_TYPE_DPC	20	// 8k+DPC(2k)
 #define CART_TYPE_AR	21  // Arcadia Supercharger (variable size)
+#define CART_TYPE_FA2	22	// 24k/28k+ram, saving the ram to flash
 
 typedef struct {
 	const char *ext;
@@ -103,6 +109,7 @@ EXT_TO_CART_TYPE_MAP ext_to_cart_type_map[] = {
 	{"E7", CART_TYPE_E7},
 	{"DPC", CART_TYPE_DPC},
 	{"AR", CART_TYPE_AR},
+	{"FA2", CART_TYPE_FA2},
 	{0,0}
 };
 
@@ -127,174 +134,443 @@ int isProbablySC(int size, unsigned char *bytes)
 	return 1;
 }
 
-int searchForBytes(unsigned char *bytes, int size, unsigned char *signature, int sigsize, int minhits)
-{
-	int count = 0;
-	for(int i = 0; i < size - sigsize; ++i)
-	{
-		int matches = 0;
-		for(int j = 0; j < sigsize; ++j)
-		{
-			if(bytes[i+j] == signature[j])
-				++matches;
-			else
-				break;
+/* Signature Scan
+ * The detection routines below look for byte signatures, most of them from the
+ * MESS project. Rather than searching the image once per signature, all of them
+ * are counted in one pass, by an Aho-Corasick automaton built on first use: a
+ * trie of the signatures in which each state also links to the state for the
+ * longest suffix of its bytes that is a trie prefix (the "fail" link), so the
+ * scan never backs up. The links are folded into a full transition table, over
+ * classes of bytes (one per byte that appears in a signature, one for all the
+ * others) to keep it small, so each byte of the image costs one lookup. The
+ * table lives in CCM RAM, which the CPU reads without wait states.
+ * The hits are counted as Stella's searchForBytes() does: a match is skipped if
+ * it starts within a byte past the end of the previous match of the same
+ * signature, or at the very last position it could be found.
+ */
+#define SIG_MAX_LEN		5
+#define SIG_MAX_STATES	80
+#define SIG_MAX_CLASSES	48
+
+typedef struct {
+	uint8_t len;
+	uint8_t bytes[SIG_MAX_LEN];
+} CART_SIGNATURE;
+
+// first signature of each detection routine
+#define SIG_F8		0
+#define SIG_FE		1
+#define SIG_3F		5
+#define SIG_3E		6
+#define SIG_E0		7
+#define SIG_0840	15
+#define SIG_CV		20
+#define SIG_EF		22
+#define SIG_E7		26
+#define SIG_COUNT	33
+
+const CART_SIGNATURE cart_signatures[SIG_COUNT] = {
+	{ 3, { 0x8D, 0xF9, 0x1F } },  // STA $1FF9
+	// FE
+	{ 5, { 0x20, 0x00, 0xD0, 0xC6, 0xC5 } },  // JSR $D000; DEC $C5
+	{ 5, { 0x20, 0xC3, 0xF8, 0xA5, 0x82 } },  // JSR $F8C3; LDA $82
+	{ 5, { 0xD0, 0xFB, 0x20, 0x73, 0xFE } },  // BNE $FB; JSR $FE73
+	{ 5, { 0x20, 0x00, 0xF0, 0x84, 0xD6 } },  // JSR $F000; STY $D6
+	// 3F
+	{ 2, { 0x85, 0x3F } },  // STA $3F
+	// 3E
+	{ 4, { 0x85, 0x3E, 0xA9, 0x00 } },  // STA $3E; LDA #$00
+	// E0
+	{ 3, { 0x8D, 0xE0, 0x1F } },  // STA $1FE0
+	{ 3, { 0x8D, 0xE0, 0x5F } },  // STA $5FE0
+	{ 3, { 0x8D, 0xE9, 0xFF } },  // STA $FFE9
+	{ 3, { 0x0C, 0xE0, 0x1F } },  // NOP $1FE0
+	{ 3, { 0xAD, 0xE0, 0x1F } },  // LDA $1FE0
+	{ 3, { 0xAD, 0xE9, 0xFF } },  // LDA $FFE9
+	{ 3, { 0xAD, 0xED, 0xFF } },  // LDA $FFED
+	{ 3, { 0xAD, 0xF3, 0xBF } },  // LDA $BFF3
+	// 0840
+	{ 3, { 0xAD, 0x00, 0x08 } },  // LDA $0800
+	{ 3, { 0xAD, 0x40, 0x08 } },  // LDA $0840
+	{ 3, { 0x2C, 0x00, 0x08 } },  // BIT $0800
+	{ 4, { 0x0C, 0x00, 0x08, 0x4C } },  // NOP $0800; JMP ...
+	{ 4, { 0x0C, 0xFF, 0x0F, 0x4C } },  // NOP $0FFF; JMP ...
+	// CV
+	{ 3, { 0x9D, 0xFF, 0xF3 } },  // STA $F3FF.X
+	{ 3, { 0x99, 0x00, 0xF4 } },  // STA $F400.Y
+	// EF
+	{ 3, { 0x0C, 0xE0, 0xFF } },  // NOP $FFE0
+	{ 3, { 0xAD, 0xE0, 0xFF } },  // LDA $FFE0
+	{ 3, { 0x0C, 0xE0, 0x1F } },  // NOP $1FE0
+	{ 3, { 0xAD, 0xE0, 0x1F } },  // LDA $1FE0
+	// E7
+	{ 3, { 0xAD, 0xE2, 0xFF } },  // LDA $FFE2
+	{ 3, { 0xAD, 0xE5, 0xFF } },  // LDA $FFE5
+	{ 3, { 0xAD, 0xE5, 0x1F } },  // LDA $1FE5
+	{ 3, { 0xAD, 0xE7, 0x1F } },  // LDA $1FE7
+	{ 3, { 0x0C, 0xE7, 0x1F } },  // NOP $1FE7
+	{ 3, { 0x8D, 0xE7, 0xFF } },  // STA $FFE7
+	{ 3, { 0x8D, 0xE7, 0x1F } }   // STA $1FE7
+};
+
+typedef struct {
+	uint8_t byte_class[256];	// 0 for bytes in no signature
+	uint8_t next[SIG_MAX_STATES][SIG_MAX_CLASSES];
+	uint8_t depth[SIG_MAX_STATES];
+	uint8_t output[SIG_MAX_STATES];	// the signature ending here +1, others through next_output
+	uint8_t dict[SIG_MAX_STATES];	// nearest state down the fail links with an output
+	uint8_t report[SIG_MAX_STATES];	// the state itself if it has an output, else dict
+	uint8_t next_output[SIG_COUNT];
+	int num_states;
+} SIG_AUTOMATON;
+
+SIG_AUTOMATON sig_automaton __attribute__((section(".ccmram")));
+
+typedef struct {
+	uint32_t pos;	// bytes scanned so far
+	uint32_t size;	// bytes that will be scanned in all
+	int state;
+	uint8_t hits[SIG_COUNT];	// stops counting at 2, no signature needs more
+	uint32_t next_start[SIG_COUNT];	// where the next hit may start
+} SIG_SCAN;
+
+void sig_build() {
+	SIG_AUTOMATON *ac = &sig_automaton;
+	uint8_t queue[SIG_MAX_STATES], fail[SIG_MAX_STATES];
+	int num_classes = 1;
+	memset(ac, 0, sizeof(SIG_AUTOMATON));
+	ac->num_states = 1;
+	// the trie
+	for (int i = 0; i < SIG_COUNT; i++) {
+		int state = 0;
+		for (int j = 0; j < cart_signatures[i].len; j++) {
+			uint8_t c = cart_signatures[i].bytes[j];
+			if (!ac->byte_class[c])
+				ac->byte_class[c] = num_classes++;
+			uint8_t *next = &ac->next[state][ac->byte_class[c]];
+			if (!*next) {
+				*next = ac->num_states++;
+				ac->depth[*next] = j + 1;
+			}
+			state = *next;
 		}
-		if(matches == sigsize)
-		{
-			++count;
-			i += sigsize;  // skip past this signature 'window' entirely
+		ac->next_output[i] = ac->output[state];
+		ac->output[state] = i + 1;
+	}
+	// breadth first, each state's fail link is done before its children need it.
+	// missing transitions take the fail state's, so the scan never follows links
+	int head = 0, tail = 0;
+	queue[tail++] = 0;
+	fail[0] = 0;
+	while (head < tail) {
+		int state = queue[head++];
+		for (int k = 0; k < num_classes; k++) {
+			int s = ac->next[state][k];
+			if (s && ac->depth[s] == ac->depth[state] + 1) {
+				int f = state ? ac->next[fail[state]][k] : 0;
+				fail[s] = f;
+				ac->dict[s] = ac->output[f] ? f : ac->dict[f];
+				ac->report[s] = ac->output[s] ? s : ac->dict[s];
+				queue[tail++] = s;
+			}
+			else if (state)
+				ac->next[state][k] = ac->next[fail[state]][k];
 		}
-		if(count >= minhits)
-			break;
 	}
-	return (count >= minhits);
 }
 
-int isProbablyFE(int size, unsigned char *bytes)
-{	// These signatures are attributed to the MESS project
-	unsigned char signature[4][5] = {
-		{ 0x20, 0x00, 0xD0, 0xC6, 0xC5 },  // JSR $D000; DEC $C5
-		{ 0x20, 0xC3, 0xF8, 0xA5, 0x82 },  // JSR $F8C3; LDA $82
-		{ 0xD0, 0xFB, 0x20, 0x73, 0xFE },  // BNE $FB; JSR $FE73
-		{ 0x20, 0x00, 0xF0, 0x84, 0xD6 }   // JSR $F000; STY $D6
-	};
-	for (int i = 0; i < 4; ++i)
-		if(searchForBytes(bytes, size, signature[i], 5, 1))
-			return 1;
+// starts a scan of size bytes
+void sig_scan_init(SIG_SCAN *scan, uint32_t size) {
+	if (sig_automaton.num_states == 0)
+		sig_build();
+	memset(scan, 0, sizeof(SIG_SCAN));
+	scan->size = size;
+}
+
+// scans the next len bytes of the image
+void sig_scan(SIG_SCAN *scan, unsigned char *bytes, unsigned int len) {
+	SIG_AUTOMATON *ac = &sig_automaton;
+	int state = scan->state;
+	uint32_t pos = scan->pos;
+	for (unsigned int i = 0; i < len; i++, pos++) {
+		state = ac->next[state][ac->byte_class[bytes[i]]];
+		// every signature ending here
+		for (int o = ac->report[state]; o; o = ac->dict[o]) {
+			int depth = ac->depth[o];
+			uint32_t start = pos + 1 - depth;
+			if (start + depth >= scan->size)
+				continue;	// searchForBytes() stops short of the last position
+			for (int sig = ac->output[o]; sig; sig = ac->next_output[sig - 1]) {
+				if (start < scan->next_start[sig - 1] || scan->hits[sig - 1] == 2)
+					continue;
+				scan->hits[sig - 1]++;
+				scan->next_start[sig - 1] = start + depth + 1;
+			}
+		}
+	}
+	scan->state = state;
+	scan->pos = pos;
+}
 
+// do any of the count signatures from first have minhits hits?
+int sig_found(SIG_SCAN *scan, int first, int count, int minhits) {
+	for (int i = first; i < first + count; i++)
+		if (scan->hits[i] >= minhits) return 1;
 	return 0;
 }
 
-int isProbably3F(int size, unsigned char *bytes)
+// the sizes detect_cart_type() needs signature counts for, the rest go by size alone
+int sig_scan_needed(uint32_t image_size) {
+	return image_size == 2*1024 || image_size == 8*1024 || image_size == 16*1024 ||
+		image_size == 32*1024 || image_size == 64*1024;
+}
+
+int isProbablyFE(SIG_SCAN *scan)
+{	// These signatures are attributed to the MESS project
+	return sig_found(scan, SIG_FE, 4, 1);
+}
+
+int isProbably3F(SIG_SCAN *scan)
 {	// 3F cart bankswitching is triggered by storing the bank number
 	// in address 3F using 'STA $3F'
 	// We expect it will be present at least 2 times, since there are
 	// at least two banks
-	unsigned char signature[] = { 0x85, 0x3F };  // STA $3F
-	return searchForBytes(bytes, size, signature, 2, 2);
+	return sig_found(scan, SIG_3F, 1, 2);
 }
 
-int isProbably3E(int size, unsigned char *bytes)
+int isProbably3E(SIG_SCAN *scan)
 {	// 3E cart bankswitching is triggered by storing the bank number
 	// in address 3E using 'STA $3E', commonly followed by an
 	// immediate mode LDA
-	unsigned char  signature[] = { 0x85, 0x3E, 0xA9, 0x00 };  // STA $3E; LDA #$00
-	return searchForBytes(bytes, size, signature, 4, 1);
+	return sig_found(scan, SIG_3E, 1, 1);
 }
 
-int isProbablyE0(int size, unsigned char *bytes)
+int isProbablyE0(SIG_SCAN *scan)
 {	// E0 cart bankswitching is triggered by accessing addresses
 	// $FE0 to $FF9 using absolute non-indexed addressing
 	// These signatures are attributed to the MESS project
-	unsigned char signature[8][3] = {
-			{ 0x8D, 0xE0, 0x1F },  // STA $1FE0
-			{ 0x8D, 0xE0, 0x5F },  // STA $5FE0
-			{ 0x8D, 0xE9, 0xFF },  // STA $FFE9
-			{ 0x0C, 0xE0, 0x1F },  // NOP $1FE0
-			{ 0xAD, 0xE0, 0x1F },  // LDA $1FE0
-			{ 0xAD, 0xE9, 0xFF },  // LDA $FFE9
-			{ 0xAD, 0xED, 0xFF },  // LDA $FFED
-			{ 0xAD, 0xF3, 0xBF }   // LDA $BFF3
-		};
-	for (int i = 0; i < 8; ++i)
-		if(searchForBytes(bytes, size, signature[i], 3, 1))
-			return 1;
-	return 0;
+	return sig_found(scan, SIG_E0, 8, 1);
 }
 
-int isProbably0840(int size, unsigned char *bytes)
+int isProbably0840(SIG_SCAN *scan)
 {	// 0840 cart bankswitching is triggered by accessing addresses 0x0800
 	// or 0x0840 at least twice
-	unsigned char signature1[3][3] = {
-			{ 0xAD, 0x00, 0x08 },  // LDA $0800
-			{ 0xAD, 0x40, 0x08 },  // LDA $0840
-			{ 0x2C, 0x00, 0x08 }   // BIT $0800
-		};
-	for (int i = 0; i < 3; ++i)
-		if(searchForBytes(bytes, size, signature1[i], 3, 2))
-			return 1;
-
-	unsigned char signature2[2][4] = {
-			{ 0x0C, 0x00, 0x08, 0x4C },  // NOP $0800; JMP ...
-			{ 0x0C, 0xFF, 0x0F, 0x4C }   // NOP $0FFF; JMP ...
-		};
-	for (int i = 0; i < 2; ++i)
-		if(searchForBytes(bytes, size, signature2[i], 4, 2))
-			return 1;
-
-	return 0;
+	return sig_found(scan, SIG_0840, 5, 2);
 }
 
-int isProbablyCV(int size, unsigned char *bytes)
+int isProbablyCV(SIG_SCAN *scan)
 { 	// CV RAM access occurs at addresses $f3ff and $f400
 	// These signatures are attributed to the MESS project
-	unsigned char signature[2][3] = {
-			{ 0x9D, 0xFF, 0xF3 },  // STA $F3FF.X
-			{ 0x99, 0x00, 0xF4 }   // STA $F400.Y
-		};
-	for (int i = 0; i < 2; ++i)
-		if(searchForBytes(bytes, size, signature[i], 3, 1))
-			return 1;
-	return 0;
+	return sig_found(scan, SIG_CV, 2, 1);
 }
 
-int isProbablyEF(int size, unsigned char *bytes)
+int isProbablyEF(SIG_SCAN *scan)
 { 	// EF cart bankswitching switches banks by accessing addresses
 	// 0xFE0 to 0xFEF, usually with either a NOP or LDA
 	// It's likely that the code will switch to bank 0, so that's what is tested
-	unsigned char signature[4][3] = {
-			{ 0x0C, 0xE0, 0xFF },  // NOP $FFE0
-			{ 0xAD, 0xE0, 0xFF },  // LDA $FFE0
-			{ 0x0C, 0xE0, 0x1F },  // NOP $1FE0
-			{ 0xAD, 0xE0, 0x1F }   // LDA $1FE0
-		};
-	for (int i = 0; i < 4; ++i)
-		if(searchForBytes(bytes, size, signature[i], 3, 1))
-			return 1;
-	return 0;
+	return sig_found(scan, SIG_EF, 4, 1);
 }
 
-int isProbablyE7(int size, unsigned char *bytes)
+int isProbablyE7(SIG_SCAN *scan)
 { 	// These signatures are attributed to the MESS project
-	unsigned char signature[7][3] = {
-			{ 0xAD, 0xE2, 0xFF },  // LDA $FFE2
-			{ 0xAD, 0xE5, 0xFF },  // LDA $FFE5
-			{ 0xAD, 0xE5, 0x1F },  // LDA $1FE5
-			{ 0xAD, 0xE7, 0x1F },  // LDA $1FE7
-			{ 0x0C, 0xE7, 0x1F },  // NOP $1FE7
-			{ 0x8D, 0xE7, 0xFF },  // STA $FFE7
-			{ 0x8D, 0xE7, 0x1F }   // STA $1FE7
-		};
-	for (int i = 0; i < 7; ++i)
-		if(searchForBytes(bytes, size, signature[i], 3, 1))
-			return 1;
-	return 0;
+	return sig_found(scan, SIG_E7, 7, 1);
 }
 
 /*************************************************************************
  * File/Directory Handling
  *************************************************************************/
 
-#define NUM_DIR_ITEMS	80
+/* The directory listing is built in the cartridge buffer, which is free while
+ * the menu is running. The buffer starts with room for DIR_MAX_ENTRIES entries,
+ * the rest is a string arena, so a folder can hold as many entries as their
+ * names fit. Each entry is a 32-bit word of flags plus the offset of its names
+ * in the arena: the short filename, followed by the long filename (if it has
+ * one that differs, truncated to DIR_MAX_LFN). Entries and names only ever
+ * grow at the end, so a listing can be shown while it is still being read.
+ * A folder with more entries than fit is listed as far as they do, ending with
+ * a note entry, "(LIST FULL)", that selecting does nothing; add_dir_entry()
+ * keeps room for it.
+ */
+#define DIR_ENTRY_IS_DIR	0x80000000
+#define DIR_ENTRY_HAS_LFN	0x40000000
+#define DIR_ENTRY_IS_NOTE	0x20000000
+#define DIR_ENTRY_OFFSET	0x00FFFFFF
+#define DIR_MAX_LFN			31
+#define DIR_MAX_ENTRIES		4096
+#define DIR_NAMES_SIZE		(BUFFER_SIZE * 1024 - DIR_MAX_ENTRIES * sizeof(DIR_ENTRY))
+#define DIR_FULL_NOTE		"(LIST FULL)"
+#define DIR_FULL_NOTE_SIZE	(sizeof(DIR_FULL_NOTE) + 1)	// with its empty short name
 
-typedef struct {
-	char isDir;
-	char filename[13];
-	char long_filename[32];
-} DIR_ENTRY;
+typedef uint32_t DIR_ENTRY;
 
-DIR_ENTRY dir_entries[NUM_DIR_ITEMS];
+DIR_ENTRY *dir_entries = (DIR_ENTRY *)buffer;
+char *dir_names = (char *)buffer + DIR_MAX_ENTRIES * sizeof(DIR_ENTRY);	// string arena
 
 int num_dir_entries = 0; // how many entries in the current directory
+int dir_names_size = 0;	// bytes used in the string arena
+int dir_full = 0;	// an entry of the listing being built didn't fit
 
-int entry_compare(const void* p1, const void* p2)
-{
-	DIR_ENTRY* e1 = (DIR_ENTRY*)p1;
-	DIR_ENTRY* e2 = (DIR_ENTRY*)p2;
-	if (e1->isDir && !e2->isDir) return -1;
-	else if (!e1->isDir && e2->isDir) return 1;
-	else return strcasecmp(e1->long_filename, e2->long_filename);
+int dir_entry_is_dir(DIR_ENTRY e) {
+	return (e & DIR_ENTRY_IS_DIR) != 0;
+}
+
+char *dir_entry_filename(DIR_ENTRY e) {
+	return dir_names + (e & DIR_ENTRY_OFFSET);
+}
+
+char *dir_entry_long_filename(DIR_ENTRY e) {
+	char *name = dir_entry_filename(e);
+	if (e & DIR_ENTRY_HAS_LFN)
+		name += strlen(name) + 1;
+	return name;
+}
+
+/* Sorting
+ * Folders come first, then files, each ordered by long filename as strcasecmp
+ * would. Rather than comparing names, each entry gets a 32-bit key holding four
+ * characters of its name, lower-cased and packed so that comparing keys as
+ * integers orders the names. An LSD radix sort orders the keys together with
+ * 16-bit entry indexes. Short runs of equal keys are finished with strcasecmp,
+ * longer ones (e.g. a set of "Activision - ..." roms) are re-keyed with the next
+ * four characters and radix sorted again. The names never move: the entry words
+ * are gathered into their final order at the end.
+ * The key and index arrays live in CCM RAM, sized for DIR_MAX_ENTRIES.
+ */
+#define SORT_MIN_RADIX_RUN	16
+
+uint32_t sort_keys[2][DIR_MAX_ENTRIES] __attribute__((section(".ccmram")));
+uint16_t sort_index[2][DIR_MAX_ENTRIES] __attribute__((section(".ccmram")));
+
+// characters 4*depth to 4*depth+3 of the long filename, zero padded
+uint32_t dir_sort_key(DIR_ENTRY e, int depth) {
+	unsigned char *name = (unsigned char *)dir_entry_long_filename(e);
+	uint32_t key = 0;
+	for (int i = 0; i < depth * 4 && *name; i++)
+		name++;
+	for (int i = 0; i < 4; i++) {
+		key <<= 8;
+		if (*name) key |= tolower(*name++);
+	}
+	return key;
+}
+
+// sorts the entries in sort_index[0][start..end), by characters from 4*depth on
+void sort_range(int start, int end, int depth) {
+	static int count[256];
+	int src = 0;
+
+	for (int i = start; i < end; i++)
+		sort_keys[0][i] = dir_sort_key(dir_entries[sort_index[0][i]], depth);
+
+	for (int shift = 0; shift < 32; shift += 8) {
+		uint32_t *keys = sort_keys[src], *dst_keys = sort_keys[src ^ 1];
+		uint16_t *index = sort_index[src], *dst_index = sort_index[src ^ 1];
+		memset(count, 0, sizeof(count));
+		for (int i = start; i < end; i++)
+			count[(keys[i] >> shift) & 0xFF]++;
+		if (count[(keys[start] >> shift) & 0xFF] == end - start)
+			continue;	// all keys share this byte
+		for (int b = 0, pos = start; b < 256; b++) {
+			int n = count[b];
+			count[b] = pos;
+			pos += n;
+		}
+		for (int i = start; i < end; i++) {
+			int pos = count[(keys[i] >> shift) & 0xFF]++;
+			dst_keys[pos] = keys[i];
+			dst_index[pos] = index[i];
+		}
+		src ^= 1;
+	}
+	if (src) {
+		memcpy(&sort_keys[0][start], &sort_keys[1][start], (end - start) * sizeof(uint32_t));
+		memcpy(&sort_index[0][start], &sort_index[1][start], (end - start) * sizeof(uint16_t));
+	}
+
+	// break ties between names with the same four characters
+	for (int i = start, j; i < end; i = j) {
+		uint32_t key = sort_keys[0][i];
+		for (j = i + 1; j < end && sort_keys[0][j] == key; j++);
+		if (j - i < 2 || !(key & 0xFF))
+			continue;	// unique, or the names end within the key
+		if (j - i >= SORT_MIN_RADIX_RUN) {
+			sort_range(i, j, depth + 1);
+			continue;
+		}
+		for (int k = i + 1; k < j; k++) {
+			uint16_t index = sort_index[0][k];
+			char *name = dir_entry_long_filename(dir_entries[index]);
+			int m = k;
+			for (; m > i && strcasecmp(dir_entry_long_filename(dir_entries[sort_index[0][m - 1]]), name) > 0; m--)
+				sort_index[0][m] = sort_index[0][m - 1];
+			sort_index[0][m] = index;
+		}
+	}
+}
+
+// sorts dir_entries[first..num_dir_entries), folders first
+void sort_directory(int first) {
+	profile_begin(PHASE_SORT);
+	int n = first;
+	for (int i = first; i < num_dir_entries; i++)
+		if (dir_entry_is_dir(dir_entries[i])) sort_index[0][n++] = i;
+	int num_dirs = n - first;
+	for (int i = first; i < num_dir_entries; i++)
+		if (!dir_entry_is_dir(dir_entries[i])) sort_index[0][n++] = i;
+
+	if (num_dirs > 1)
+		sort_range(first, first + num_dirs, 0);
+	if (num_dir_entries - first - num_dirs > 1)
+		sort_range(first + num_dirs, num_dir_entries, 0);
+
+	// gather the entries into sorted order
+	for (int i = first; i < num_dir_entries; i++)
+		sort_keys[1][i] = dir_entries[sort_index[0][i]];
+	memcpy(&dir_entries[first], &sort_keys[1][first], (num_dir_entries - first) * sizeof(DIR_ENTRY));
+	profile_end(PHASE_SORT);
+}
+
+/* First Letter Index
+ * Once a listing is sorted, one pass records where each first letter starts
+ * (0 for anything that isn't a letter, then A-Z) so the menu can jump between
+ * letters instead of paging through a large folder. Files take precedence over
+ * folders starting with the same letter, since folders are sorted first.
+ */
+#define DIR_LETTERS		27
+
+int dir_letter_index[DIR_LETTERS];
+int dir_letters_valid = 0;	// cleared while the listing is unsorted
+
+int dir_entry_letter(DIR_ENTRY e) {
+	int c = toupper((unsigned char)dir_entry_long_filename(e)[0]);
+	return (c >= 'A' && c <= 'Z') ? c - 'A' + 1 : 0;
+}
+
+void index_directory_letters() {
+	for (int l = 0; l < DIR_LETTERS; l++)
+		dir_letter_index[l] = -1;
+	for (int i = 0; i < num_dir_entries; i++) {
+		DIR_ENTRY e = dir_entries[i];
+		if (dir_entry_is_dir(e) && !strcmp(dir_entry_filename(e), ".."))
+			continue;
+		int *first = &dir_letter_index[dir_entry_letter(e)];
+		if (*first < 0 || (dir_entry_is_dir(dir_entries[*first]) && !dir_entry_is_dir(e)))
+			*first = i;
+	}
+	dir_letters_valid = 1;
+}
+
+// the nearest letter start after (or before) item, or item itself if there is none
+int jump_to_letter(int item, int forward) {
+	int best = item;
+	if (!dir_letters_valid) return item;
+	for (int l = 0; l < DIR_LETTERS; l++) {
+		int pos = dir_letter_index[l];
+		if (pos < 0 || pos == item || (pos > item) != forward) continue;
+		if (best == item || (forward ? pos < best : pos > best))
+			best = pos;
+	}
+	return best;
 }
 
 char *get_filename_ext(char *filename) {
@@ -303,7 +579,7 @@ char *get_filename_ext(char *filename) {
 	return dot + 1;
 }
 
-int is_valid_file(char *filename) {
+int is_rom_file(char *filename) {
 	char *ext = get_filename_ext(filename);
 	EXT_TO_CART_TYPE_MAP *p = ext_to_cart_type_map;
 	while (p->ext) {
@@ -314,250 +590,2092 @@ int is_valid_file(char *filename) {
 	return 0;
 }
 
+// roms, and roms in a .zip, .gz or .lz4 file
+int is_valid_file(char *filename) {
+	return is_rom_file(filename) || unpack_format(filename) != UNPACK_NONE;
+}
+
 // single FILINFO structure
 FILINFO fno;
 char lfn[_MAX_LFN + 1];   /* Buffer to store the LFN */
 
+// mounts the card, timing it for the profiler
+FRESULT mount_card(FATFS *fs) {
+	profile_begin(PHASE_MOUNT);
+	FRESULT res = f_mount(fs, "", 1);
+	profile_end(PHASE_MOUNT);
+	return res;
+}
+
 void init() {
 	// this seems to be required for this version of FAT FS
 	fno.lfname = lfn;
 	fno.lfsize = sizeof lfn;
+	// start the cycle counter, used to time directory scans
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
 }
 
-int read_directory(char *path) {
+/* Overlapped Detection
+ * While a rom loads, its signatures are counted in the part that has already
+ * arrived, during the time the SD driver spends waiting on the card and on DMA
+ * for the next chunk. Each wait callback scans at most LOAD_SCAN_SLICE bytes, in
+ * the bus cycles serve_busy_bus() returns in, when the menu leaves the cart
+ * alone, so its next access to the cart is still answered in time. The scan
+ * carries its state from one chunk to the next, so signatures straddling chunks
+ * are still counted. Roms of a size detect_cart_type() goes by alone aren't
+ * scanned at all.
+ */
+#define LOAD_SCAN_SLICE	4
+
+SIG_SCAN *load_scan = 0;	// set while a rom loads
+unsigned int load_scan_end;	// bytes that have arrived in the buffer
+
+// the SD driver calls this while it waits on the card, serve the menu while it waits
+// and get on with the detection
+void TM_FATFS_SD_WaitCallback(void) {
+	serve_busy_bus();
+	if (load_scan && load_scan->pos < load_scan_end) {
+		unsigned int len = load_scan_end - load_scan->pos;
+		if (len > LOAD_SCAN_SLICE) len = LOAD_SCAN_SLICE;
+		sig_scan(load_scan, buffer + load_scan->pos, len);
+	}
+}
+
+/* CRC-32
+ * Images are checksummed with the CRC-32 used by zip and rom databases. The CRC
+ * unit computes a different CRC-32 (MPEG-2: not bit reflected, no final xor) over
+ * 32-bit words, but feeding it bit-reversed words and reversing and inverting its
+ * result gives the same value, at about a cycle per byte. Bytes after the last
+ * whole word are added in software.
+ */
+void crc_start() {
+	RCC_AHB1PeriphClockCmd(RCC_AHB1Periph_CRC, ENABLE);
+	CRC_ResetDR();
+}
+
+// adds len bytes, a multiple of 4
+void crc_add_words(unsigned char *data, unsigned int len) {
+	uint32_t *words = (uint32_t *)data;
+	for (len /= 4; len; len--)
+		CRC_CalcCRC(__RBIT(*words++));
+}
+
+// software CRC-32, a nibble at a time
+uint32_t crc32_update(uint32_t crc, unsigned char *data, unsigned int len) {
+	static const uint32_t table[16] = {
+		0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+		0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+	};
+	crc = ~crc;
+	while (len--) {
+		crc ^= *data++;
+		crc = (crc >> 4) ^ table[crc & 0xF];
+		crc = (crc >> 4) ^ table[crc & 0xF];
+	}
+	return ~crc;
+}
+
+// the CRC of everything added, plus up to 3 trailing bytes
+uint32_t crc_result(unsigned char *tail, unsigned int len) {
+	return crc32_update(~__RBIT(CRC_GetCRC()), tail, len);
+}
+
+/* Directory Index Cache
+ * ---------------------
+ * Each listing built by read_directory() is saved, already filtered and sorted,
+ * to /.unocart/idx/<dir-cluster>.idx so that later visits to the same folder
+ * only cost one contiguous read instead of an f_readdir scan and a sort.
+ *
+ * An index is used only if its header matches the directory's start cluster,
+ * its modification stamp (date/time of the folder's own entry, none for the
+ * root), the CRC of the folder's first sectors and the card generation, and
+ * the file holds exactly the entries and string arena the header claims, which
+ * are read straight into the buffer in one go. A listing that ended on a card
+ * error is never saved.
+ * FAT does not reliably touch a folder's stamp when files are added to it, so
+ * the CRC covers what is in the folder itself: the raw entries of its first
+ * DIR_INDEX_CRC_SECTORS sectors (128 entries, all of a small folder), which
+ * changes with any rename, deletion or new entry there, whatever the sizes.
+ * Where FSINFO has a valid free cluster count (FAT32), the card generation
+ * also catches changes further into big folders: /.unocart/gen records the
+ * volume's free cluster count after our own last write, and any other value
+ * at mount time means the card was modified elsewhere. FAT16 volumes have only
+ * the CRC and the stamp. FAT12 volumes, which are read with f_readdir(), never
+ * use the cache.
+ *
+ * Nothing but the menu writes to the card while it is powered, so the CRC is
+ * only taken the first time a folder's index is used after power on (or when
+ * it is saved): dir_index_checked remembers those folders, and later visits to
+ * them check the cheap part of the key only, the start cluster, the stamp and
+ * the card generation. The stamp comes from the sector f_opendir() leaves in
+ * the window, and /.unocart/gen is only read again when the free cluster count
+ * isn't the one it was last read or written with, so such a visit reads no
+ * more than the folder's path and its index.
+ */
+#define DIR_INDEX_ROOT		"/.unocart"
+#define DIR_INDEX_DIR		"/.unocart/idx"
+#define DIR_INDEX_GEN_FILE	"/.unocart/gen"
+#define DIR_INDEX_MAGIC		0x58494355	// "UCIX"
+#define DIR_INDEX_VERSION	5
+#define DIR_INDEX_CRC_SECTORS	8
+#define DIR_INDEX_CHECKED	32	// folders remembered as checked since power on
+
+typedef struct {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t dir_date;
+	uint16_t dir_time;
+	uint16_t reserved;
+	uint32_t dir_cluster;
+	uint32_t card_gen;
+	uint32_t num_entries;
+	uint32_t names_size;
+	uint32_t dir_crc;	// of the folder's first sectors, see dir_index_crc()
+} DIR_INDEX_HEADER;
+
+typedef struct {
+	uint32_t free_clust;	// volume free cluster count after our last write
+	uint32_t gen;
+} DIR_INDEX_GEN;
+
+DIR_INDEX_GEN dir_index_gen;	// as last read or written, if dir_index_gen_valid
+int dir_index_gen_valid = 0;
+
+typedef struct {
+	uint32_t dir_cluster;
+	uint32_t card_gen;
+} DIR_INDEX_CHECK;
+
+DIR_INDEX_CHECK dir_index_checked[DIR_INDEX_CHECKED];
+int dir_index_checked_count = 0;	// entries used, the oldest are replaced first
+
+// whether the folder's index has been checked against its CRC since power on
+int dir_index_was_checked(uint32_t cluster, uint32_t card_gen) {
+	for (int i = 0; i < dir_index_checked_count && i < DIR_INDEX_CHECKED; i++)
+		if (dir_index_checked[i].dir_cluster == cluster && dir_index_checked[i].card_gen == card_gen)
+			return 1;
+	return 0;
+}
+
+void dir_index_mark_checked(uint32_t cluster, uint32_t card_gen) {
+	if (dir_index_was_checked(cluster, card_gen))
+		return;
+	DIR_INDEX_CHECK *check = &dir_index_checked[dir_index_checked_count++ % DIR_INDEX_CHECKED];
+	check->dir_cluster = cluster;
+	check->card_gen = card_gen;
+}
+
+void dir_index_filename(char *dst, uint32_t cluster) {
+	strcpy(dst, DIR_INDEX_DIR "/");
+	dst += strlen(dst);
+	for (int i = 7; i >= 0; i--)
+		*dst++ = "0123456789ABCDEF"[(cluster >> (i * 4)) & 0xF];
+	strcpy(dst, ".IDX");
+}
+
+// returns 0 if the volume can't tell us whether it has been modified
+int dir_index_read_gen(FATFS *fs, DIR_INDEX_GEN *gen) {
+	FIL fil;
+	UINT bytes_read;
+	if (fs->free_clust == 0xFFFFFFFF) return 0;
+	if (dir_index_gen_valid && dir_index_gen.free_clust == fs->free_clust) {
+		*gen = dir_index_gen;	// the file can't have changed
+		return 1;
+	}
+	gen->free_clust = 0xFFFFFFFF;
+	gen->gen = 0;
+	if (f_open(&fil, DIR_INDEX_GEN_FILE, FA_READ) == FR_OK) {
+		if (f_read(&fil, gen, sizeof(DIR_INDEX_GEN), &bytes_read) != FR_OK || bytes_read != sizeof(DIR_INDEX_GEN))
+			gen->free_clust = 0xFFFFFFFF;
+		f_close(&fil);
+	}
+	if (gen->free_clust == fs->free_clust) {
+		dir_index_gen = *gen;
+		dir_index_gen_valid = 1;
+	}
+	else
+		gen->gen++;	// card changed since our last write (or first use)
+	return 1;
+}
+
+// record the current free cluster count, so our own writes don't count as changes
+void dir_index_write_gen(FATFS *fs, DIR_INDEX_GEN *gen) {
+	FIL fil;
+	UINT bytes_written;
+	// creating the file may allocate a cluster, so repeat once with the new count
+	for (int i = 0; i < 2 && gen->free_clust != fs->free_clust; i++) {
+		gen->free_clust = fs->free_clust;
+		dir_index_gen_valid = 0;
+		if (f_open(&fil, DIR_INDEX_GEN_FILE, FA_WRITE | FA_OPEN_ALWAYS) != FR_OK)
+			return;
+		if (f_write(&fil, gen, sizeof(DIR_INDEX_GEN), &bytes_written) == FR_OK && bytes_written == sizeof(DIR_INDEX_GEN) &&
+			f_close(&fil) == FR_OK) {
+			dir_index_gen = *gen;
+			dir_index_gen_valid = 1;
+		}
+		else
+			f_close(&fil);
+	}
+}
+
+/* Folder Stack
+ * ------------
+ * Going into a folder pushes the one being left: its index header, to reload
+ * it by cluster without resolving its path, and the selected item, to put the
+ * menu back on it. If the listing is complete and fits, a copy of it is also
+ * kept at the top of the buffer (at most DIR_STACK_SIZE bytes in all), so
+ * "(GO BACK)" restores it without touching the SD card. The copies give way to
+ * a listing that needs their room, and to anything else loaded into the buffer.
+ * Going back remembers the folder that was left, so going straight back into
+ * it only reads its index.
+ */
+#define DIR_STACK_DEPTH		8
+#define DIR_STACK_SIZE		(32 * 1024)
+
+typedef struct {
+	DIR_INDEX_HEADER header;
+	int item;		// the selected entry
+	int num_entries;	// the saved listing, -1 if it wasn't kept
+	int names_size;
+	uint32_t offset;	// where it is kept in the buffer
+} DIR_STACK_LEVEL;
+
+DIR_STACK_LEVEL dir_stack[DIR_STACK_DEPTH];
+int dir_stack_depth = 0;
+int dir_stack_used = 0;	// bytes at the top of the buffer taken by saved listings
+DIR_INDEX_HEADER dir_stack_child;	// the folder we last went back from
+char dir_stack_child_name[13];
+
+// drops the saved listings, the levels remain
+void dir_stack_discard() {
+	for (int i = 0; i < dir_stack_depth; i++)
+		dir_stack[i].num_entries = -1;
+	dir_stack_used = 0;
+}
+
+void dir_stack_clear() {
+	dir_stack_depth = 0;
+	dir_stack_used = 0;
+	dir_stack_child_name[0] = 0;
+}
+
+// saves the current folder (complete if its letters are indexed) before going into a subfolder
+void dir_stack_push(DIR_INDEX_HEADER *header, int item, int complete) {
+	if (dir_stack_depth == DIR_STACK_DEPTH)
+	{	// forget the outermost folder, the rest have to be read again too
+		dir_stack_discard();
+		memmove(&dir_stack[0], &dir_stack[1], (DIR_STACK_DEPTH - 1) * sizeof(DIR_STACK_LEVEL));
+		dir_stack_depth--;
+	}
+	DIR_STACK_LEVEL *level = &dir_stack[dir_stack_depth++];
+	level->header = *header;
+	level->item = item;
+	level->num_entries = -1;
+	uint32_t size = num_dir_entries * sizeof(DIR_ENTRY) + dir_names_size;
+	uint32_t offset = BUFFER_SIZE * 1024 - dir_stack_used - size;
+	if (complete && dir_stack_used + size <= DIR_STACK_SIZE && offset >= (uint32_t)(dir_names - (char *)buffer) + dir_names_size) {
+		memcpy(buffer + offset, dir_entries, num_dir_entries * sizeof(DIR_ENTRY));
+		memcpy(buffer + offset + num_dir_entries * sizeof(DIR_ENTRY), dir_names, dir_names_size);
+		level->num_entries = num_dir_entries;
+		level->names_size = dir_names_size;
+		level->offset = offset;
+		dir_stack_used += size;
+	}
+}
+
+// pops the parent folder into *level, restoring its listing if it was kept.
+// returns 1 if it was, 0 if it has to be read again and -1 if there is no parent
+int dir_stack_pop(DIR_STACK_LEVEL *level) {
+	if (dir_stack_depth == 0)
+		return -1;
+	*level = dir_stack[--dir_stack_depth];
+	if (level->num_entries < 0)
+		return 0;
+	memcpy(dir_entries, buffer + level->offset, level->num_entries * sizeof(DIR_ENTRY));
+	memcpy(dir_names, buffer + level->offset + level->num_entries * sizeof(DIR_ENTRY), level->names_size);
+	num_dir_entries = level->num_entries;
+	dir_names_size = level->names_size;
+	dir_stack_used -= level->num_entries * sizeof(DIR_ENTRY) + level->names_size;
+	return 1;
+}
+
+// loads the index if it matches expected, and its CRC too if check_crc is set
+// (otherwise expected gets the index's). The entries and names are read in one
+// go, the entries just below the names, and then moved down to their place
+int dir_index_load(DIR_INDEX_HEADER *expected, int check_crc) {
+	FIL fil;
+	UINT bytes_read;
+	DIR_INDEX_HEADER header;
+	char filename[32];
 	int ret = 0;
-	num_dir_entries = 0;
-	DIR_ENTRY *dst = (DIR_ENTRY *)&dir_entries[0];
 
-	FATFS FatFs;
-	TM_DELAY_Init();
-	if (f_mount(&FatFs, "", 1) == FR_OK) {
-		DIR dir;
-		if (f_opendir(&dir, path) == FR_OK) {
-			if (strlen(path))
-			{	// not root directory, add pseudo ".." to go up a dir
-				dst->isDir = 1;
-				strcpy(dst->long_filename, "(GO BACK)");
-				strcpy(dst->filename, "..");
-				num_dir_entries++;
-				dst++;
-			}
-			while (num_dir_entries < NUM_DIR_ITEMS) {
-				if (f_readdir(&dir, &fno) != FR_OK || fno.fname[0] == 0)
-					break;
-				if (fno.fattrib & (AM_HID | AM_SYS))
-					continue;
-				dst->isDir = fno.fattrib & AM_DIR ? 1 : 0;
-				if (!dst->isDir)
-					if (!is_valid_file(fno.fname)) continue;
-				// copy file record
-				strcpy(dst->filename, fno.fname);
-				if (fno.lfname[0]) {
-					strncpy(dst->long_filename, fno.lfname, 31);
-					dst->long_filename[31] = 0;
-				}
-				else strcpy(dst->long_filename, fno.fname);
-				dst++;
-				num_dir_entries++;
-			}
-			f_closedir(&dir);
-			qsort((DIR_ENTRY *)&dir_entries[0], num_dir_entries, sizeof(DIR_ENTRY), entry_compare);
+	dir_index_filename(filename, expected->dir_cluster);
+	if (f_open(&fil, filename, FA_READ) != FR_OK)
+		return 0;
+	profile_begin(PHASE_DIR);
+	if (f_read(&fil, &header, sizeof(header), &bytes_read) == FR_OK && bytes_read == sizeof(header) &&
+		header.magic == expected->magic && header.version == expected->version &&
+		header.dir_cluster == expected->dir_cluster && header.card_gen == expected->card_gen &&
+		header.dir_date == expected->dir_date && header.dir_time == expected->dir_time &&
+		(header.dir_crc == expected->dir_crc || !check_crc) &&
+		header.num_entries <= DIR_MAX_ENTRIES && header.names_size <= DIR_NAMES_SIZE &&
+		f_size(&fil) == sizeof(header) + header.num_entries * sizeof(DIR_ENTRY) + header.names_size)
+	{
+		UINT entries_size = header.num_entries * sizeof(DIR_ENTRY);
+		UINT size = entries_size + header.names_size;
+		if (header.names_size > DIR_NAMES_SIZE - dir_stack_used)
+			dir_stack_discard();
+		if (f_read(&fil, dir_names - entries_size, size, &bytes_read) == FR_OK && bytes_read == size)
+		{
+			memmove(dir_entries, dir_names - entries_size, entries_size);
+			num_dir_entries = header.num_entries;
+			dir_names_size = header.names_size;
+			expected->dir_crc = header.dir_crc;
+			dir_index_mark_checked(header.dir_cluster, header.card_gen);
 			ret = 1;
 		}
-		f_mount(0, "", 1);
 	}
+	f_close(&fil);
+	profile_end(PHASE_DIR);
 	return ret;
 }
 
-int identify_cartridge(char *filename)
-{
-	TM_DELAY_Init();
-	FATFS FatFs;
-	unsigned int image_size;
-	int cart_type = CART_TYPE_NONE;
+void dir_index_save(DIR_INDEX_HEADER *header) {
 	FIL fil;
+	UINT bytes_written;
+	char filename[32];
+
+	if (f_mkdir(DIR_INDEX_ROOT) == FR_OK)
+		f_chmod(DIR_INDEX_ROOT, AM_HID, AM_HID);	// keep it out of the menu
+	f_mkdir(DIR_INDEX_DIR);
+
+	dir_index_filename(filename, header->dir_cluster);
+	if (f_open(&fil, filename, FA_WRITE | FA_CREATE_ALWAYS) != FR_OK)
+		return;
+	header->num_entries = num_dir_entries;
+	header->names_size = dir_names_size;
+	UINT entries_size = num_dir_entries * sizeof(DIR_ENTRY);
+	if (f_write(&fil, header, sizeof(DIR_INDEX_HEADER), &bytes_written) != FR_OK || bytes_written != sizeof(DIR_INDEX_HEADER) ||
+		f_write(&fil, dir_entries, entries_size, &bytes_written) != FR_OK || bytes_written != entries_size ||
+		f_write(&fil, dir_names, dir_names_size, &bytes_written) != FR_OK || bytes_written != dir_names_size)
+	{	// don't leave a truncated index behind
+		f_close(&fil);
+		f_unlink(filename);
+		return;
+	}
+	if (f_close(&fil) == FR_OK)
+		dir_index_mark_checked(header->dir_cluster, header->card_gen);
+}
 
-	if (f_mount(&FatFs, "", 1) != FR_OK) return CART_TYPE_NONE;
-	if (f_open(&fil, filename, FA_READ) != FR_OK) goto unmount;
-
-	// select type by file extension?
-	char *ext = get_filename_ext(filename);
-	EXT_TO_CART_TYPE_MAP *p = ext_to_cart_type_map;
-	while (p->ext) {
-		if (strcasecmp(ext, p->ext) == 0) {
-			cart_type = p->cart_type;
-			break;
-		}
-		p++;
+int add_dir_entry(DIR_ENTRY flags, char *filename, char *long_filename) {
+	int len = strlen(filename) + 1;
+	int lfn_len = 0;
+	if (long_filename[0] && strcmp(long_filename, filename)) {
+		lfn_len = strlen(long_filename);
+		if (lfn_len > DIR_MAX_LFN) lfn_len = DIR_MAX_LFN;
+		flags |= DIR_ENTRY_HAS_LFN;
+	}
+	if (dir_names_size + len + lfn_len + 1 > DIR_NAMES_SIZE - dir_stack_used)
+		dir_stack_discard();	// the saved listings make room
+	if (num_dir_entries == DIR_MAX_ENTRIES - 1 || dir_names_size + len + lfn_len + 1 > DIR_NAMES_SIZE - DIR_FULL_NOTE_SIZE) {
+		dir_full = 1;	// directory or buffer full
+		return 0;
 	}
+	char *dst = dir_names + dir_names_size;
+	memcpy(dst, filename, len);
+	if (lfn_len) {
+		memcpy(dst + len, long_filename, lfn_len);
+		dst[len + lfn_len] = 0;
+	}
+	dir_entries[num_dir_entries++] = flags | dir_names_size;
+	dir_names_size += len + (lfn_len ? lfn_len + 1 : 0);
+	return 1;
+}
 
-	image_size = f_size(&fil);
+// ends a sorted listing with the note if add_dir_entry() turned entries away
+void add_dir_full_note() {
+	if (!dir_full) return;
+	char *dst = dir_names + dir_names_size;
+	dst[0] = 0;
+	strcpy(dst + 1, DIR_FULL_NOTE);
+	dir_entries[num_dir_entries++] = DIR_ENTRY_IS_NOTE | DIR_ENTRY_HAS_LFN | dir_names_size;
+	dir_names_size += DIR_FULL_NOTE_SIZE;
+}
 
-	// Supercharger cartridges get special treatment, since we don't load the entire
-	// file into the buffer here
-	if (cart_type == CART_TYPE_NONE && (image_size % 8448) == 0)
-		cart_type = CART_TYPE_AR;
-	if (cart_type == CART_TYPE_AR) goto close;
+/* Raw Directory Scan
+ * ------------------
+ * f_readdir() hands over one entry at a time, putting every long name together
+ * in a 255 character Unicode buffer and converting it into fno, only for most
+ * entries to be turned away by is_valid_file(). Instead, folders on FAT16 and
+ * FAT32 volumes are read a sector at a time into the volume's own window, as
+ * FatFs would, and the 16 entries in each are parsed in place. An extension is
+ * checked with a single probe of a perfect hash of the three character SFN
+ * extensions, built from ext_to_cart_type_map and the archive extensions the
+ * first time it is needed. Only the characters of a long name that the listing
+ * keeps are copied, but the whole name is checked like f_readdir() does, so
+ * the listing comes out exactly the same. A card error, or a broken cluster
+ * chain, ends the scan with DIR_SCAN_ERROR like a failed f_readdir(), so the
+ * listing isn't cached. FAT12 volumes still use f_readdir().
+ * A sector takes longer to arrive than a scan slice lasts (the card's access
+ * time, then 512 bytes over SPI), so the scan doesn't wait for it: it starts
+ * the read and polls it while the slice has time left, and the DMA transfer
+ * carries on after the slice returns. The next slice picks up the sector.
+ */
+#define EXT_HASH_BITS	7
 
-	// otherwise, read the file into the cartridge buffer
-	unsigned int bytes_to_read = image_size > (BUFFER_SIZE * 1024) ? (BUFFER_SIZE * 1024) : image_size;
-	UINT bytes_read;
-	FRESULT read_result = f_read(&fil, buffer, bytes_to_read, &bytes_read);
+uint32_t ext_hash_mult = 0;	// 0 until built
+uint32_t ext_hash_table[1 << EXT_HASH_BITS];	// the SFN extension, space padded, in the low 3 bytes
 
-	if (read_result != FR_OK || bytes_to_read != bytes_read) {
-		cart_type = CART_TYPE_NONE;
-		goto close;
+static const BYTE lfn_offsets[13] = { 1, 3, 5, 7, 9, 14, 16, 18, 20, 22, 24, 28, 30 };
+
+typedef struct {
+	uint32_t clust;		// the cluster being read, 0 for a FAT16 root folder
+	uint32_t sect;		// the sector being read
+	int sects_left;		// after this one, in the cluster or root folder
+	int index;		// the next entry in the sector
+	BYTE ord, sum;		// the long name being put together, as in dir_read()
+	int lfn_len;		// its length, from its last part
+	int lfn_end;		// where a part ended it early
+	int lfn_bad;		// where a character had no OEM code
+	char lfn[DIR_MAX_LFN + 1];
+	DWORD reading;		// the sector on its way into the window, 0xFFFFFFFF if none
+} DIR_RAW;
+
+static inline uint32_t ext_hash(uint32_t key) {
+	return (key * ext_hash_mult) >> (32 - EXT_HASH_BITS);
+}
+
+static uint32_t ext_hash_key(const char *ext) {
+	uint32_t key = 0x202020;
+	for (int i = 0; i < 3 && ext[i]; i++)
+		key = (key & ~(0xFFu << (i * 8))) | (uint32_t)toupper((unsigned char)ext[i]) << (i * 8);
+	return key;
+}
+
+static int ext_hash_add(const char *ext) {
+	if (strlen(ext) > 3) return 1;	// can't be an SFN extension
+	uint32_t key = ext_hash_key(ext);
+	uint32_t *slot = &ext_hash_table[ext_hash(key)];
+	if (*slot && *slot != key) return 0;
+	*slot = key;
+	return 1;
+}
+
+// finds a multiplier that puts each extension in a slot of its own
+int ext_hash_build() {
+	for (uint32_t mult = 0x9E3779B1; mult != 0x9E3779B1 + 2 * 1000; mult += 2) {
+		int ok = 1;
+		ext_hash_mult = mult;
+		memset(ext_hash_table, 0, sizeof(ext_hash_table));
+		for (EXT_TO_CART_TYPE_MAP *p = ext_to_cart_type_map; p->ext && ok; p++)
+			ok = ext_hash_add(p->ext);
+		for (int i = 0; unpack_extensions[i] && ok; i++)
+			ok = ext_hash_add(unpack_extensions[i]);
+		if (ok) return 1;
 	}
+	ext_hash_mult = 0;
+	return 0;
+}
 
-	if (cart_type != CART_TYPE_NONE) goto close;
+// is_valid_file() for the 11 character name of a directory entry
+static inline int raw_is_valid_file(BYTE *dir) {
+	uint32_t key = 0x202020;
+	int n = 0;
+	for (int i = 8; i < 11; i++)
+		if (dir[i] != ' ') {	// get_fileinfo() drops spaces anywhere in the name
+			key = (key & ~(0xFFu << (n * 8))) | (uint32_t)toupper(dir[i]) << (n * 8);
+			n++;
+		}
+	return n && ext_hash_table[ext_hash(key)] == key;
+}
 
-	// If we don't already know the type (from the file extension), then we
-	// auto-detect the cart type - largely follows code in Stella's CartDetector.cpp
-	if (image_size == 2*1024)
-	{
-		if (isProbablyCV(bytes_read, buffer))
-			cart_type = CART_TYPE_CV;
-		else
-			cart_type = CART_TYPE_2K;
+// reads a sector into the volume's window, in place of move_window()
+int raw_window(FATFS *fs, DWORD sect) {
+	if (fs->winsect == sect) return 1;
+	if (fs->wflag) return 0;	// FatFs has a write pending, leave it alone
+	if (disk_read(fs->drv, fs->win, sect, 1) != RES_OK) {
+		fs->winsect = 0xFFFFFFFF;
+		return 0;
 	}
-	else if (image_size == 4*1024)
-	{
-		cart_type = CART_TYPE_4K;
+	fs->winsect = sect;
+	return 1;
+}
+
+#define RAW_WINDOW_ERROR	0
+#define RAW_WINDOW_READY	1
+#define RAW_WINDOW_READING	2
+
+// raw_window() without the wait: starts reading sect into the window, then
+// reports how the read is going each time it is called again for it
+int raw_window_poll(DIR_RAW *r, FATFS *fs, DWORD sect) {
+	if (fs->winsect == sect) return RAW_WINDOW_READY;
+	if (r->reading != sect) {
+		if (fs->wflag || r->reading != 0xFFFFFFFF) return RAW_WINDOW_ERROR;
+		fs->winsect = 0xFFFFFFFF;	// the window is being overwritten
+		if (TM_FATFS_SD_ReadStart(fs->win, sect) != RES_OK) return RAW_WINDOW_ERROR;
+		r->reading = sect;
 	}
-	else if (image_size == 8*1024)
-	{
-		// First check for *potential* F8
-		unsigned char  signature[] = { 0x8D, 0xF9, 0x1F };  // STA $1FF9
-		int f8 = searchForBytes(buffer, bytes_read, signature, 3, 2);
+	DRESULT res = TM_FATFS_SD_ReadPoll();
+	if (res == RES_NOTRDY) return RAW_WINDOW_READING;
+	r->reading = 0xFFFFFFFF;
+	if (res != RES_OK) return RAW_WINDOW_ERROR;
+	fs->winsect = sect;
+	return RAW_WINDOW_READY;
+}
 
-		if (isProbablySC(bytes_read, buffer))
-			cart_type = CART_TYPE_F8SC;
-		else if (memcmp(buffer, buffer + 4096, 4096) == 0)
-			cart_type = CART_TYPE_4K;
-		else if (isProbablyE0(bytes_read, buffer))
-			cart_type = CART_TYPE_E0;
-		else if (isProbably3E(bytes_read, buffer))
-			cart_type = CART_TYPE_3E;
-		else if (isProbably3F(bytes_read, buffer))
-			cart_type = CART_TYPE_3F;
-		else if (isProbablyFE(bytes_read, buffer) && !f8)
-			cart_type = CART_TYPE_FE;
-		else if (isProbably0840(bytes_read, buffer))
-			cart_type = CART_TYPE_0840;
-		else
-			cart_type = CART_TYPE_F8;
+// waits for a read raw_window_poll() started, so the card can be used again
+void raw_window_finish(DIR_RAW *r) {
+	while (r->reading != 0xFFFFFFFF && TM_FATFS_SD_ReadPoll() == RES_NOTRDY)
+		TM_FATFS_SD_WaitCallback();
+	r->reading = 0xFFFFFFFF;
+}
+
+#define RAW_CLUSTER_ERROR	1	// never the number of a cluster in a chain
+
+// the FAT sector holding the entry of clust
+static inline DWORD raw_fat_sector(FATFS *fs, uint32_t clust) {
+	return fs->fatbase + clust / (fs->fs_type == FS_FAT32 ? 128 : 256);
+}
+
+// the cluster after clust, 0 at the end of the chain, RAW_CLUSTER_ERROR if the
+// card fails or the chain is broken
+uint32_t raw_next_cluster(FATFS *fs, uint32_t clust) {
+	uint32_t next;
+	if (fs->fs_type == FS_FAT32) {
+		if (!raw_window(fs, raw_fat_sector(fs, clust))) return RAW_CLUSTER_ERROR;
+		BYTE *p = fs->win + (clust % 128) * 4;
+		next = (p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24) & 0x0FFFFFFF;
 	}
-	else if(image_size >= 10240 && image_size <= 10496)
-	{  // ~10K - Pitfall II
-		cart_type = CART_TYPE_DPC;
+	else {
+		if (!raw_window(fs, raw_fat_sector(fs, clust))) return RAW_CLUSTER_ERROR;
+		BYTE *p = fs->win + (clust % 256) * 2;
+		next = p[0] | p[1] << 8;
 	}
-	else if (image_size == 12*1024)
-	{
-		cart_type = CART_TYPE_FA;
+	if (next < 2)
+		return RAW_CLUSTER_ERROR;	// a free cluster in the chain, as get_fat() sees it
+	return next < fs->n_fatent ? next : 0;
+}
+
+// sets up a raw scan of the folder starting at cluster clust (0 for the root),
+// returns 0 if the volume needs f_readdir()
+int raw_start(DIR_RAW *r, FATFS *fs, uint32_t clust) {
+	if (fs->fs_type != FS_FAT16 && fs->fs_type != FS_FAT32) return 0;
+	if (!clust && fs->fs_type == FS_FAT32)
+		clust = fs->dirbase;
+	r->clust = clust;
+	if (clust) {
+		r->sect = fs->database + (clust - 2) * fs->csize;
+		r->sects_left = fs->csize - 1;
 	}
-	else if (image_size == 16*1024)
-	{
-		if (isProbablySC(bytes_read, buffer))
-			cart_type = CART_TYPE_F6SC;
-		else if (isProbablyE7(bytes_read, buffer))
-			cart_type = CART_TYPE_E7;
-		else if (isProbably3E(bytes_read, buffer))
-			cart_type = CART_TYPE_3E;
-		else
-			cart_type = CART_TYPE_F6;
+	else {
+		r->sect = fs->dirbase;
+		r->sects_left = fs->n_rootdir / 16 - 1;
 	}
-	else if (image_size == 32*1024)
-	{
+	r->index = 0;
+	r->ord = r->sum = 0xFF;
+	r->reading = 0xFFFFFFFF;
+	return 1;
+}
+
+// takes in one part of a long name, checking it like pick_lfn()
+static int raw_pick_lfn(DIR_RAW *r, BYTE *dir) {
+	int i = ((dir[0] & 0x3F) - 1) * 13;
+	WCHAR wc = 1;
+	for (int s = 0; s < 13; s++) {
+		WCHAR uc = dir[lfn_offsets[s]] | dir[lfn_offsets[s] + 1] << 8;
+		if (wc) {
+			if (i >= _MAX_LFN) return 0;
+			wc = uc;
+			if (!uc) {
+				if (i < r->lfn_end) r->lfn_end = i;
+			}
+			else {
+				WCHAR c = ff_convert(uc, 0);
+				if (!c && i < r->lfn_bad) r->lfn_bad = i;
+				if (i < DIR_MAX_LFN) r->lfn[i] = c;
+			}
+			i++;
+		}
+		else if (uc != 0xFFFF) return 0;
+	}
+	if (dir[0] & 0x40) {
+		if (i >= _MAX_LFN) return 0;
+		r->lfn_len = i;
+	}
+	return 1;
+}
+
+// what a slice of a directory scan ended with
+#define DIR_SCAN_MORE	0	// max_entries were added or time ran out
+#define DIR_SCAN_DONE	1	// the whole folder has been read, or the listing is full
+#define DIR_SCAN_ERROR	2	// the card failed, the listing is incomplete
+
+// reads entries until max_entries have been added or time runs out, leaving
+// a sector still on its way for the next call
+int raw_scan(DIR_RAW *r, FATFS *fs, int max_entries, uint32_t max_cycles) {
+	uint32_t start = DWT->CYCCNT;
+	int added = 0, window;
+	char sfn[13];
+	while (added < max_entries && DWT->CYCCNT - start < max_cycles) {
+		if (r->index == 16) {
+			if (r->sects_left) {
+				r->sect++;
+				r->sects_left--;
+			}
+			else {
+				if (!r->clust)
+					return DIR_SCAN_DONE;	// the end of a FAT16 root folder
+				if ((window = raw_window_poll(r, fs, raw_fat_sector(fs, r->clust))) == RAW_WINDOW_READING) {
+					TM_FATFS_SD_WaitCallback();
+					continue;
+				}
+				if (window == RAW_WINDOW_ERROR)
+					return DIR_SCAN_ERROR;
+				r->clust = raw_next_cluster(fs, r->clust);
+				if (r->clust == RAW_CLUSTER_ERROR)
+					return DIR_SCAN_ERROR;
+				if (!r->clust)
+					return DIR_SCAN_DONE;
+				r->sect = fs->database + (r->clust - 2) * fs->csize;
+				r->sects_left = fs->csize - 1;
+			}
+			r->index = 0;
+		}
+		if ((window = raw_window_poll(r, fs, r->sect)) == RAW_WINDOW_READING) {
+			TM_FATFS_SD_WaitCallback();
+			continue;
+		}
+		if (window == RAW_WINDOW_ERROR)
+			return DIR_SCAN_ERROR;
+		BYTE *dir = fs->win + r->index++ * 32;
+		BYTE c = dir[0], a = dir[11] & AM_MASK;
+		if (c == 0)
+			return DIR_SCAN_DONE;
+		if (c == 0xE5 || c == '.' || (a & ~AM_ARC) == AM_VOL) {
+			r->ord = 0xFF;
+			continue;
+		}
+		if (a == AM_LFN) {
+			if (c & 0x40) {
+				r->sum = dir[13];
+				c &= ~0x40;
+				r->ord = c;
+				r->lfn_end = r->lfn_bad = _MAX_LFN;
+			}
+			r->ord = (c == r->ord && r->sum == dir[13] && raw_pick_lfn(r, dir)) ? r->ord - 1 : 0xFF;
+			continue;
+		}
+		// a file or folder, with a long name if all of its parts came before it
+		BYTE sum = 0;
+		for (int i = 0; i < 11; i++)
+			sum = (sum >> 1) + (sum << 7) + dir[i];
+		int lfn_len = 0;
+		if (r->ord == 0 && r->sum == sum) {
+			lfn_len = r->lfn_len < r->lfn_end ? r->lfn_len : r->lfn_end;
+			if (r->lfn_bad < lfn_len)
+				lfn_len = 0;	// get_fileinfo() drops names it can't convert
+		}
+		r->ord = r->sum = 0xFF;
+		if (dir[11] & (AM_HID | AM_SYS))
+			continue;
+		if (!(dir[11] & AM_DIR) && !raw_is_valid_file(dir))
+			continue;
+		// the short name as get_fileinfo() puts it
+		char *p = sfn;
+		for (int i = 0; i < 11; i++) {
+			char ch = dir[i];
+			if (ch == ' ') continue;
+			if (ch == 0x05) ch = 0xE5;
+			if (i == 8) *p++ = '.';
+			if (ch >= 'A' && ch <= 'Z' && (dir[12] & (i >= 8 ? 0x10 : 0x08)))
+				ch += 0x20;
+			*p++ = ch;
+		}
+		*p = 0;
+		if (lfn_len > DIR_MAX_LFN) lfn_len = DIR_MAX_LFN;
+		r->lfn[lfn_len] = 0;
+		if (!add_dir_entry(dir[11] & AM_DIR ? DIR_ENTRY_IS_DIR : 0, sfn, r->lfn))
+			return DIR_SCAN_DONE;
+		added++;
+	}
+	return DIR_SCAN_MORE;
+}
+
+/* Streaming
+ * When a folder has no valid index, read_directory() only scans until it has a
+ * screenful of entries and leaves the directory open in dir_scan, so the menu
+ * can show them straight away. While dir_scan.active is set, the menu sends
+ * CART_CMD_DIR_MORE every frame and waits for us during its overscan; each
+ * call to continue_directory() reads entries for at most DIR_SCAN_SLICE_US,
+ * so the menu keeps its frame timing. Until the scan completes, new entries
+ * are appended unsorted; then the listing is sorted and saved to the index.
+ * A scan that ends on a card error is sorted but not saved.
+ */
+#define CATALOG_NAME			"*"	// the root folder's entry for the rom catalog (see below)
+#define CATALOG_PATH			"/" CATALOG_NAME
+#define DIR_FIRST_PAGE_ITEMS	9	// a screenful on PAL, the most of any tv mode
+#define DIR_SCAN_SLICE_US		1200
+
+typedef struct {
+	FATFS fs;
+	DIR dir;
+	DIR_INDEX_HEADER header;
+	DIR_INDEX_GEN gen;
+	int use_index;
+	int has_gen;	// the volume has a card generation, see dir_index_read_gen()
+	int first;	// entries before this one are kept out of the sort
+	int active;
+	int use_raw;
+	DIR_RAW raw;
+} DIR_SCAN;
+
+DIR_SCAN dir_scan;
+
+// the f_readdir version of raw_scan(), for FAT12 volumes
+int readdir_scan(int max_entries, uint32_t max_cycles) {
+	uint32_t start = DWT->CYCCNT;
+	int added = 0;
+	while (added < max_entries && DWT->CYCCNT - start < max_cycles) {
+		if (f_readdir(&dir_scan.dir, &fno) != FR_OK)
+			return DIR_SCAN_ERROR;
+		if (fno.fname[0] == 0)
+			return DIR_SCAN_DONE;
+		if (fno.fattrib & (AM_HID | AM_SYS))
+			continue;
+		if (!(fno.fattrib & AM_DIR))
+			if (!is_valid_file(fno.fname)) continue;
+		if (!add_dir_entry(fno.fattrib & AM_DIR ? DIR_ENTRY_IS_DIR : 0, fno.fname, fno.lfname))
+			return DIR_SCAN_DONE;
+		added++;
+	}
+	return DIR_SCAN_MORE;
+}
+
+// reads directory entries until max_entries have been added or time runs out,
+// returns DIR_SCAN_MORE until the scan ends
+int scan_directory(int max_entries, uint32_t max_cycles) {
+	profile_begin(PHASE_DIR);
+	int done = dir_scan.use_raw ? raw_scan(&dir_scan.raw, &dir_scan.fs, max_entries, max_cycles) :
+		readdir_scan(max_entries, max_cycles);
+	profile_end(PHASE_DIR);
+	return done;
+}
+
+// ends a directory scan with what its last slice returned (DIR_SCAN_MORE if it
+// is abandoned), sorting the listing if it was read to the end or to an error
+// and saving it only if it is complete
+void end_directory(int result) {
+	if (!dir_scan.active) return;
+	if (dir_scan.use_raw)
+		raw_window_finish(&dir_scan.raw);
+	if (result != DIR_SCAN_MORE) {
+		sort_directory(dir_scan.first);
+		add_dir_full_note();
+		index_directory_letters();
+		if (result == DIR_SCAN_DONE && dir_scan.use_index) {
+			dir_index_save(&dir_scan.header);
+			if (dir_scan.has_gen)
+				dir_index_write_gen(&dir_scan.fs, &dir_scan.gen);
+		}
+	}
+	f_closedir(&dir_scan.dir);
+	f_mount(0, "", 1);
+	dir_scan.active = 0;
+}
+
+void continue_directory() {
+	int result;
+	if (dir_scan.active && (result = scan_directory(DIR_MAX_ENTRIES, SystemCoreClock / 1000000 * DIR_SCAN_SLICE_US)) != DIR_SCAN_MORE)
+		end_directory(result);
+}
+
+// the CRC of the raw entries in the first DIR_INDEX_CRC_SECTORS sectors of the
+// folder starting at cluster clust (0 for the root), fewer if it ends sooner.
+// returns 0 if the volume is read with f_readdir() or the card fails
+int dir_index_crc(FATFS *fs, uint32_t clust, uint32_t *crc) {
+	DIR_RAW r;
+	if (!raw_start(&r, fs, clust))
+		return 0;
+	crc_start();
+	for (int i = 0; i < DIR_INDEX_CRC_SECTORS; i++) {
+		if (!raw_window(fs, r.sect))
+			return 0;
+		crc_add_words(fs->win, 512);
+		if (r.sects_left) {
+			r.sect++;
+			r.sects_left--;
+		}
+		else if (!r.clust || !(r.clust = raw_next_cluster(fs, r.clust)))
+			break;
+		else if (r.clust == RAW_CLUSTER_ERROR)
+			return 0;
+		else {
+			r.sect = fs->database + (r.clust - 2) * fs->csize;
+			r.sects_left = fs->csize - 1;
+		}
+	}
+	*crc = crc_result(0, 0);
+	return 1;
+}
+
+// the modification stamp of the folder f_opendir() has just opened on path, for
+// its index: its entry is in the sector of the parent folder that following the
+// path left in the window, so the path is only walked again with f_stat() if it
+// isn't there. returns 0 if the stamp can't be had (the root has none, 0)
+int dir_index_stamp(FATFS *fs, DIR *dir, char *path, DIR_INDEX_HEADER *header) {
+	if (!strlen(path))
+		return 1;
+	for (BYTE *e = fs->win; e < fs->win + 512; e += 32) {
+		uint32_t clust = e[26] | e[27] << 8;
+		if (fs->fs_type == FS_FAT32)
+			clust |= (uint32_t)(e[20] | e[21] << 8) << 16;
+		if (e[0] && e[0] != 0xE5 && (e[11] & (AM_DIR | AM_VOL)) == AM_DIR && clust == dir->sclust) {
+			header->dir_time = e[22] | e[23] << 8;
+			header->dir_date = e[24] | e[25] << 8;
+			return 1;
+		}
+	}
+	if (f_stat(path, &fno) != FR_OK)
+		return 0;
+	header->dir_date = fno.fdate;
+	header->dir_time = fno.ftime;
+	return 1;
+}
+
+int read_directory(char *path) {
+	end_directory(DIR_SCAN_MORE);
+	num_dir_entries = 0;
+	dir_names_size = 0;
+	dir_full = 0;
+	dir_letters_valid = 0;
+
+	TM_DELAY_Init();
+	if (mount_card(&dir_scan.fs) != FR_OK)
+		return 0;
+	if (f_opendir(&dir_scan.dir, path) != FR_OK) {
+		f_mount(0, "", 1);
+		return 0;
+	}
+	DIR_INDEX_HEADER header = { DIR_INDEX_MAGIC, DIR_INDEX_VERSION, 0, 0, 0, dir_scan.dir.sclust, 0, 0, 0, 0 };
+	dir_scan.use_index = dir_index_stamp(&dir_scan.fs, &dir_scan.dir, path, &header);
+	dir_scan.has_gen = dir_index_read_gen(&dir_scan.fs, &dir_scan.gen);
+	header.card_gen = dir_scan.has_gen ? dir_scan.gen.gen : 0;
+	int checked = dir_scan.use_index && dir_index_was_checked(header.dir_cluster, header.card_gen);
+	if (dir_scan.use_index && !checked)
+		dir_scan.use_index = dir_index_crc(&dir_scan.fs, header.dir_cluster, &header.dir_crc);
+	dir_scan.active = 1;
+	dir_scan.use_raw = (ext_hash_mult || ext_hash_build()) && raw_start(&dir_scan.raw, &dir_scan.fs, dir_scan.dir.sclust);
+
+	if (dir_scan.use_index && dir_index_load(&header, !checked)) {
+		dir_scan.header = header;
+		end_directory(DIR_SCAN_MORE);	// nothing to sort or save
+		index_directory_letters();
+		return 1;
+	}
+	if (dir_scan.use_index && checked)	// for the index saved at the end
+		dir_scan.use_index = dir_index_crc(&dir_scan.fs, header.dir_cluster, &header.dir_crc);
+	dir_scan.header = header;
+
+	// keep a pseudo ".." to go up a dir at the top, or the catalog in the root directory
+	if (strlen(path))
+		add_dir_entry(DIR_ENTRY_IS_DIR, "..", "(GO BACK)");
+	else
+		add_dir_entry(DIR_ENTRY_IS_DIR, CATALOG_NAME, "(ALL ROMS)");
+	dir_scan.first = 1;
+	int result = scan_directory(DIR_FIRST_PAGE_ITEMS, 0xFFFFFFFF);
+	if (result != DIR_SCAN_MORE)
+		end_directory(result);
+	return 1;
+}
+
+// the cart type given by the file extension, CART_TYPE_NONE if it doesn't say
+int cart_type_from_extension(char *filename) {
+	char *ext = get_filename_ext(filename);
+	EXT_TO_CART_TYPE_MAP *p = ext_to_cart_type_map;
+	while (p->ext) {
+		if (strcasecmp(ext, p->ext) == 0)
+			return p->cart_type;
+		p++;
+	}
+	return CART_TYPE_NONE;
+}
+
+// auto-detects the cart type of the image in the buffer, given the signature counts
+// of all of it - largely follows code in Stella's CartDetector.cpp
+int detect_cart_type(unsigned int image_size, unsigned int bytes_read, SIG_SCAN *scan)
+{
+	int cart_type = CART_TYPE_NONE;
+
+	if (image_size == 2*1024)
+	{
+		if (isProbablyCV(scan))
+			cart_type = CART_TYPE_CV;
+		else
+			cart_type = CART_TYPE_2K;
+	}
+	else if (image_size == 4*1024)
+	{
+		cart_type = CART_TYPE_4K;
+	}
+	else if (image_size == 8*1024)
+	{
+		// First check for *potential* F8
+		int f8 = sig_found(scan, SIG_F8, 1, 2);
+
+		if (isProbablySC(bytes_read, buffer))
+			cart_type = CART_TYPE_F8SC;
+		else if (memcmp(buffer, buffer + 4096, 4096) == 0)
+			cart_type = CART_TYPE_4K;
+		else if (isProbablyE0(scan))
+			cart_type = CART_TYPE_E0;
+		else if (isProbably3E(scan))
+			cart_type = CART_TYPE_3E;
+		else if (isProbably3F(scan))
+			cart_type = CART_TYPE_3F;
+		else if (isProbablyFE(scan) && !f8)
+			cart_type = CART_TYPE_FE;
+		else if (isProbably0840(scan))
+			cart_type = CART_TYPE_0840;
+		else
+			cart_type = CART_TYPE_F8;
+	}
+	else if(image_size >= 10240 && image_size <= 10496)
+	{  // ~10K - Pitfall II
+		cart_type = CART_TYPE_DPC;
+	}
+	else if (image_size == 12*1024)
+	{
+		cart_type = CART_TYPE_FA;
+	}
+	else if (image_size == 24*1024 || image_size == 28*1024 || image_size == 29*1024)
+	{
+		cart_type = CART_TYPE_FA2;
+	}
+	else if (image_size == 16*1024)
+	{
+		if (isProbablySC(bytes_read, buffer))
+			cart_type = CART_TYPE_F6SC;
+		else if (isProbablyE7(scan))
+			cart_type = CART_TYPE_E7;
+		else if (isProbably3E(scan))
+			cart_type = CART_TYPE_3E;
+		else
+			cart_type = CART_TYPE_F6;
+	}
+	else if (image_size == 32*1024)
+	{
 		if (isProbablySC(bytes_read, buffer))
 			cart_type = CART_TYPE_F4SC;
-		else if (isProbably3E(bytes_read, buffer))
+		else if (isProbably3E(scan))
 			cart_type = CART_TYPE_3E;
-		else if (isProbably3F(bytes_read, buffer))
+		else if (isProbably3F(scan))
 			cart_type = CART_TYPE_3F;
 		else
 			cart_type = CART_TYPE_F4;
 	}
 	else if (image_size == 64*1024)
 	{
-		if (isProbably3E(bytes_read, buffer))
-			cart_type = CART_TYPE_3E;
-		else if (isProbably3F(bytes_read, buffer))
-			cart_type = CART_TYPE_3F;
-		else if (isProbablyEF(bytes_read, buffer))
-		{
-			if (isProbablySC(bytes_read, buffer))
-				cart_type = CART_TYPE_EFSC;
-			else
-				cart_type = CART_TYPE_EF;
+		if (isProbably3E(scan))
+			cart_type = CART_TYPE_3E;
+		else if (isProbably3F(scan))
+			cart_type = CART_TYPE_3F;
+		else if (isProbablyEF(scan))
+		{
+			if (isProbablySC(bytes_read, buffer))
+				cart_type = CART_TYPE_EFSC;
+			else
+				cart_type = CART_TYPE_EF;
+		}
+		else
+			cart_type = CART_TYPE_F0;
+	}
+	return cart_type;
+}
+
+// reloads a folder from its index, without resolving its path. returns 0 if the
+// index is missing or out of date, or the volume can't tell
+int read_directory_index(DIR_INDEX_HEADER *header) {
+	end_directory(DIR_SCAN_MORE);
+	num_dir_entries = 0;
+	dir_names_size = 0;
+	dir_letters_valid = 0;
+
+	TM_DELAY_Init();
+	if (mount_card(&dir_scan.fs) != FR_OK)
+		return 0;
+	dir_scan.has_gen = dir_index_read_gen(&dir_scan.fs, &dir_scan.gen);
+	header->card_gen = dir_scan.has_gen ? dir_scan.gen.gen : 0;
+	int checked = dir_index_was_checked(header->dir_cluster, header->card_gen);
+	int ret = checked || dir_index_crc(&dir_scan.fs, header->dir_cluster, &header->dir_crc);
+	if (ret)
+		ret = dir_index_load(header, !checked);
+	f_mount(0, "", 1);
+	if (ret) {
+		dir_scan.header = *header;
+		index_directory_letters();
+	}
+	return ret;
+}
+
+/* Cart Database
+ * An optional /UNOCART.DB on the card maps image CRCs to cart types, for roms the
+ * heuristics get wrong (and to skip them for the rest). It is a 512 byte header
+ * sector followed by sectors of 64 CART_DB_RECORDs sorted by CRC, the last one
+ * padded. The header holds the first CRC of each record sector, so a lookup reads
+ * the header and then just the one sector that could hold the CRC. All values are
+ * little endian. The flags record the TV system the rom was made for; nothing acts
+ * on them yet.
+ */
+#define CART_DB_FILE		"/UNOCART.DB"
+#define CART_DB_MAGIC		0x42444355	// "UCDB"
+#define CART_DB_VERSION		1
+#define CART_DB_MAX_SECTORS	124
+#define CART_DB_SECTOR_RECORDS	64
+
+#define CART_DB_FLAG_PAL	0x01
+#define CART_DB_FLAG_PAL60	0x02
+
+typedef struct {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t num_sectors;	// of records
+	uint32_t num_records;
+	uint32_t reserved;
+	uint32_t first_crc[CART_DB_MAX_SECTORS];
+} CART_DB_HEADER;
+
+typedef struct {
+	uint32_t crc;
+	uint8_t cart_type;
+	uint8_t flags;
+	uint16_t reserved;
+} CART_DB_RECORD;
+
+// looks up an image's CRC on the mounted card, returns CART_TYPE_NONE if it isn't there
+int cart_db_lookup(uint32_t crc) {
+	FIL fil;
+	UINT bytes_read;
+	CART_DB_HEADER header;
+	CART_DB_RECORD records[CART_DB_SECTOR_RECORDS];
+	int cart_type = CART_TYPE_NONE;
+
+	if (f_open(&fil, CART_DB_FILE, FA_READ) != FR_OK)
+		return CART_TYPE_NONE;
+	if (f_read(&fil, &header, sizeof(header), &bytes_read) == FR_OK && bytes_read == sizeof(header) &&
+		header.magic == CART_DB_MAGIC && header.version == CART_DB_VERSION &&
+		header.num_sectors <= CART_DB_MAX_SECTORS && header.num_records <= header.num_sectors * CART_DB_SECTOR_RECORDS)
+	{
+		// the last sector starting at or below the crc
+		int lo = 0, hi = header.num_sectors - 1, sector = -1;
+		while (lo <= hi) {
+			int mid = (lo + hi) / 2;
+			if (header.first_crc[mid] <= crc) {
+				sector = mid;
+				lo = mid + 1;
+			}
+			else hi = mid - 1;
+		}
+		if (sector >= 0 && f_lseek(&fil, (sector + 1) * sizeof(records)) == FR_OK &&
+			f_read(&fil, records, sizeof(records), &bytes_read) == FR_OK)
+		{
+			int n = header.num_records - sector * CART_DB_SECTOR_RECORDS;
+			if (n > (int)(bytes_read / sizeof(CART_DB_RECORD))) n = bytes_read / sizeof(CART_DB_RECORD);
+			lo = 0;
+			hi = n - 1;
+			while (lo <= hi) {
+				int mid = (lo + hi) / 2;
+				if (records[mid].crc == crc) {
+					cart_type = records[mid].cart_type;
+					break;
+				}
+				if (records[mid].crc < crc) lo = mid + 1;
+				else hi = mid - 1;
+			}
+		}
+	}
+	f_close(&fil);
+	if (cart_type > CART_TYPE_FA2)
+		cart_type = CART_TYPE_NONE;	// from a newer firmware
+	return cart_type;
+}
+
+#define LOAD_CHUNK_SIZE	4096	// the progress bar moves on after each chunk
+
+// reads bytes_to_read bytes of an open rom into the buffer a chunk at a time, adding
+// the whole words to the CRC. if scan is set, its signatures are counted while the
+// chunks after the first transfer, if the size needs them
+int load_image(FIL *fil, unsigned int bytes_to_read, SIG_SCAN *scan, int show_progress)
+{
+	UINT bytes_read = 0, chunk_read;
+	FRESULT read_result = FR_OK;
+
+	if (scan)
+		sig_scan_init(scan, bytes_to_read);
+	if (!sig_scan_needed(bytes_to_read))
+		scan = 0;
+	load_scan = scan;
+	while (read_result == FR_OK && bytes_read < bytes_to_read)
+	{
+		UINT chunk = bytes_to_read - bytes_read;
+		if (chunk > LOAD_CHUNK_SIZE) chunk = LOAD_CHUNK_SIZE;
+		load_scan_end = bytes_read;
+		read_result = f_read(fil, buffer + bytes_read, chunk, &chunk_read);
+		crc_add_words(buffer + bytes_read, chunk_read & ~3);
+		bytes_read += chunk_read;
+		if (chunk_read != chunk) break;
+		if (show_progress)
+			set_menu_progress(bytes_read, bytes_to_read);
+	}
+	load_scan = 0;
+	if (read_result != FR_OK || bytes_to_read != bytes_read)
+		return 0;
+	// at least the last chunk is left
+	if (scan)
+		sig_scan(scan, buffer + scan->pos, bytes_read - scan->pos);
+	return 1;
+}
+
+/* Compressed roms (see unpack.c) are unpacked into the buffer as the archive is
+ * read. Their size isn't known until the end, so the wait callback holds back the
+ * last byte unpacked so far: a signature only counts if it ends before the image does.
+ */
+UNPACK rom_unpack;
+FIL *unpack_fil;
+int unpack_show_progress;
+
+unsigned int unpack_read(unsigned char *dst, unsigned int len) {
+	UINT bytes_read;
+	load_scan_end = rom_unpack.out_pos ? rom_unpack.out_pos - 1 : 0;
+	if (f_read(unpack_fil, dst, len, &bytes_read) != FR_OK)
+		return 0;
+	if (unpack_show_progress)
+		set_menu_progress(f_tell(unpack_fil), f_size(unpack_fil));
+	return bytes_read;
+}
+
+// unpacks the rom in an open archive into the buffer, adding it to the CRC and checking
+// it against the archive's. returns its size, 0 if it couldn't be unpacked
+unsigned int load_packed_image(FIL *fil, int format, SIG_SCAN *scan, int show_progress)
+{
+	UNPACK *u = &rom_unpack;
+	u->read = unpack_read;
+	u->accept = is_rom_file;
+	u->out = buffer;
+	u->out_size = BUFFER_SIZE * 1024;
+	unpack_fil = fil;
+	unpack_show_progress = show_progress;
+	if (scan)
+		sig_scan_init(scan, 0xFFFFFFFF);
+	load_scan = scan;
+	int ok = unpack(u, format);
+	load_scan = 0;
+	if (!ok)
+		return 0;
+	unsigned int size = u->out_pos;
+	crc_add_words(buffer, size & ~3);
+	if (u->has_crc && crc_result(buffer + (size & ~3), size & 3) != u->crc)
+		return 0;
+	if (scan) {
+		scan->size = size;
+		sig_scan(scan, buffer + scan->pos, size - scan->pos);
+	}
+	return size;
+}
+
+/* ROM Patches
+ * -----------
+ * Patches are written into the image once it is loaded and its type is known, so
+ * the kernels serve them like any other byte. A rom's own patches are in
+ * /PATCHES/ under its file name with the extension .PAT (Pitfall.bin ->
+ * /PATCHES/Pitfall.pat), and /PATCHES.TXT can hold patches for any number of
+ * roms. Each line is a bank, an offset in the bank and the bytes to write there,
+ * all in hex, optionally followed by "=" and the bytes that have to be there for
+ * the line to apply:
+ *
+ *     ; infinite lives
+ *     1 0F2A EA EA = C6 D5
+ *     [3A6C29F1]
+ *     0 F7E2 60
+ *
+ * A "[crc]" line limits the lines after it to the rom with that CRC-32 (as in the
+ * cart database); in /PATCHES.TXT the lines before the first one are for no rom.
+ * Banks are counted from the start of the image in the cart type's bank size
+ * (cart_bank_size()), and offsets wrap around the bank, so addresses as the 6507
+ * sees them ($1000-$1FFF, $F000-$FFFF) can be used as they are. A line that
+ * doesn't fit in its bank or the image is skipped. Supercharger images are read
+ * from the card as they play, so they can't be patched. The time patching takes
+ * goes in profile.csv (patch_us), and after a patched rom's game is left the
+ * status line shows it after the launch time, e.g. "807 READ P1".
+ */
+#define PATCH_FILE		"/PATCHES.TXT"
+#define PATCH_DIR		"/PATCHES"
+#define PATCH_EXT		".PAT"
+#define PATCH_MAX_BYTES	16
+#define PATCH_LINE_SIZE	128
+
+// a patch's bank unit for each cart type, 0 if it can't be patched
+int cart_bank_size(int cart_type) {
+	if (cart_type == CART_TYPE_NONE || cart_type == CART_TYPE_AR)
+		return 0;
+	if (cart_type == CART_TYPE_E0)
+		return 1024;
+	if (cart_type == CART_TYPE_2K || cart_type == CART_TYPE_3F || cart_type == CART_TYPE_3E ||
+		cart_type == CART_TYPE_CV || cart_type == CART_TYPE_E7)
+		return 2048;
+	return 4096;
+}
+
+// applies a "bank offset bytes [= expected]" line to the image in the buffer,
+// returns 1 if it was applied
+int patch_line(char *line, unsigned int bank_size, unsigned int image_size) {
+	uint8_t bytes[2][PATCH_MAX_BYTES];
+	unsigned int n[2] = { 0, 0 }, side = 0;
+	char *p = line, *end;
+
+	uint32_t bank = strtoul(p, &end, 16);
+	if (end == p) return 0;
+	uint32_t offset = strtoul(p = end, &end, 16);
+	if (end == p) return 0;
+	for (p = end; ; p = end) {
+		while (*p == ' ' || *p == '\t') p++;
+		if (*p == '=' && !side) {
+			side = 1;
+			end = p + 1;
+			continue;
+		}
+		if (!*p || *p == ';' || *p == '\r' || *p == '\n')
+			break;
+		uint32_t b = strtoul(p, &end, 16);
+		if (end == p || b > 0xFF || n[side] == PATCH_MAX_BYTES)
+			return 0;
+		bytes[side][n[side]++] = b;
+	}
+	if (!n[0] || (side && n[1] != n[0]))
+		return 0;
+	offset &= bank_size - 1;
+	if (bank > image_size / bank_size || offset + n[0] > bank_size)
+		return 0;
+	uint32_t pos = bank * bank_size + offset;
+	if (pos + n[0] > image_size || (side && memcmp(buffer + pos, bytes[1], n[0])))
+		return 0;
+	memcpy(buffer + pos, bytes[0], n[0]);
+	return 1;
+}
+
+// applies the lines of a patch file that are for the rom with this crc, those
+// outside a section too if the file is the rom's own. returns how many applied
+int patch_file(char *path, int own, uint32_t crc, unsigned int bank_size, unsigned int image_size) {
+	FIL fil;
+	char line[PATCH_LINE_SIZE];
+	int active = own, applied = 0;
+
+	if (f_open(&fil, path, FA_READ) != FR_OK)
+		return 0;
+	while (f_gets(line, sizeof(line), &fil)) {
+		int len = strlen(line);
+		if (line[len - 1] != '\n' && !f_eof(&fil)) {
+			// too long to be a patch, skip the rest of it
+			while (f_gets(line, sizeof(line), &fil) && line[strlen(line) - 1] != '\n');
+			continue;
+		}
+		char *p = line;
+		while (*p == ' ' || *p == '\t') p++;
+		if (*p == '[')
+			active = strtoul(p + 1, 0, 16) == crc;
+		else if (active)
+			applied += patch_line(p, bank_size, image_size);
+	}
+	f_close(&fil);
+	return applied;
+}
+
+// applies a loaded rom's patches on the mounted card, returns how many applied
+int patch_image(char *filename, int cart_type, uint32_t crc, unsigned int image_size) {
+	char path[sizeof(PATCH_DIR) + _MAX_LFN + sizeof(PATCH_EXT)];
+	unsigned int bank_size = cart_bank_size(cart_type);
+	if (!bank_size)
+		return 0;
+
+	profile_begin(PHASE_PATCH);
+	char *name = strrchr(filename, '/');
+	name = name ? name + 1 : filename;
+	int len = strlen(name);
+	char *dot = strrchr(name, '.');
+	if (dot && dot != name)
+		len = dot - name;
+	int applied = 0;
+	if (len <= _MAX_LFN) {
+		sprintf(path, PATCH_DIR "/%.*s" PATCH_EXT, len, name);
+		applied = patch_file(path, 1, crc, bank_size, image_size);
+	}
+	applied += patch_file(PATCH_FILE, 0, crc, bank_size, image_size);
+	profile_end(PHASE_PATCH);
+	profile_patches(applied);
+	return applied;
+}
+
+// loads a rom into the buffer, cart_type is CART_TYPE_NONE unless it is already known
+int identify_cartridge(char *filename, int cart_type)
+{
+	TM_DELAY_Init();
+	FATFS FatFs;
+	unsigned int image_size;
+	FIL fil;
+
+	if (mount_card(&FatFs) != FR_OK) return CART_TYPE_NONE;
+	if (f_open(&fil, filename, FA_READ) != FR_OK) {
+		cart_type = CART_TYPE_NONE;
+		goto unmount;
+	}
+	int format = unpack_format(filename);
+
+	// select type by file extension?
+	if (cart_type == CART_TYPE_NONE && format == UNPACK_NONE)
+		cart_type = cart_type_from_extension(filename);
+
+	image_size = f_size(&fil);
+
+	// Supercharger cartridges get special treatment, since we don't load the entire
+	// file into the buffer here
+	if (cart_type == CART_TYPE_NONE && format == UNPACK_NONE && (image_size % 8448) == 0)
+		cart_type = CART_TYPE_AR;
+	if (cart_type == CART_TYPE_AR) goto close;
+
+	unsigned int bytes_to_read;
+	SIG_SCAN scan;
+	crc_start();
+	if (format != UNPACK_NONE)
+	{	// a compressed rom is unpacked as it is read, then its own name may tell the type
+		profile_begin(PHASE_READ);
+		bytes_to_read = image_size = load_packed_image(&fil, format, cart_type == CART_TYPE_NONE ? &scan : 0, 1);
+		profile_end(PHASE_READ);
+		if (cart_type == CART_TYPE_NONE)
+			cart_type = cart_type_from_extension(rom_unpack.name);
+		if (!image_size || cart_type == CART_TYPE_AR || (cart_type == CART_TYPE_NONE && (image_size % 8448) == 0))
+		{	// the supercharger reads its images from the card, so they can't be compressed
+			cart_type = CART_TYPE_NONE;
+			goto close;
+		}
+	}
+	else
+	{	// otherwise, read the file into the cartridge buffer, and if we don't already know
+		// the type (from the file extension), auto-detect it as it arrives
+		bytes_to_read = image_size > (BUFFER_SIZE * 1024) ? (BUFFER_SIZE * 1024) : image_size;
+		profile_begin(PHASE_READ);
+		int loaded = load_image(&fil, bytes_to_read, cart_type == CART_TYPE_NONE ? &scan : 0, 1);
+		profile_end(PHASE_READ);
+		if (!loaded) {
+			cart_type = CART_TYPE_NONE;
+			goto close;
+		}
+	}
+	uint32_t crc = crc_result(buffer + (bytes_to_read & ~3), bytes_to_read & 3);
+	if (cart_type == CART_TYPE_NONE) {
+		// a rom in the database needs no guessing
+		profile_begin(PHASE_DETECT);
+		cart_type = cart_db_lookup(crc);
+		if (cart_type == CART_TYPE_NONE)
+			cart_type = detect_cart_type(image_size, bytes_to_read, &scan);
+		profile_end(PHASE_DETECT);
+	}
+	cart_crc = crc;
+	patch_image(filename, cart_type, crc, bytes_to_read);
+
+	close:
+		f_close(&fil);
+
+	unmount:
+		f_mount(0, "", 1);
+
+	if (cart_type)
+		cart_size_bytes = image_size;
+
+	return cart_type;
+}
+
+/* ROM Catalog
+ * -----------
+ * The "(ALL ROMS)" entry at the top of the root folder lists every rom on the
+ * card in one sorted listing. It is built on demand by walking the whole card
+ * once: each rom is read to take its CRC-32 and detect its cart type, and gets
+ * a fixed size record in /.unocart/catalog, in the order they were found. The
+ * listing itself is kept like any other folder's, as an index with the pseudo
+ * cluster CATALOG_INDEX_CLUSTER, so it is rebuilt when the card generation
+ * changes (or on request, for volumes without one). Each listing entry's short
+ * name is its record number in hex, so launching a rom only reads its record
+ * to get the path and the cart type, then skips type detection.
+ *
+ * The catalog it replaces is kept as a cache of what was found. A rom whose
+ * path, file size and date and time are those of the old catalog's next records
+ * (within CATALOG_CACHE_AHEAD, the walk goes in the same order) is added with
+ * the old record's CRC and cart type, and isn't read at all, so a rebuild only
+ * reads the roms that are new or have changed.
+ */
+#define CATALOG_FILE			"/.unocart/catalog"
+#define CATALOG_OLD_FILE		"/.unocart/catalog.old"
+#define CATALOG_MAGIC			0x32434355	// "UCC2"
+#define CATALOG_INDEX_CLUSTER	0xFFFFFFFF
+#define CATALOG_MAX_RECORDS		(DIR_MAX_ENTRIES - 3)	// with the two menu entries and the note
+#define CATALOG_MAX_PATH		83		// short names, so 128 byte records
+#define CATALOG_MAX_DEPTH		8
+#define CATALOG_CACHE_AHEAD		8	// records
+
+typedef struct {
+	uint32_t magic;
+	uint32_t card_gen;
+	uint32_t num_records;
+	uint32_t reserved;
+} CATALOG_HEADER;
+
+typedef struct {
+	uint32_t size;	// of the rom, unpacked
+	uint32_t crc;
+	uint8_t cart_type;
+	char name[DIR_MAX_LFN + 1];
+	char path[CATALOG_MAX_PATH];
+	uint16_t fdate, ftime;	// of the file
+} CATALOG_RECORD;
+
+typedef struct {
+	FIL fil;	// the catalog being written
+	CATALOG_HEADER header;
+	char path[CATALOG_MAX_PATH];
+	FIL old;	// the one it replaces
+	uint32_t old_next, old_records;	// the record to look at next, and how many there are
+} CATALOG_BUILD;
+
+CATALOG_BUILD catalog_build;
+int catalog_rebuild = 0;	// set to rebuild the catalog on the next visit
+
+// looks for the rom at catalog_build.path in the next records of the old catalog,
+// returns 1 with its record in rec if it's there and the file hasn't changed
+int catalog_cached(FILINFO *info, CATALOG_RECORD *rec) {
+	CATALOG_BUILD *b = &catalog_build;
+	UINT bytes_read;
+
+	for (uint32_t i = b->old_next; i < b->old_records && i < b->old_next + CATALOG_CACHE_AHEAD; i++) {
+		if (f_lseek(&b->old, sizeof(CATALOG_HEADER) + i * sizeof(CATALOG_RECORD)) != FR_OK ||
+			f_read(&b->old, rec, sizeof(CATALOG_RECORD), &bytes_read) != FR_OK || bytes_read != sizeof(CATALOG_RECORD))
+			break;
+		rec->path[CATALOG_MAX_PATH - 1] = 0;
+		if (strcmp(rec->path, b->path))
+			continue;
+		b->old_next = i + 1;
+		// a packed rom's size is that of the rom inside, its file's date tells
+		return rec->fdate == info->fdate && rec->ftime == info->ftime &&
+			(unpack_format(b->path) != UNPACK_NONE || rec->size == info->fsize);
+	}
+	return 0;
+}
+
+// adds the rom at catalog_build.path, if its type can be told
+void catalog_add_rom(FILINFO *info) {
+	CATALOG_RECORD rec;
+	FIL fil;
+	SIG_SCAN scan;
+	UINT chunk = 0, bytes_written;
+	char *name = info->lfname[0] ? info->lfname : info->fname;
+
+	if (catalog_cached(info, &rec))
+		goto add;
+	if (f_open(&fil, catalog_build.path, FA_READ) != FR_OK)
+		return;
+	int format = unpack_format(catalog_build.path);
+	memset(&rec, 0, sizeof(rec));
+	int detected = CART_TYPE_NONE, ok = 1;
+	crc_start();
+	if (format != UNPACK_NONE)
+	{	// the record has the size and crc of the rom inside
+		chunk = rec.size = load_packed_image(&fil, format, &scan, 0);
+		rec.cart_type = cart_type_from_extension(rom_unpack.name);
+		ok = rec.size && rec.cart_type != CART_TYPE_AR && (rec.cart_type != CART_TYPE_NONE || (rec.size % 8448) != 0);
+		if (ok && rec.cart_type == CART_TYPE_NONE)
+			detected = detect_cart_type(rec.size, rec.size, &scan);
+	}
+	else
+	{
+		rec.size = f_size(&fil);
+		rec.cart_type = cart_type_from_extension(catalog_build.path);
+		if (rec.cart_type == CART_TYPE_NONE && (rec.size % 8448) == 0)
+			rec.cart_type = CART_TYPE_AR;
+		// supercharger images may not fit the buffer, so take the crc a buffer at a time
+		for (uint32_t pos = 0; pos < rec.size; pos += chunk) {
+			chunk = rec.size - pos > BUFFER_SIZE * 1024 ? BUFFER_SIZE * 1024 : rec.size - pos;
+			int detect = pos == 0 && rec.cart_type == CART_TYPE_NONE;
+			if (!load_image(&fil, chunk, detect ? &scan : 0, 0)) {
+				ok = 0;
+				break;
+			}
+			if (detect)
+				detected = detect_cart_type(rec.size, chunk, &scan);
+		}
+	}
+	f_close(&fil);
+	if (!ok)
+		return;
+	rec.crc = crc_result(buffer + (chunk & ~3), chunk & 3);
+	if (rec.cart_type == CART_TYPE_NONE) {
+		rec.cart_type = cart_db_lookup(rec.crc);
+		if (rec.cart_type == CART_TYPE_NONE)
+			rec.cart_type = detected;
+	}
+	if (rec.cart_type == CART_TYPE_NONE)
+		return;
+
+	strcpy(rec.path, catalog_build.path);
+	rec.fdate = info->fdate;
+	rec.ftime = info->ftime;
+add:
+	memset(rec.name, 0, sizeof(rec.name));
+	strncpy(rec.name, name, DIR_MAX_LFN);
+	if (f_write(&catalog_build.fil, &rec, sizeof(rec), &bytes_written) == FR_OK && bytes_written == sizeof(rec))
+		catalog_build.header.num_records++;
+}
+
+// adds the roms in catalog_build.path and its subfolders, using short names for the paths
+void catalog_scan(int depth) {
+	DIR dir;
+	int len = strlen(catalog_build.path);
+	int total = 0, done = 0;
+
+	if (f_opendir(&dir, catalog_build.path) != FR_OK)
+		return;
+	if (depth == 0)
+	{	// count the root entries for the progress bar
+		while (f_readdir(&dir, &fno) == FR_OK && fno.fname[0])
+			total++;
+		f_readdir(&dir, 0);
+	}
+	while (catalog_build.header.num_records < CATALOG_MAX_RECORDS) {
+		if (f_readdir(&dir, &fno) != FR_OK || fno.fname[0] == 0)
+			break;
+		if (depth == 0)
+			set_menu_progress(++done, total);
+		if (fno.fattrib & (AM_HID | AM_SYS))
+			continue;
+		if (len + 1 + strlen(fno.fname) >= CATALOG_MAX_PATH)
+			continue;
+		catalog_build.path[len] = '/';
+		strcpy(catalog_build.path + len + 1, fno.fname);
+		if (fno.fattrib & AM_DIR) {
+			if (depth < CATALOG_MAX_DEPTH)
+				catalog_scan(depth + 1);
+		}
+		else if (is_valid_file(fno.fname))
+			catalog_add_rom(&fno);
+		catalog_build.path[len] = 0;
+	}
+	f_closedir(&dir);
+}
+
+// opens the catalog at filename to read, returns its number of records, -1 if it
+// isn't one
+int catalog_open(FIL *fil, const char *filename) {
+	CATALOG_HEADER header;
+	UINT bytes_read;
+
+	if (f_open(fil, filename, FA_READ) != FR_OK)
+		return 0;
+	if (f_read(fil, &header, sizeof(header), &bytes_read) != FR_OK || bytes_read != sizeof(header) ||
+		header.magic != CATALOG_MAGIC || header.num_records > CATALOG_MAX_RECORDS)
+	{
+		f_close(fil);
+		return -1;
+	}
+	return header.num_records;
+}
+
+// walks the card and writes the catalog, returns 0 if it couldn't be written
+int catalog_write(uint32_t card_gen) {
+	CATALOG_BUILD *b = &catalog_build;
+	UINT bytes_written;
+	char filename[32];
+
+	if (f_mkdir(DIR_INDEX_ROOT) == FR_OK)
+		f_chmod(DIR_INDEX_ROOT, AM_HID, AM_HID);
+	f_mkdir(DIR_INDEX_DIR);
+	// the old listing refers to the old records
+	dir_index_filename(filename, CATALOG_INDEX_CLUSTER);
+	f_unlink(filename);
+	// the old catalog is the cache, unless it's one that was cut short and the
+	// one before it is still there
+	if (catalog_open(&b->old, CATALOG_FILE) >= 0) {
+		f_close(&b->old);
+		f_unlink(CATALOG_OLD_FILE);
+		f_rename(CATALOG_FILE, CATALOG_OLD_FILE);
+	}
+	int old_records = catalog_open(&b->old, CATALOG_OLD_FILE);
+	b->old_records = old_records < 0 ? 0 : old_records;
+	b->old_next = 0;
+
+	int ok = f_open(&b->fil, CATALOG_FILE, FA_WRITE | FA_CREATE_ALWAYS) == FR_OK;
+	if (ok) {
+		CATALOG_HEADER header = { 0, card_gen, 0, 0 };
+		b->header = header;
+		ok = f_write(&b->fil, &header, sizeof(header), &bytes_written) == FR_OK && bytes_written == sizeof(header);
+		if (ok) {
+			b->path[0] = 0;
+			catalog_scan(0);
+			// only mark the catalog valid once it is complete
+			b->header.magic = CATALOG_MAGIC;
+			ok = f_lseek(&b->fil, 0) == FR_OK &&
+				f_write(&b->fil, &b->header, sizeof(header), &bytes_written) == FR_OK && bytes_written == sizeof(header);
+		}
+		f_close(&b->fil);
+	}
+	if (old_records >= 0)
+		f_close(&b->old);
+	if (ok)
+		f_unlink(CATALOG_OLD_FILE);
+	return ok;
+}
+
+// builds the catalog listing from the records, sorted by name (reading the roms
+// has overwritten the buffer)
+int catalog_list() {
+	FIL fil;
+	UINT bytes_read;
+	CATALOG_RECORD rec;
+	char number[4];
+
+	int num_records = catalog_open(&fil, CATALOG_FILE);
+	if (num_records < 0)
+		return 0;
+	num_dir_entries = 0;
+	dir_names_size = 0;
+	dir_full = 0;
+	add_dir_entry(DIR_ENTRY_IS_DIR, "..", "(GO BACK)");
+	add_dir_entry(DIR_ENTRY_IS_DIR, CATALOG_NAME, "(REBUILD LIST)");
+	for (int i = 0; i < num_records; i++) {
+		if (f_read(&fil, &rec, sizeof(rec), &bytes_read) != FR_OK || bytes_read != sizeof(rec))
+			break;
+		for (int d = 0; d < 3; d++)
+			number[d] = "0123456789ABCDEF"[(i >> ((2 - d) * 4)) & 0xF];
+		number[3] = 0;
+		rec.name[DIR_MAX_LFN] = 0;
+		if (!add_dir_entry(0, number, rec.name))
+			break;	// names don't fit, list as many as do
+	}
+	f_close(&fil);
+	sort_directory(2);
+	add_dir_full_note();
+	return 1;
+}
+
+int read_catalog() {
+	DIR_INDEX_GEN gen;
+
+	end_directory(DIR_SCAN_MORE);
+	num_dir_entries = 0;
+	dir_names_size = 0;
+	dir_letters_valid = 0;
+
+	TM_DELAY_Init();
+	if (mount_card(&dir_scan.fs) != FR_OK)
+		return 0;
+	// without a generation the catalog is only rebuilt on request
+	int has_gen = dir_index_read_gen(&dir_scan.fs, &gen);
+	DIR_INDEX_HEADER header = { DIR_INDEX_MAGIC, DIR_INDEX_VERSION, 0, 0, 0, CATALOG_INDEX_CLUSTER, has_gen ? gen.gen : 0, 0, 0, 0 };
+	int ret = 1;
+
+	dir_scan.header = header;
+	if (catalog_rebuild || !dir_index_load(&header, 1)) {
+		dir_stack_discard();	// reading the roms takes the whole buffer
+		ret = catalog_write(header.card_gen) && catalog_list();
+		if (ret)
+			dir_index_save(&header);
+		if (has_gen)
+			dir_index_write_gen(&dir_scan.fs, &gen);
+		catalog_rebuild = 0;
+	}
+	f_mount(0, "", 1);
+	if (ret)
+		index_directory_letters();
+	else
+		num_dir_entries = 0;
+	return ret;
+}
+
+// reads the record behind a catalog listing entry, returns its cart type
+int catalog_lookup(DIR_ENTRY e, char *path) {
+	FATFS FatFs;
+	FIL fil;
+	UINT bytes_read;
+	CATALOG_RECORD rec;
+	int cart_type = CART_TYPE_NONE;
+
+	TM_DELAY_Init();
+	if (mount_card(&FatFs) != FR_OK)
+		return CART_TYPE_NONE;
+	if (f_open(&fil, CATALOG_FILE, FA_READ) == FR_OK) {
+		uint32_t n = strtoul(dir_entry_filename(e), 0, 16);
+		if (f_lseek(&fil, sizeof(CATALOG_HEADER) + n * sizeof(CATALOG_RECORD)) == FR_OK &&
+			f_read(&fil, &rec, sizeof(rec), &bytes_read) == FR_OK && bytes_read == sizeof(rec))
+		{
+			rec.path[CATALOG_MAX_PATH - 1] = 0;
+			strcpy(path, rec.path);
+			cart_type = rec.cart_type;
+		}
+		f_close(&fil);
+	}
+	f_mount(0, "", 1);
+	return cart_type;
+}
+
+/*************************************************************************
+ * MCU Initialisation
+ *************************************************************************/
+
+/* Input/Output data GPIO pins on PE{8..15} */
+void config_gpio_data(void) {
+	RCC->AHB1ENR |= RCC_AHB1ENR_GPIOEEN;
+	GPIOE->MODER &= 0x0000FFFF;		// input, until a kernel drives the bus
+	GPIOE->OTYPER &= 0x00FF;		// push-pull
+	GPIOE->OSPEEDR = (GPIOE->OSPEEDR & 0x0000FFFF) | 0x55550000;	// 25MHz
+	GPIOE->PUPDR &= 0x0000FFFF;		// no pull
+}
+
+/* Input Address GPIO pins on PD{0..15} */
+void config_gpio_addr(void) {
+	RCC->AHB1ENR |= RCC_AHB1ENR_GPIODEN;
+	GPIOD->MODER = 0x00000000;		// input
+	GPIOD->OSPEEDR = 0xFFFFFFFF;	// 100MHz
+	GPIOD->PUPDR = 0xAAAAAAAA;		// pull down
+}
+
+/* Input Signals GPIO pins - PC0, PC1 (PC0=0 PAL60, PC1=0 PAL) */
+void config_gpio_sig(void) {
+	RCC->AHB1ENR |= RCC_AHB1ENR_GPIOCEN;
+	GPIOC->MODER &= ~0x0000000F;	// input
+	GPIOC->OSPEEDR = (GPIOC->OSPEEDR & ~0x0000000F) | 0x00000005;	// 25MHz
+	GPIOC->PUPDR = (GPIOC->PUPDR & ~0x0000000F) | 0x00000005;	// pull up
+}
+
+int read_tv_mode(void) {
+	if (!(GPIOC->IDR & 0x0001))
+		return TV_MODE_PAL60;
+	if (!(GPIOC->IDR & 0x0002))
+		return TV_MODE_PAL;
+	return TV_MODE_NTSC;
+}
+
+/* Boot
+ * The 6507 starts fetching as soon as the console is on, so the Reset_Handler
+ * calls boot_firmware_cartridge() before anything else. It starts the PLL and
+ * switches to it before it answers the bus at all: at the 16MHz HSI clock the
+ * kernel gets about 13 cycles per 6507 access, too few to serve one, and a
+ * clock switch between two accesses could land on either. Until then the bus
+ * floats, as it did for far longer when the menu was served only after main()
+ * had set everything up. It then serves the menu rom from flash, copying .data
+ * and .ramfunc and zeroing .bss a word at a time while it waits for the bus to
+ * change. It returns with the menu's first command, when the 6507 is running
+ * from its own RAM and the rest of main() can take its time. Until memory is
+ * set up it only uses locals. boot_timeline keeps when each stage was reached,
+ * and profile_log() writes the first access and the first command out with
+ * every launch (reset_us and menu_us in profile.csv).
+ *
+ * After $1FF4 it still serves only the rom image, none of what
+ * emulate_firmware_cartridge() puts over it: before its first command the menu
+ * (Start in UnoCart2600_*.asm) runs from $F000-$F47F, copies WaitCartRoutine
+ * from there to its RAM, reads $1FF4 and the reset vector and nothing else of
+ * the cart. The menu RAM ($1800-$1BFF), the glyphs ($1480-$157F), the status
+ * bytes ($1FE0-$1FEF) and the jump window ($1FDE) are first read after the
+ * first command, which is where this kernel stops.
+ */
+extern uint32_t _sidata[], _sdata[], _edata[];
+extern uint32_t _siramfunc[], _sramfunc[], _eramfunc[];
+extern uint32_t _sbss[], _ebss[];
+
+#define BOOT_CLOCK			0	// switched to the PLL, cycles up to here are at HSI_VALUE
+#define BOOT_FIRST_ACCESS	1	// the first access to the cartridge was served
+#define BOOT_MEMORY			2	// .data, .ramfunc and .bss are set up
+#define BOOT_UNLOCK			3	// the menu accessed $1FF4
+#define BOOT_COMMAND		4	// the menu's first command
+#define BOOT_STAGES			5
+
+uint32_t boot_timeline[BOOT_STAGES];	// DWT cycles since reset
+int boot_command;	// the command the boot kernel broke on, until main() takes it
+
+typedef struct {
+	uint32_t *src, *dst, *end;	// src is 0 while zeroing
+	int region;
+} BOOT_INIT;
+
+// copies or zeroes one word, returns 0 once memory is set up
+static inline __attribute__((always_inline)) int boot_init_step(BOOT_INIT *b) {
+	if (b->dst < b->end) {
+		*b->dst++ = b->src ? *b->src++ : 0;
+		return 1;
+	}
+	if (b->region == 0) {
+		b->src = _siramfunc; b->dst = _sramfunc; b->end = _eramfunc;
+	}
+	else if (b->region == 1) {
+		b->src = 0; b->dst = _sbss; b->end = _ebss;
+	}
+	else
+		return 0;
+	b->region++;
+	return 1;
+}
+
+void boot_firmware_cartridge() {
+	uint32_t timeline[BOOT_STAGES] = {0};
+	BOOT_INIT setup = { _sidata, _sdata, _edata, 0 };
+	int setting_up = 1, unlocked = 0;
+
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	config_gpio_data();
+	config_gpio_addr();
+	config_gpio_sig();
+	SystemInitStart();
+	const unsigned char *rom = get_firmware_rom(read_tv_mode());
+	// waits for the PLL to lock, with the data pins still inputs
+	SystemInitFinish();
+	timeline[BOOT_CLOCK] = DWT->CYCCNT;
+
+	// the part of emulate_firmware_cartridge() before $1FF4, setting up memory in the waits
+	uint16_t addr, addr_prev = 0;
+	while (1)
+	{
+		while ((addr = ADDR_IN) != addr_prev)
+			addr_prev = addr;
+		// got a stable address
+		if (addr & 0x1000)
+		{ // A12 high
+			if (unlocked && addr >= CART_CMD_WINDOW_n && addr < 0x1F00) break;	// the menu's first command
+			DATA_OUT = ((uint16_t)rom[addr&0xFFF])<<8;
+			SET_DATA_MODE_OUT
+			if (!timeline[BOOT_FIRST_ACCESS])
+				timeline[BOOT_FIRST_ACCESS] = DWT->CYCCNT;
+			// wait for address bus to change
+			while (ADDR_IN == addr)
+				if (setting_up)
+					setting_up = boot_init_step(&setup);
+			SET_DATA_MODE_IN
+			if (addr == 0x1FF4 && !unlocked) {
+				unlocked = 1;
+				timeline[BOOT_UNLOCK] = DWT->CYCCNT;
+			}
 		}
 		else
-			cart_type = CART_TYPE_F0;
+			while (ADDR_IN == addr)
+				if (setting_up)
+					setting_up = boot_init_step(&setup);
+
+		if (!setting_up && !timeline[BOOT_MEMORY])
+			timeline[BOOT_MEMORY] = DWT->CYCCNT;
 	}
+	timeline[BOOT_COMMAND] = DWT->CYCCNT;
 
-	close:
-		f_close(&fil);
+	// the 6507 is running from its own RAM now, so finish anything the menu was too quick for
+	while (boot_init_step(&setup)) ;
+	if (!timeline[BOOT_MEMORY])
+		timeline[BOOT_MEMORY] = DWT->CYCCNT;
 
-	unmount:
-		f_mount(0, "", 1);
+	memcpy(boot_timeline, timeline, sizeof(boot_timeline));
+	boot_command = addr;
+	comms_enabled = true;
+}
 
-	if (cart_type)
-		cart_size_bytes = image_size;
+// microseconds from reset to a boot stage
+uint32_t boot_time_us(int stage) {
+	uint32_t t = boot_timeline[stage], clock = boot_timeline[BOOT_CLOCK];
+	if (t <= clock)
+		return t / (HSI_VALUE / 1000000);
+	return clock / (HSI_VALUE / 1000000) + (t - clock) / (SystemCoreClock / 1000000);
+}
 
-	return cart_type;
+/* Launch Profile Log
+ * Each launch appends a line to /.unocart/profile.csv in the pause before the
+ * cart starts, so that load times can be compared across firmware builds. The
+ * phases are totals since boot, and load_us is the launch up to the pause.
+ */
+#define PROFILE_LOG_FILE	DIR_INDEX_ROOT "/profile.csv"
+#define PROFILE_BUILD		__DATE__ " " __TIME__
+
+void profile_log(char *rom) {
+	FIL fil;
+	UINT bytes;
+	char line[160 + sizeof(cartridge_image_path)];
+	int len = 0;
+
+	if (f_mkdir(DIR_INDEX_ROOT) == FR_OK)
+		f_chmod(DIR_INDEX_ROOT, AM_HID, AM_HID);
+	if (f_open(&fil, PROFILE_LOG_FILE, FA_WRITE | FA_OPEN_ALWAYS) != FR_OK)
+		return;
+	if (f_size(&fil) == 0) {
+		len += sprintf(line + len, "build,reset_us,menu_us");
+		for (int i = 0; i < PHASE_PAUSE; i++)
+			len += sprintf(line + len, ",%s_us", profile_phase_names[i]);
+		len += sprintf(line + len, ",load_us,rom\r\n");
+	}
+	len += sprintf(line + len, "%s,%u,%u", PROFILE_BUILD,
+		(unsigned int)boot_time_us(BOOT_FIRST_ACCESS), (unsigned int)boot_time_us(BOOT_COMMAND));
+	for (int i = 0; i < PHASE_PAUSE; i++)
+		len += sprintf(line + len, ",%u", (unsigned int)profile_us(i));
+	len += sprintf(line + len, ",%u,\"%s\"\r\n", (unsigned int)profile_launch_us(), rom);
+	if (f_lseek(&fil, f_size(&fil)) == FR_OK)
+		f_write(&fil, line, len, &bytes);
+	f_close(&fil);
 }
 
-/*************************************************************************
- * MCU Initialisation
- *************************************************************************/
+// mounts the card in the pause before a cart starts to write the launch profile
+// of a rom, keeping the card generation
+void launch_save(char *rom) {
+	FATFS FatFs;
+	DIR_INDEX_GEN gen;
 
-GPIO_InitTypeDef  GPIO_InitStructure;
+	if (!rom)
+		return;
+	TM_DELAY_Init();
+	if (mount_card(&FatFs) != FR_OK)
+		return;
+	int has_gen = dir_index_read_gen(&FatFs, &gen);
+	profile_log(rom);
+	if (has_gen)
+		dir_index_write_gen(&FatFs, &gen);
+	f_mount(0, "", 1);
+}
 
-/* Input/Output data GPIO pins on PE{8..15} */
-void config_gpio_data(void) {
-	/* GPIOE Periph clock enable */
-	RCC_AHB1PeriphClockCmd(RCC_AHB1Periph_GPIOE, ENABLE);
+/* Card Benchmark
+ * Reset and select together in the menu time the card through the same
+ * disk_read() calls that loading uses: whole clusters read straight into the
+ * buffer as f_read() does for a rom, single sectors scattered over the data
+ * area as a folder index costs, and FAT lookups as a raw folder scan follows
+ * its cluster chain. Nothing is written but the result, which is shown in the
+ * status line and added to /.unocart/benchmark.csv.
+ * The reads go into the part of the buffer the listing and the folder stack
+ * leave free, so the menu stays as it was.
+ */
+#define BENCHMARK_FILE			DIR_INDEX_ROOT "/benchmark.csv"
+#define BENCHMARK_SEQ_BYTES		(1024 * 1024)
+#define BENCHMARK_CHUNK_MAX		(32 * 1024)
+#define BENCHMARK_RANDOM_READS	64
+#define BENCHMARK_FAT_SECTORS	64
 
-	/* Configure GPIO Settings */
-	GPIO_InitStructure.GPIO_Pin =
-		GPIO_Pin_8 | GPIO_Pin_9 | GPIO_Pin_10 | GPIO_Pin_11 |
-		GPIO_Pin_12 | GPIO_Pin_13 | GPIO_Pin_14 | GPIO_Pin_15;
-	GPIO_InitStructure.GPIO_Mode = GPIO_Mode_IN;
-	GPIO_InitStructure.GPIO_OType = GPIO_OType_PP;
-	GPIO_InitStructure.GPIO_Speed = GPIO_Speed_25MHz;
-	GPIO_InitStructure.GPIO_PuPd = GPIO_PuPd_NOPULL;
-	GPIO_Init(GPIOE, &GPIO_InitStructure);
+typedef struct {
+	uint32_t mount_us;
+	uint32_t seq_kb_s;	// sequential throughput, chunk_sectors to a read
+	uint32_t chunk_sectors;
+	uint32_t random_avg_us;	// single sector reads
+	uint32_t random_max_us;
+	uint32_t fat_clusters_s;	// cluster chain lookups, 0 on FAT12
+} BENCHMARK;
+
+static uint32_t benchmark_us(uint32_t cycles) {
+	return cycles / (SystemCoreClock / 1000000);
 }
 
-/* Input Address GPIO pins on PD{0..15} */
-void config_gpio_addr(void) {
-	/* GPIOD Periph clock enable */
-	RCC_AHB1PeriphClockCmd(RCC_AHB1Periph_GPIOD, ENABLE);
-
-	/* Configure GPIO Settings */
-	GPIO_InitStructure.GPIO_Pin =
-		GPIO_Pin_0 | GPIO_Pin_1 | GPIO_Pin_2 | GPIO_Pin_3 |
-		GPIO_Pin_4 | GPIO_Pin_5 | GPIO_Pin_6 | GPIO_Pin_7 |
-		GPIO_Pin_8 | GPIO_Pin_9 | GPIO_Pin_10 | GPIO_Pin_11 |
-		GPIO_Pin_12 | GPIO_Pin_13 | GPIO_Pin_14 | GPIO_Pin_15;
-	GPIO_InitStructure.GPIO_Mode = GPIO_Mode_IN;
-	GPIO_InitStructure.GPIO_OType = GPIO_OType_PP;
-	GPIO_InitStructure.GPIO_Speed = GPIO_Speed_100MHz;
-	GPIO_InitStructure.GPIO_PuPd = GPIO_PuPd_DOWN;
-	GPIO_Init(GPIOD, &GPIO_InitStructure);
+// runs the three tests on a mounted card, returns 0 on a read error
+int benchmark_card(FATFS *fs, BENCHMARK *b, uint8_t *dst, uint32_t room) {
+	uint32_t data_sects = (fs->n_fatent - 2) * fs->csize;
+	uint32_t chunk = fs->csize;
+	if (chunk > BENCHMARK_CHUNK_MAX / 512) chunk = BENCHMARK_CHUNK_MAX / 512;
+	if (chunk > room / 512) chunk = room / 512;
+	uint32_t chunks = BENCHMARK_SEQ_BYTES / 512 / chunk;
+	if (chunks > data_sects / chunk) chunks = data_sects / chunk;
+	uint32_t fat_lookups = BENCHMARK_FAT_SECTORS * (fs->fs_type == FS_FAT32 ? 128 : 256);
+	if (fat_lookups > fs->n_fatent - 2) fat_lookups = fs->n_fatent - 2;
+	uint32_t total = chunks + BENCHMARK_RANDOM_READS + 1, done = 0;
+
+	// sequential, from the start of the data area
+	uint32_t start = DWT->CYCCNT;
+	for (uint32_t i = 0; i < chunks; i++) {
+		if (disk_read(fs->drv, dst, fs->database + i * chunk, chunk) != RES_OK)
+			return 0;
+		set_menu_progress(++done, total);
+	}
+	uint32_t us = benchmark_us(DWT->CYCCNT - start);
+	b->chunk_sectors = chunk;
+	b->seq_kb_s = us ? (uint32_t)((uint64_t)chunks * chunk * 500000 / us) : 0;
+
+	// random single sectors, the same on every run
+	uint32_t seed = 1, sum = 0;
+	b->random_max_us = 0;
+	for (int i = 0; i < BENCHMARK_RANDOM_READS; i++) {
+		seed = seed * 1664525 + 1013904223;
+		start = DWT->CYCCNT;
+		if (disk_read(fs->drv, dst, fs->database + seed % data_sects, 1) != RES_OK)
+			return 0;
+		us = benchmark_us(DWT->CYCCNT - start);
+		sum += us;
+		if (us > b->random_max_us) b->random_max_us = us;
+		set_menu_progress(++done, total);
+	}
+	b->random_avg_us = sum / BENCHMARK_RANDOM_READS;
+
+	// the FAT, one cluster at a time
+	b->fat_clusters_s = 0;
+	if (fs->fs_type == FS_FAT16 || fs->fs_type == FS_FAT32) {
+		fs->winsect = 0xFFFFFFFF;	// start on the card, not the window
+		start = DWT->CYCCNT;
+		for (uint32_t clust = 2; clust < fat_lookups + 2; clust++)
+			raw_next_cluster(fs, clust);
+		us = benchmark_us(DWT->CYCCNT - start);
+		if (fs->winsect == 0xFFFFFFFF)
+			return 0;
+		b->fat_clusters_s = us ? (uint32_t)((uint64_t)fat_lookups * 1000000 / us) : 0;
+	}
+	set_menu_progress(++done, total);
+	return 1;
 }
 
-/* Input Signals GPIO pins - PC0, PC1 (PC0=0 PAL60, PC1=0 PAL) */
-void config_gpio_sig(void) {
-	/* GPIOC Periph clock enable */
-	RCC_AHB1PeriphClockCmd(RCC_AHB1Periph_GPIOC, ENABLE);
+void benchmark_log(BENCHMARK *b) {
+	FIL fil;
+	UINT bytes;
+	char line[160];
+	int len = 0;
+
+	if (f_mkdir(DIR_INDEX_ROOT) == FR_OK)
+		f_chmod(DIR_INDEX_ROOT, AM_HID, AM_HID);
+	if (f_open(&fil, BENCHMARK_FILE, FA_WRITE | FA_OPEN_ALWAYS) != FR_OK)
+		return;
+	if (f_size(&fil) == 0)
+		len += sprintf(line + len, "build,mount_us,seq_kb_s,chunk_sectors,random_avg_us,random_max_us,fat_clusters_s\r\n");
+	len += sprintf(line + len, "%s,%u,%u,%u,%u,%u,%u\r\n", PROFILE_BUILD, (unsigned int)b->mount_us,
+		(unsigned int)b->seq_kb_s, (unsigned int)b->chunk_sectors, (unsigned int)b->random_avg_us,
+		(unsigned int)b->random_max_us, (unsigned int)b->fat_clusters_s);
+	if (f_lseek(&fil, f_size(&fil)) == FR_OK)
+		f_write(&fil, line, len, &bytes);
+	f_close(&fil);
+}
 
-	/* Configure GPIO Settings */
-	GPIO_InitStructure.GPIO_Pin = GPIO_Pin_0 | GPIO_Pin_1;
-	GPIO_InitStructure.GPIO_Mode = GPIO_Mode_IN;
-	GPIO_InitStructure.GPIO_OType = GPIO_OType_PP;
-	GPIO_InitStructure.GPIO_Speed = GPIO_Speed_25MHz;
-	GPIO_InitStructure.GPIO_PuPd = GPIO_PuPd_UP;
-	GPIO_Init(GPIOC, &GPIO_InitStructure);
+// benchmarks the card, leaving a 12 character summary in msg
+void benchmark(char *msg) {
+	FATFS FatFs;
+	DIR_INDEX_GEN gen;
+	BENCHMARK b;
+
+	// the free part of the buffer, between the listing's names and the folder stack
+	uint32_t free_start = ((dir_names - (char *)buffer) + dir_names_size + 3) & ~3;
+	uint32_t free_end = BUFFER_SIZE * 1024 - dir_stack_used;
+	if (free_end < free_start + 512) {
+		strcpy(msg, "BUFFER FULL");
+		return;
+	}
+	TM_DELAY_Init();
+	uint32_t start = DWT->CYCCNT;
+	if (mount_card(&FatFs) != FR_OK) {
+		strcpy(msg, "CANT READ SD");
+		return;
+	}
+	b.mount_us = benchmark_us(DWT->CYCCNT - start);
+	if (!benchmark_card(&FatFs, &b, buffer + free_start, free_end - free_start))
+		strcpy(msg, "READ ERROR");
+	else {
+		sprintf(msg, "%uK %uUS", (unsigned int)b.seq_kb_s, (unsigned int)b.random_avg_us);
+		int has_gen = dir_index_read_gen(&FatFs, &gen);
+		benchmark_log(&b);
+		if (has_gen)
+			dir_index_write_gen(&FatFs, &gen);
+	}
+	f_mount(0, "", 1);
 }
 
 /*************************************************************************
@@ -569,17 +2687,378 @@ void config_gpio_sig(void) {
 	uint8_t* cart_rom = buffer; \
 	if (!reboot_into_cartridge()) return;
 
+// the cart ram follows the rom in the buffer, word aligned
+#define cart_ram_start() (buffer + cart_size_bytes + (((~cart_size_bytes & 0x03) + 1) & 0x03))
+
 #define setup_cartridge_image_with_ram() \
 	if (cart_size_bytes > 0x010000) return; \
 	uint8_t* cart_rom = buffer; \
-	uint8_t* cart_ram = buffer + cart_size_bytes + (((~cart_size_bytes & 0x03) + 1) & 0x03); \
+	uint8_t* cart_ram = cart_ram_start(); \
 	if (!reboot_into_cartridge()) return;
 
-void emulate_2k_cartridge() {
+/* Cart RAM Snapshots
+ * ------------------
+ * The ram of SC, FA, FA2, E7 and 3E carts is kept across power offs in the last
+ * two 128K sectors of flash (10 and 11, left out of FLASH by the linker script).
+ * Snapshots are added to the active sector one after another; when it has no room
+ * for another one of the cart about to start, the latest snapshot of each rom is
+ * copied to the other sector, which becomes the active one. The sector that isn't
+ * active is erased once the game is left, while the menu waits in 2600 RAM and
+ * serve_busy_bus() answers it, so no launch waits out an erase (a second or two):
+ * if it isn't erased yet when room is needed, that game goes without a snapshot.
+ * A kernel only programs flash that is already erased, a word at a time as the
+ * flash becomes ready (about every 16us): programming doesn't hold up code running
+ * from RAM, and the kernels don't read the flash. A snapshot is taken when the game is left for the menu by
+ * holding reset down (see Leaving a Game), or on FA2's save hotspot, and the
+ * latest one is put back in the cart ram when the rom is launched again.
+ *
+ * A sector starts with SAVE_SECTOR_MAGIC and a sequence number, the highest being
+ * the active sector. A snapshot is a SAVE_RECORD, the ram and SAVE_DONE, which is
+ * programmed last so that one cut short by a power off is skipped. The ram has to
+ * stay put for the fraction of a second a snapshot takes: one of a game that was
+ * left is programmed once the 6507 runs the menu, and an FA2 game waits on $1FF4
+ * for its own to be done.
+ */
+#define SAVE_SECTORS		2
+#define SAVE_SECTOR_WORDS	(128 * 1024 / 4)
+#define SAVE_SECTOR_MAGIC	0x53534355	// "UCSS"
+#define SAVE_MAGIC			0x52534355	// "UCSR"
+#define SAVE_DONE			0x454E4F44	// "DONE"
+#define SAVE_MAX_SIZE		(32 * 1024)
+#define SAVE_FIRST_RECORD	2	// words, after the magic and the sequence number
+#define SAVE_ERASED			0xFFFFFFFF
+#define SAVE_FLASH_ERRORS	(FLASH_FLAG_EOP | FLASH_FLAG_OPERR | FLASH_FLAG_WRPERR | \
+							 FLASH_FLAG_PGAERR | FLASH_FLAG_PGPERR | FLASH_FLAG_PGSERR)
+
+typedef struct {
+	uint32_t magic;
+	uint32_t crc;	// of the rom
+	uint32_t size;	// of the ram, which follows
+} SAVE_RECORD;
+
+#define SAVE_HEADER_WORDS		(sizeof(SAVE_RECORD) / 4)
+#define save_record_words(size)	(SAVE_HEADER_WORDS + (size) / 4 + 1)
+
+typedef struct {
+	uint32_t *dst;			// next word to write
+	const uint32_t *src;	// next word to copy, 0 to write zeros
+	uint32_t left;			// words left in this part, 0 when idle
+	int saving;				// to the flash, else loading the ram
+	int part;				// of the snapshot being written
+	uint32_t header[SAVE_HEADER_WORDS + 1];	// its SAVE_RECORD, then SAVE_DONE
+	uint32_t *record;		// where it starts
+	uint8_t *status;		// cleared when done, for FA2
+	uint32_t *free, *end;	// room left in the active sector
+	uint32_t *last;			// the rom's latest snapshot, 0 if none
+	uint8_t *ram;			// and its cart ram, size 0 if it has none
+	uint32_t size;
+	int erase;				// the sector to erase after the game, -1 if none
+} CART_SAVE;
+
+CART_SAVE cart_save;
+
+extern uint32_t _ssave[];	// from the linker script
+static const uint16_t save_flash_sectors[SAVE_SECTORS] = { FLASH_Sector_10, FLASH_Sector_11 };
+
+static uint32_t *save_sector(int i) {
+	return _ssave + i * SAVE_SECTOR_WORDS;
+}
+
+static int save_is_erased(uint32_t *p, uint32_t words) {
+	while (words--)
+		if (*p++ != SAVE_ERASED)
+			return 0;
+	return 1;
+}
+
+// the sector with the highest sequence number, -1 if neither is set up
+int save_active_sector() {
+	int active = -1;
+	for (int i = 0; i < SAVE_SECTORS; i++)
+		if (save_sector(i)[0] == SAVE_SECTOR_MAGIC &&
+			(active < 0 || save_sector(i)[1] - save_sector(active)[1] < 0x80000000))
+			active = i;
+	return active;
+}
+
+// the record after r, 0 if r isn't one: the free space, or a record cut short
+// before its size was programmed, which ends the sector's records
+static uint32_t *save_next_record(uint32_t *r, uint32_t *end) {
+	SAVE_RECORD *h = (SAVE_RECORD *)r;
+	if (r + SAVE_HEADER_WORDS > end || h->magic != SAVE_MAGIC || h->size > SAVE_MAX_SIZE || (h->size & 3))
+		return 0;
+	r += save_record_words(h->size);
+	return r <= end ? r : 0;
+}
+
+static int save_record_done(uint32_t *r) {
+	return r[save_record_words(((SAVE_RECORD *)r)->size) - 1] == SAVE_DONE;
+}
+
+// a complete snapshot that no later one of the same rom replaces
+static int save_is_latest(uint32_t *r, uint32_t *end) {
+	if (!save_record_done(r))
+		return 0;
+	uint32_t crc = ((SAVE_RECORD *)r)->crc;
+	for (uint32_t *q = save_next_record(r, end), *next; q && (next = save_next_record(q, end)); q = next)
+		if (((SAVE_RECORD *)q)->crc == crc && save_record_done(q))
+			return 0;
+	return 1;
+}
+
+// walks a sector's records, returning where its free space starts (its end if it
+// has none it can use) and the rom's latest complete snapshot in *last
+uint32_t *save_scan(uint32_t *sector, uint32_t crc, uint32_t size, uint32_t **last) {
+	uint32_t *end = sector + SAVE_SECTOR_WORDS, *r = sector + SAVE_FIRST_RECORD, *next;
+	*last = 0;
+	for (; (next = save_next_record(r, end)); r = next) {
+		SAVE_RECORD *h = (SAVE_RECORD *)r;
+		if (h->crc == crc && h->size == size && save_record_done(r))
+			*last = r;
+	}
+	if (r < end && save_is_erased(r, end - r))
+		return r;
+	return end;
+}
+
+static int save_program(uint32_t *dst, const uint32_t *src, uint32_t words) {
+	for (; words; words--)
+		if (FLASH_ProgramWord((uintptr_t)dst++, *src++) != FLASH_COMPLETE)
+			return 0;
+	return 1;
+}
+
+// copies the latest snapshot of each rom in the active sector (if there is one)
+// to the other, erased one, newest first as long as they leave need words free.
+// the old one is left for cart_save_finish() to erase. returns 0 if the flash failed
+int save_compact(int from, int to, uint32_t need) {
+	uint32_t *dst = save_sector(to) + SAVE_FIRST_RECORD, *end = save_sector(to) + SAVE_SECTOR_WORDS;
+	uint32_t head[SAVE_FIRST_RECORD] = { SAVE_SECTOR_MAGIC, from < 0 ? 0 : save_sector(from)[1] + 1 };
+
+	if (from >= 0) {
+		uint32_t *src_end = save_sector(from) + SAVE_SECTOR_WORDS, *r, *next;
+		uint32_t total = 0;	// of the snapshots still to copy, the oldest are left out if they don't fit
+		for (r = save_sector(from) + SAVE_FIRST_RECORD; (next = save_next_record(r, src_end)); r = next)
+			if (save_is_latest(r, src_end))
+				total += next - r;
+		for (r = save_sector(from) + SAVE_FIRST_RECORD; (next = save_next_record(r, src_end)); r = next) {
+			if (!save_is_latest(r, src_end))
+				continue;
+			if (dst + total + need <= end) {
+				if (!save_program(dst, r, next - r))
+					return 0;
+				dst += next - r;
+			}
+			total -= next - r;
+		}
+	}
+	// the sector counts once its snapshots are in
+	return save_program(save_sector(to) + 1, head + 1, 1) && save_program(save_sector(to), head, 1);
+}
+
+// the bytes of cart ram a cart type has, 0 for none
+uint32_t cart_ram_size(int cart_type) {
+	if (cart_type == CART_TYPE_F8SC || cart_type == CART_TYPE_F6SC || cart_type == CART_TYPE_F4SC ||
+		cart_type == CART_TYPE_EFSC)
+		return 128;
+	if (cart_type == CART_TYPE_FA || cart_type == CART_TYPE_FA2)
+		return 256;
+	if (cart_type == CART_TYPE_E7)
+		return 2048;
+	if (cart_type == CART_TYPE_3E)
+		return 32 * 1024;
+	return 0;
+}
+
+// before a cart starts: makes room in the flash for a snapshot of its ram, with
+// the flash unlocked for the kernel to write it, and restores its latest one.
+// nothing is erased here, only noted for cart_save_finish()
+void cart_save_prepare(int cart_type) {
+	CART_SAVE *s = &cart_save;
+	uint32_t size = cart_ram_size(cart_type), need = save_record_words(size), *last = 0, *free = 0, *end = 0;
+
+	memset(s, 0, sizeof(CART_SAVE));
+	s->erase = -1;
+	if (!size)
+		return;
+	FLASH_Unlock();
+	FLASH_ClearFlag(SAVE_FLASH_ERRORS);
+	int active = save_active_sector(), spare = (active + 1) % SAVE_SECTORS;
+	if (active >= 0) {
+		free = save_scan(save_sector(active), cart_crc, size, &last);
+		end = save_sector(active) + SAVE_SECTOR_WORDS;
+	}
+	if (active < 0 || free + need > end) {
+		if (save_is_erased(save_sector(spare), SAVE_SECTOR_WORDS) && save_compact(active, spare, need)) {
+			int from = active;
+			active = spare;
+			spare = from < 0 ? (active + 1) % SAVE_SECTORS : from;
+			free = save_scan(save_sector(active), cart_crc, size, &last);
+			end = save_sector(active) + SAVE_SECTOR_WORDS;
+		}
+		else	// no room this time
+			free = end;
+	}
+	if (!save_is_erased(save_sector(spare), SAVE_SECTOR_WORDS))
+		s->erase = spare;
+	s->ram = cart_ram_start();
+	if (last) {
+		memcpy(s->ram, last + SAVE_HEADER_WORDS, size);
+		if (cart_type == CART_TYPE_FA2)
+			s->ram[255] = 0;	// the save command the snapshot was taken on
+	}
+	s->size = size;
+	s->free = free;
+	s->end = end;
+	s->last = last;
+	s->header[0] = SAVE_MAGIC;
+	s->header[1] = cart_crc;
+	s->header[2] = size;
+	s->header[SAVE_HEADER_WORDS] = SAVE_DONE;
+}
+
+// writes or copies the next word of the snapshot being saved or loaded, moving
+// on to its next part at the end of one
+RAMFUNC void cart_save_word() {
+	CART_SAVE *s = &cart_save;
+	*s->dst++ = s->src ? *s->src++ : 0;
+	if (--s->left)
+		return;
+	if (s->saving && ++s->part == 1) {	// the ram
+		s->src = (uint32_t *)s->ram;
+		s->left = s->size / 4;
+	}
+	else if (s->saving && s->part == 2) {	// the done mark, once the rest is in
+		s->src = &s->header[SAVE_HEADER_WORDS];
+		s->left = 1;
+	}
+	else {
+		if (s->saving) {
+			s->free = s->dst;
+			s->last = s->record;
+		}
+		if (s->status)
+			*s->status = 0;
+	}
+}
+
+// starts saving the cart ram to the flash, if there's room and nothing else is
+// under way. status, if given, is cleared when it's done
+RAMFUNC int cart_save_start(uint8_t *status) {
+	CART_SAVE *s = &cart_save;
+	if (s->left || !s->size || s->free + save_record_words(s->size) > s->end)
+		return 0;
+	FLASH->SR = SAVE_FLASH_ERRORS;
+	FLASH->CR = FLASH_PSIZE_WORD | FLASH_CR_PG;
+	s->record = s->dst = s->free;
+	s->src = s->header;
+	s->left = SAVE_HEADER_WORDS;
+	s->part = 0;
+	s->saving = 1;
+	s->status = status;
+	return 1;
+}
+
+// starts putting the rom's latest snapshot back in the cart ram, or clearing it
+// if there's none
+RAMFUNC int cart_save_load(uint8_t *status) {
+	CART_SAVE *s = &cart_save;
+	if (s->left || !s->size)
+		return 0;
+	s->dst = (uint32_t *)s->ram;
+	s->src = s->last ? s->last + SAVE_HEADER_WORDS : 0;
+	s->left = s->size / 4;
+	s->saving = 0;
+	s->status = status;
+	return 1;
+}
+
+// FA2's $1FF4 with a command in the last byte of ram, 1 to load and 2 to save
+RAMFUNC void cart_save_command(uint8_t *ram) {
+	uint8_t *status = &ram[255];
+	if (!(*status == 1 && cart_save_load(status)) && !(*status == 2 && cart_save_start(status)))
+		*status = 0;
+}
+
+// waits for the flash, answering the menu meanwhile
+RAMFUNC static void cart_save_wait() {
+	while (FLASH->SR & FLASH_SR_BSY)
+		serve_busy_bus();
+}
+
+// runs the snapshot or load under way to its end
+RAMFUNC static void cart_save_run() {
+	while (cart_save.left) {
+		cart_save_wait();
+		cart_save_word();
+	}
+	cart_save_wait();
+}
+
+// after a cart: finishes a snapshot or load the game left under way and, if the game
+// was left for the menu, takes a snapshot of its ram as it stopped. then erases the
+// sector that isn't active, if it needs it, and locks the flash again. interrupts
+// are kept off, as their vectors and handlers are in the flash, which can't be read
+// until it's done
+RAMFUNC void cart_save_finish(int left) {
+	CART_SAVE *s = &cart_save;
+	if (!s->size)
+		return;
+	__disable_irq();
+	cart_save_run();
+	if (left && cart_save_start(0))
+		cart_save_run();
+	if (s->erase >= 0) {
+		FLASH->SR = SAVE_FLASH_ERRORS;
+		FLASH->CR = FLASH_PSIZE_WORD | FLASH_CR_SER | save_flash_sectors[s->erase];
+		FLASH->CR |= FLASH_CR_STRT;
+		cart_save_wait();
+	}
+	FLASH->CR = FLASH_PSIZE_WORD;
+	__enable_irq();
+	FLASH_Lock();
+}
+
+// moves a snapshot on by a word if the flash is ready, for the kernels to call
+// once they have driven the bus
+#define cart_save_step() \
+	if (cart_save.left && !(FLASH->SR & FLASH_SR_BSY)) cart_save_word();
+
+/* Leaving a Game
+ * --------------
+ * The console's reset switch doesn't reset the 6507, the game reads it in SWCHB
+ * and starts itself over, so it never gets back to the menu. Instead, a kernel
+ * that sees reset held down for RESET_HOLD_MS sends the 6507 to the menu's reset
+ * vector, the cart ram is saved, and main() puts the menu back on the rom in its
+ * folder. The check is made on reads of SWCHB only, which don't drive the bus;
+ * other accesses pay for no more than the address test (cart_switches_read() in
+ * cartridge_firmware.h, which the supercharger kernel uses too). The hold adds up
+ * the cycles from each read that sees reset down to the next, so the cycle
+ * counter wrapping (every 25s) can only make it shorter than it was. The default
+ * is long enough that no game is played holding reset that long.
+ *
+ * The check runs as the access after the read starts, the fetch of the game's next
+ * opcode if it runs from the cart. By tools/kernel_cycles.py, on the 4K kernel as
+ * -Os builds it, that fetch is driven 76 cycles after its address (89 with reset
+ * down, 105 when the game is left) where a fetch after any other access is driven
+ * in 59, against a budget of 115.
+ */
+#ifndef RESET_HOLD_MS
+#define RESET_HOLD_MS	5000	// 0 never leaves
+#endif
+#if RESET_HOLD_MS > 25000
+#error RESET_HOLD_MS is counted in 32 bit DWT cycles, 25s at most
+#endif
+
+uint32_t reset_hold_cycles;	// RESET_HOLD_MS in DWT cycles, or never
+uint32_t reset_held;	// cycles reset has been down, across reads that saw it down
+uint32_t reset_last;	// when the game last read the switches
+
+RAMFUNC void emulate_2k_cartridge() {
 	setup_cartridge_image();
 
 	__disable_irq();	// Disable interrupts
-	uint16_t addr, addr_prev = 0;
+	uint16_t addr, addr_prev = 0, data = 0, data_prev = 0, switches = 0xFFFF;
 	while (1)
 	{
 		while ((addr = ADDR_IN) != addr_prev)
@@ -593,15 +3072,20 @@ void emulate_2k_cartridge() {
 			while (ADDR_IN == addr) ;
 			SET_DATA_MODE_IN
 		}
+		else if (IS_SWCHB(addr))
+		{	// the game reading the console switches
+			while (ADDR_IN == addr) { data_prev = data; data = DATA_IN; }
+			cart_switches_read();
+		}
 	}
 	__enable_irq();
 }
 
-void emulate_4k_cartridge() {
+RAMFUNC void emulate_4k_cartridge() {
 	setup_cartridge_image();
 
 	__disable_irq();	// Disable interrupts
-	uint16_t addr, addr_prev = 0;
+	uint16_t addr, addr_prev = 0, data = 0, data_prev = 0, switches = 0xFFFF;
 	while (1)
 	{
 		while ((addr = ADDR_IN) != addr_prev)
@@ -615,6 +3099,11 @@ void emulate_4k_cartridge() {
 			while (ADDR_IN == addr) ;
 			SET_DATA_MODE_IN
 		}
+		else if (IS_SWCHB(addr))
+		{	// the game reading the console switches
+			while (ADDR_IN == addr) { data_prev = data; data = DATA_IN; }
+			cart_switches_read();
+		}
 	}
 	__enable_irq();
 }
@@ -627,12 +3116,12 @@ void emulate_4k_cartridge() {
  * SC variants have 128 bytes of RAM:
  * RAM read port is $1080 - $10FF, write port is $1000 - $107F.
  */
-void emulate_FxSC_cartridge(uint16_t lowBS, uint16_t highBS, int isSC)
+RAMFUNC void emulate_FxSC_cartridge(uint16_t lowBS, uint16_t highBS, int isSC)
 {
 	setup_cartridge_image_with_ram();
 
 	__disable_irq();	// Disable interrupts
-	uint16_t addr, addr_prev = 0, data = 0, data_prev = 0;
+	uint16_t addr, addr_prev = 0, data = 0, data_prev = 0, switches = 0xFFFF;
 	unsigned char *bankPtr = &cart_rom[0];
 
 	while (1)
@@ -666,11 +3155,17 @@ void emulate_FxSC_cartridge(uint16_t lowBS, uint16_t highBS, int isSC)
 			{	// normal rom access
 				DATA_OUT = ((uint16_t)bankPtr[addr&0xFFF])<<8;
 				SET_DATA_MODE_OUT
+				cart_save_step();
 				// wait for address bus to change
 				while (ADDR_IN == addr) ;
 				SET_DATA_MODE_IN
 			}
 		}
+		else if (IS_SWCHB(addr))
+		{	// the game reading the console switches
+			while (ADDR_IN == addr) { data_prev = data; data = DATA_IN; }
+			cart_switches_read();
+		}
 	}
 	__enable_irq();
 }
@@ -681,12 +3176,12 @@ void emulate_FxSC_cartridge(uint16_t lowBS, uint16_t highBS, int isSC)
  * plus 256 bytes of RAM:
  * RAM read port is $1100 - $11FF, write port is $1000 - $10FF.
  */
-void emulate_FA_cartridge()
+RAMFUNC void emulate_FA_cartridge()
 {
 	setup_cartridge_image_with_ram();
 
 	__disable_irq();	// Disable interrupts
-	uint16_t addr, addr_prev = 0, data = 0, data_prev = 0;
+	uint16_t addr, addr_prev = 0, data = 0, data_prev = 0, switches = 0xFFFF;
 	unsigned char *bankPtr = &cart_rom[0];
 
 	while (1)
@@ -717,11 +3212,92 @@ void emulate_FA_cartridge()
 			{	// normal rom access
 				DATA_OUT = ((uint16_t)bankPtr[addr&0xFFF])<<8;
 				SET_DATA_MODE_OUT
+				cart_save_step();
+				// wait for address bus to change
+				while (ADDR_IN == addr) ;
+				SET_DATA_MODE_IN
+			}
+		}
+		else if (IS_SWCHB(addr))
+		{	// the game reading the console switches
+			while (ADDR_IN == addr) { data_prev = data; data = DATA_IN; }
+			cart_switches_read();
+		}
+	}
+	__enable_irq();
+}
+
+/* FA2 Bankswitching
+ * ------------------
+ * FA with 6 or 7 banks (24K or 28K), selected by $1FF5 - $1FFB, made for the
+ * Harmony cart. A 29K image starts with 1K of ARM code, which is skipped.
+ * The game can save the cart ram and load it back: it puts 2 (save) or 1 (load)
+ * in the last byte of ram and accesses $1FF4, then reads it until bit 6 is clear
+ * and the last byte of ram is 0 again. The ram goes to a snapshot in flash, like
+ * those taken when the game is left (see Cart RAM Snapshots).
+ */
+RAMFUNC void emulate_FA2_cartridge()
+{
+	setup_cartridge_image_with_ram();
+	if (cart_size_bytes == 29*1024)
+		cart_rom += 1024;
+
+	__disable_irq();	// Disable interrupts
+	uint16_t addr, addr_prev = 0, data = 0, data_prev = 0, switches = 0xFFFF;
+	unsigned char *bankPtr = &cart_rom[0];
+
+	while (1)
+	{
+		while ((addr = ADDR_IN) != addr_prev)
+			addr_prev = addr;
+		// got a stable address
+		if (addr & 0x1000)
+		{ // A12 high
+			if (addr >= 0x1FF5 && addr <= 0x1FFB)	// bank-switch
+				bankPtr = &cart_rom[(addr-0x1FF5)*4*1024];
+
+			if ((addr & 0x1F00) == 0x1100)
+			{	// a read from cartridge ram
+				DATA_OUT = ((uint16_t)cart_ram[addr&0xFF])<<8;
+				SET_DATA_MODE_OUT
+				// wait for address bus to change
+				while (ADDR_IN == addr) ;
+				SET_DATA_MODE_IN
+			}
+			else if ((addr & 0x1F00) == 0x1000)
+			{	// a write to cartridge ram
+				// read last data on the bus before the address lines change
+				while (ADDR_IN == addr) { data_prev = data; data = DATA_IN; }
+				cart_ram[addr&0xFF] = data_prev>>8;
+			}
+			else if (addr == 0x1FF4)
+			{	// saving or loading the ram, bit 6 is set until it is done
+				data = bankPtr[0xFF4] & ~0x40;
+				if (cart_save.left || cart_ram[255] == 1 || cart_ram[255] == 2)
+					data |= 0x40;
+				DATA_OUT = data<<8;
+				SET_DATA_MODE_OUT
+				if (!cart_save.left && cart_ram[255])
+					cart_save_command(cart_ram);
+				// wait for address bus to change
+				while (ADDR_IN == addr) ;
+				SET_DATA_MODE_IN
+			}
+			else
+			{	// normal rom access
+				DATA_OUT = ((uint16_t)bankPtr[addr&0xFFF])<<8;
+				SET_DATA_MODE_OUT
+				cart_save_step();
 				// wait for address bus to change
 				while (ADDR_IN == addr) ;
 				SET_DATA_MODE_IN
 			}
 		}
+		else if (IS_SWCHB(addr))
+		{	// the game reading the console switches
+			while (ADDR_IN == addr) { data_prev = data; data = DATA_IN; }
+			cart_switches_read();
+		}
 	}
 	__enable_irq();
 }
@@ -783,12 +3359,12 @@ void emulate_FA_cartridge()
   @author  Stephen Anthony; with ideas/research from Christian Speckner and
 		   alex_79 and TomSon (of AtariAge)
 */
-void emulate_FE_cartridge()
+RAMFUNC void emulate_FE_cartridge()
 {
 	setup_cartridge_image();
 
 	__disable_irq();	// Disable interrupts
-	uint16_t addr, addr_prev = 0, data = 0, data_prev = 0;
+	uint16_t addr, addr_prev = 0, data = 0, data_prev = 0, switches = 0xFFFF;
 	unsigned char *bankPtr = &cart_rom[0];
 	int lastAccessWasFE = 0;
 
@@ -800,6 +3376,10 @@ void emulate_FE_cartridge()
 		if (!(addr & 0x1000))
 		{	// A12 low, read last data on the bus before the address lines change
 			while (ADDR_IN == addr) { data_prev = data; data = DATA_IN; }
+			if (IS_SWCHB(addr)) {
+				// the game reading the console switches
+				cart_switches_read();
+			}
 			data = data_prev>>8;
 		}
 		else
@@ -846,14 +3426,14 @@ void emulate_FE_cartridge()
  * http://atariage.com/forums/topic/266245-tigervision-banking-and-low-memory-reads/
  * http://atariage.com/forums/topic/68544-3f-bankswitching/
  */
-void emulate_3F_cartridge()
+RAMFUNC void emulate_3F_cartridge()
 {
 	setup_cartridge_image();
 
 	__disable_irq();	// Disable interrupts
 	int cartPages = cart_size_bytes/2048;
 
-	uint16_t addr, addr_prev = 0, addr_prev2 = 0, data = 0, data_prev = 0;
+	uint16_t addr, addr_prev = 0, addr_prev2 = 0, data = 0, data_prev = 0, switches = 0xFFFF;
 	unsigned char *bankPtr = &cart_rom[0];
 	unsigned char *fixedPtr = &cart_rom[(cartPages-1)*2048];
 
@@ -873,6 +3453,10 @@ void emulate_3F_cartridge()
 				int newPage = (data_prev>>8) % cartPages;
 				bankPtr = &cart_rom[newPage*2048];
 			}
+			else if (IS_SWCHB(addr)) {
+				// the game reading the console switches
+				cart_switches_read();
+			}
 		}
 		else
 		{ // A12 high
@@ -945,7 +3529,7 @@ Writing to 3E, however, is what's new.  Writing here selects a 1K RAM bank into
 enough space for 256K of RAM.  When RAM is selected, 1000-13FF is the read port while
 1400-17FF is the write port.
 */
-void emulate_3E_cartridge()
+RAMFUNC void emulate_3E_cartridge()
 {
 	setup_cartridge_image_with_ram();
 
@@ -953,7 +3537,7 @@ void emulate_3E_cartridge()
 	int cartROMPages = cart_size_bytes/2048;
 	int cartRAMPages = 32;
 
-	uint16_t addr, addr_prev = 0, addr_prev2 = 0, data = 0, data_prev = 0;
+	uint16_t addr, addr_prev = 0, addr_prev2 = 0, data = 0, data_prev = 0, switches = 0xFFFF;
 	unsigned char *bankPtr = &cart_rom[0];
 	unsigned char *fixedPtr = &cart_rom[(cartROMPages-1)*2048];
 	int bankIsRAM = 0;
@@ -989,6 +3573,7 @@ void emulate_3E_cartridge()
 				}
 				DATA_OUT = data<<8;
 				SET_DATA_MODE_OUT
+				cart_save_step();
 				// wait for address bus to change
 				while (ADDR_IN == addr) ;
 				SET_DATA_MODE_IN
@@ -997,6 +3582,10 @@ void emulate_3E_cartridge()
 		else
 		{	// A12 low, read last data on the bus before the address lines change
 			while (ADDR_IN == addr) { data_prev = data; data = DATA_IN; }
+			if (IS_SWCHB(addr)) {
+				// the game reading the console switches
+				cart_switches_read();
+			}
 			data = data_prev>>8;
 			if (addr == 0x003F) {
 				bankIsRAM = 0;
@@ -1031,12 +3620,12 @@ into the following locations:
 
 Like F8, F6, etc. accessing one of the locations indicated will perform the switch.
 */
-void emulate_E0_cartridge()
+RAMFUNC void emulate_E0_cartridge()
 {
 	setup_cartridge_image();
 
 	__disable_irq();	// Disable interrupts
-	uint16_t addr, addr_prev = 0;
+	uint16_t addr, addr_prev = 0, data = 0, data_prev = 0, switches = 0xFFFF;
 	unsigned char curBanks[4] = {0,0,0,7};
 
 	while (1)
@@ -1064,6 +3653,11 @@ void emulate_E0_cartridge()
 			while (ADDR_IN == addr) ;
 			SET_DATA_MODE_IN
 		}
+		else if (IS_SWCHB(addr))
+		{	// the game reading the console switches
+			while (ADDR_IN == addr) { data_prev = data; data = DATA_IN; }
+			cart_switches_read();
+		}
 	}
 	__enable_irq();
 
@@ -1084,12 +3678,12 @@ void emulate_E0_cartridge()
  * If address AND $1840 == $0800, then we select bank 0
  * If address AND $1840 == $0840, then we select bank 1
  */
-void emulate_0840_cartridge()
+RAMFUNC void emulate_0840_cartridge()
 {
 	setup_cartridge_image();
 
 	__disable_irq();	// Disable interrupts
-	uint16_t addr, addr_prev = 0, addr_prev2 = 0;
+	uint16_t addr, addr_prev = 0, addr_prev2 = 0, data = 0, data_prev = 0, switches = 0xFFFF;
 	unsigned char *bankPtr = &cart_rom[0];
 
 	while (1)
@@ -1112,6 +3706,11 @@ void emulate_0840_cartridge()
 		{
 			if ((addr & 0x0840) == 0x0800) bankPtr = &cart_rom[0];
 			else if ((addr & 0x0840) == 0x0840) bankPtr = &cart_rom[4*1024];
+			else if (IS_SWCHB(addr)) {
+				// the game reading the console switches
+				while (ADDR_IN == addr) { data_prev = data; data = DATA_IN; }
+				cart_switches_read();
+			}
 			// wait for address bus to change
 			while (ADDR_IN == addr) ;
 		}
@@ -1126,12 +3725,12 @@ void emulate_0840_cartridge()
  *  $F400-$F7FF 1K RAM write
  *  $F800-$FFFF 2K ROM
  */
-void emulate_CV_cartridge()
+RAMFUNC void emulate_CV_cartridge()
 {
 	setup_cartridge_image_with_ram();
 
 	__disable_irq();	// Disable interrupts
-	uint16_t addr, addr_prev = 0, data = 0, data_prev = 0;
+	uint16_t addr, addr_prev = 0, data = 0, data_prev = 0, switches = 0xFFFF;
 
 	while (1)
 	{
@@ -1166,6 +3765,11 @@ void emulate_CV_cartridge()
 				}
 			}
 		}
+		else if (IS_SWCHB(addr))
+		{	// the game reading the console switches
+			while (ADDR_IN == addr) { data_prev = data; data = DATA_IN; }
+			cart_switches_read();
+		}
 	}
 	__enable_irq();
 }
@@ -1175,12 +3779,12 @@ void emulate_CV_cartridge()
  * 64K cartridge with 16 x 4K banks. An access to $1FF0 switches to the next
  * bank in sequence.
  */
-void emulate_F0_cartridge()
+RAMFUNC void emulate_F0_cartridge()
 {
 	setup_cartridge_image();
 
 	__disable_irq();	// Disable interrupts
-	uint16_t addr, addr_prev = 0;
+	uint16_t addr, addr_prev = 0, data = 0, data_prev = 0, switches = 0xFFFF;
 	int currentBank = 0;
 
 	while (1)
@@ -1199,6 +3803,11 @@ void emulate_F0_cartridge()
 			while (ADDR_IN == addr) ;
 			SET_DATA_MODE_IN
 		}
+		else if (IS_SWCHB(addr))
+		{	// the game reading the console switches
+			while (ADDR_IN == addr) { data_prev = data; data = DATA_IN; }
+			cart_switches_read();
+		}
 	}
 	__enable_irq();
 }
@@ -1231,12 +3840,12 @@ banks making a total of 1K accessable here.
 
 Accessing 1FE8 through 1FEB select which 256 byte bank shows up.
  */
-void emulate_E7_cartridge()
+RAMFUNC void emulate_E7_cartridge()
 {
 	setup_cartridge_image_with_ram();
 
 	__disable_irq();	// Disable interrupts
-	uint16_t addr, addr_prev = 0, data = 0, data_prev = 0;
+	uint16_t addr, addr_prev = 0, data = 0, data_prev = 0, switches = 0xFFFF;
 	unsigned char *bankPtr = &cart_rom[0];
 	unsigned char *fixedPtr = &cart_rom[(8-1)*2048];
 	unsigned char *ram1Ptr = &cart_ram[0];
@@ -1285,6 +3894,7 @@ void emulate_E7_cartridge()
 
 					DATA_OUT = ((uint16_t)fixedPtr[addr&0x7FF])<<8;
 					SET_DATA_MODE_OUT
+					cart_save_step();
 					// wait for address bus to change
 					while (ADDR_IN == addr) ;
 					SET_DATA_MODE_IN
@@ -1312,12 +3922,18 @@ void emulate_E7_cartridge()
 				{	// selected ROM bank access
 					DATA_OUT = ((uint16_t)bankPtr[addr&0x7FF])<<8;
 					SET_DATA_MODE_OUT
+					cart_save_step();
 					// wait for address bus to change
 					while (ADDR_IN == addr) ;
 					SET_DATA_MODE_IN
 				}
 			}
 		}
+		else if (IS_SWCHB(addr))
+		{	// the game reading the console switches
+			while (ADDR_IN == addr) { data_prev = data; data = DATA_IN; }
+			cart_switches_read();
+		}
 	}
 	__enable_irq();
 }
@@ -1332,7 +3948,7 @@ void emulate_E7_cartridge()
  * Note this is not a full implementation of DPC, but is enough to run Pitfall II and the music sounds ok.
  */
 
-void emulate_DPC_cartridge()
+RAMFUNC void emulate_DPC_cartridge()
 {
 	setup_cartridge_image();
 
@@ -1341,7 +3957,7 @@ void emulate_DPC_cartridge()
 
 	unsigned char soundAmplitudes[8] = {0x00, 0x04, 0x05, 0x09, 0x06, 0x0a, 0x0b, 0x0f};
 
-	uint16_t addr, addr_prev = 0, data = 0, data_prev = 0;
+	uint16_t addr, addr_prev = 0, data = 0, data_prev = 0, switches = 0xFFFF;
 	unsigned char *bankPtr = &cart_rom[0], *DpcDisplayPtr = &cart_rom[8*1024];
 
 	unsigned char DpcRandom, DpcTops[8], DpcBottoms[8], DpcFlags[8];
@@ -1493,6 +4109,12 @@ void emulate_DPC_cartridge()
 				SET_DATA_MODE_IN
 			}
 		}
+		else if (IS_SWCHB(addr))
+		{	// the game reading the console switches, the DPC clock catches up on the
+			// next non cartridge access
+			while (ADDR_IN == addr) { data_prev = data; data = DATA_IN; }
+			cart_switches_read();
+		}
 		else
 		{	// non cartridge access - e.g. sta wsync
 			while (ADDR_IN == addr) {
@@ -1520,6 +4142,9 @@ void emulate_DPC_cartridge()
 
 void emulate_cartridge(int cart_type)
 {
+	cart_save_prepare(cart_type);
+	reset_hold_cycles = RESET_HOLD_MS ? RESET_HOLD_MS * (SystemCoreClock / 1000) : 0xFFFFFFFF;
+
 	if (cart_type == CART_TYPE_2K)
 		emulate_2k_cartridge();
 	else if (cart_type == CART_TYPE_4K)
@@ -1556,6 +4181,8 @@ void emulate_cartridge(int cart_type)
 		emulate_F0_cartridge();
 	else if (cart_type == CART_TYPE_FA)
 		emulate_FA_cartridge();
+	else if (cart_type == CART_TYPE_FA2)
+		emulate_FA2_cartridge();
 	else if (cart_type == CART_TYPE_E7)
 		emulate_E7_cartridge();
 	else if (cart_type == CART_TYPE_DPC)
@@ -1563,6 +4190,9 @@ void emulate_cartridge(int cart_type)
 	else if (cart_type == CART_TYPE_AR) {
 		emulate_supercharger_cartridge(cartridge_image_path, cart_size_bytes, buffer, tv_mode);
 	}
+
+	// boot_command is only set when the game was left for the menu
+	cart_save_finish(boot_command != 0);
 }
 
 void convertFilenameForCart(unsigned char *dst, char *src)
@@ -1575,92 +4205,234 @@ void convertFilenameForCart(unsigned char *dst, char *src)
 	}
 }
 
-int readDirectoryForAtari(char *path)
+// the menu shows one window of MENU_WINDOW_ITEMS entries at a time, and asks
+// for the next or previous window with CART_CMD_WINDOW_n when it scrolls past
+int menu_window = 0;
+
+void updateMenuItems()
 {
-	int ret = read_directory(path);
 	uint8_t *menu_ram = get_menu_ram();
+	int first = menu_window * MENU_WINDOW_ITEMS;
+	int flags = dir_scan.active ? STATUS_DIR_GROWING : 0;
 	// create a table of entries for the atari to read
 	memset(menu_ram, 0, 1024);
-	for (int i=0; i<num_dir_entries; i++)
+	int i;
+	for (i=0; first+i<num_dir_entries && i<MENU_WINDOW_ITEMS; i++)
 	{
 		unsigned char *dst = menu_ram + i*12;
-		convertFilenameForCart(dst, dir_entries[i].long_filename);
+		DIR_ENTRY e = dir_entries[first+i];
+		convertFilenameForCart(dst, dir_entry_long_filename(e));
 		// set the high-bit of the first character if directory
-		if (dir_entries[i].isDir) *dst += 0x80;
+		if (dir_entry_is_dir(e)) *dst += 0x80;
 	}
+	if (first+i < num_dir_entries)
+		flags |= STATUS_MORE_WINDOWS;
+	render_menu_items();
+	set_menu_item_count(i);
+	set_menu_status_flags(flags);
+}
+
+// shows a listing from its start, or with the menu on a given item
+void showDirectoryForAtari(int item)
+{
+	menu_window = item / MENU_WINDOW_ITEMS;
+	updateMenuItems();
+	set_menu_jump(menu_window, item % MENU_WINDOW_ITEMS);
+}
+
+int readDirectoryForAtari(char *path)
+{
+	int ret = strcmp(path, CATALOG_PATH) ? read_directory(path) : read_catalog();
+	showDirectoryForAtari(0);
 	return ret;
 }
+
+// the item with a short filename in the listing, which is read to the end first
+// as its order can change until then, or 0 if it isn't there
+int findDirectoryItem(char *name)
+{
+	while (dir_scan.active)
+		continue_directory();
+	for (int i = 0; i < num_dir_entries; i++)
+		if (!strcmp(dir_entry_filename(dir_entries[i]), name))
+			return i;
+	return 0;
+}
+
+// goes into a subfolder of the current one, which is pushed on the folder stack
+int readSubdirectoryForAtari(char *path, char *name, int sel)
+{
+	dir_stack_push(&dir_scan.header, sel, dir_letters_valid);
+	int child = dir_stack_child_name[0] && !strcmp(name, dir_stack_child_name);
+	dir_stack_child_name[0] = 0;
+	if (child && read_directory_index(&dir_stack_child)) {
+		showDirectoryForAtari(0);
+		return 1;
+	}
+	return readDirectoryForAtari(path);
+}
+
+// goes back to the parent folder, from the folder stack if it can
+int readParentDirectoryForAtari(char *path, char *name)
+{
+	DIR_STACK_LEVEL level;
+	dir_stack_child = dir_scan.header;
+	strncpy(dir_stack_child_name, name, sizeof(dir_stack_child_name) - 1);
+	int ret = dir_stack_pop(&level);
+	if (ret == 1) {
+		dir_scan.header = level.header;
+		index_directory_letters();
+	}
+	else if (ret == 0)
+		ret = read_directory_index(&level.header);
+	if (ret != 1)
+		return readDirectoryForAtari(path);
+	showDirectoryForAtari(level.item);
+	return 1;
+}
 int main(void)
 {
 	char curPath[256] = "";
 	int cart_type = CART_TYPE_NONE;
 
+	// the GPIOs and the clock were set up by boot_firmware_cartridge()
 	init();
-	/* In/Out: PE{8..15} */
-	config_gpio_data();
-	/* In: PD{0..15} */
-	config_gpio_addr();
-	/* In: Other Cart Input Signals - PC{0..1} */
-	config_gpio_sig();
-
-	if (!(GPIOC->IDR & 0x0001))
-		tv_mode = TV_MODE_PAL60;
-	else if (!(GPIOC->IDR & 0x0002))
-		tv_mode = TV_MODE_PAL;
-	else
-		tv_mode = TV_MODE_NTSC;
-
+	tv_mode = read_tv_mode();
 	set_tv_mode(tv_mode);
 
-	// set up status area
-	set_menu_status_msg("BY R.EDWARDS");
+	// set up status area, with the last launch's time if a reset has left it behind
+	char last_launch[16];
+	if (profile_last_summary(last_launch))
+		set_menu_status_msg(last_launch);
+	else
+		set_menu_status_msg("BY R.EDWARDS");
 	set_menu_status_byte(0);
 
 
 
 	while (1) {
-		int ret = emulate_firmware_cartridge();
+		// the boot kernel has already taken the menu's first command
+		int ret = boot_command ? boot_command : emulate_firmware_cartridge();
+		boot_command = 0;
+		set_menu_progress(0, 0);
 
 		if (ret == CART_CMD_ROOT_DIR)
 		{
 			curPath[0] = 0;
+			dir_stack_clear();
 			if (!readDirectoryForAtari(curPath))
 				set_menu_status_msg("CANT READ SD");
 		}
+		else if (ret == CART_CMD_DIR_MORE)
+		{
+			continue_directory();
+			updateMenuItems();
+		}
+		else if (ret == CART_CMD_BENCHMARK)
+		{
+			char msg[32];
+			end_directory(DIR_SCAN_MORE);
+			benchmark(msg);
+			set_menu_status_msg(msg);
+			updateMenuItems();
+			set_menu_jump(menu_window, 0);
+		}
+		else if ((ret & 0x1F00) == CART_CMD_WINDOW_n)
+		{
+			menu_window = ret & 0xFF;
+			updateMenuItems();
+		}
+		else if ((ret & 0x1FC0) == CART_CMD_NEXT_LETTER_n || (ret & 0x1FC0) == CART_CMD_PREV_LETTER_n)
+		{
+			int item = menu_window * MENU_WINDOW_ITEMS + (ret & 0x3F);
+			item = jump_to_letter(item, (ret & 0x1FC0) == CART_CMD_NEXT_LETTER_n);
+			menu_window = item / MENU_WINDOW_ITEMS;
+			updateMenuItems();
+			set_menu_jump(menu_window, item % MENU_WINDOW_ITEMS);
+		}
 		else
 		{
-			int sel = ret - CART_CMD_SEL_ITEM_n;
-			DIR_ENTRY *d = &dir_entries[sel];
-
-			if (d->isDir)
+			// a selection ends any scan in progress, leaving the listing as shown
+			end_directory(DIR_SCAN_MORE);
+			int sel = menu_window * MENU_WINDOW_ITEMS + ret - CART_CMD_SEL_ITEM_n;
+			if (sel >= num_dir_entries)
+				continue;
+			DIR_ENTRY d = dir_entries[sel];
+			if (d & DIR_ENTRY_IS_NOTE)
+				continue;
+
+			if (dir_entry_is_dir(d))
 			{	// selection is a directory
-				if (!strcmp(d->filename, ".."))
+				int ok;
+				if (!strcmp(dir_entry_filename(d), ".."))
 				{	// go back
 					int len = strlen(curPath);
 					while (len && curPath[--len] != '/');
 					curPath[len] = 0;
+					ok = readParentDirectoryForAtari(curPath, curPath + len + 1);
+				}
+				else if (!strcmp(curPath, CATALOG_PATH))
+				{	// "(REBUILD LIST)"
+					catalog_rebuild = 1;
+					ok = readDirectoryForAtari(curPath);
 				}
 				else
 				{	// go into director
+					char *name = dir_entry_filename(d);
 					strcat(curPath, "/");
-					strcat(curPath, d->filename);
+					strcat(curPath, name);
+					ok = readSubdirectoryForAtari(curPath, name, sel);
 				}
 
-				if (!readDirectoryForAtari(curPath))
+				if (!ok)
 					set_menu_status_msg("CANT READ SD");
+				profile_begin(PHASE_PAUSE);
 				Delayms(200);
+				profile_end(PHASE_PAUSE);
 			}
 			else
 			{	// selection is a rom file
-				strcpy(cartridge_image_path, curPath);
-				strcat(cartridge_image_path, "/");
-				strcat(cartridge_image_path, d->filename);
-				cart_type = identify_cartridge(cartridge_image_path);
-				Delayms(200);
+				char name[13];
+				strncpy(name, dir_entry_filename(d), sizeof(name) - 1);
+				name[sizeof(name) - 1] = 0;
+				profile_launch();
+				dir_stack_discard();	// the rom takes the whole buffer
+				if (!strcmp(curPath, CATALOG_PATH))
+				{	// the catalog already knows where it is and its type
+					cart_type = catalog_lookup(d, cartridge_image_path);
+					if (cart_type != CART_TYPE_NONE)
+						cart_type = identify_cartridge(cartridge_image_path, cart_type);
+				}
+				else
+				{
+					strcpy(cartridge_image_path, curPath);
+					strcat(cartridge_image_path, "/");
+					strcat(cartridge_image_path, dir_entry_filename(d));
+					cart_type = identify_cartridge(cartridge_image_path, CART_TYPE_NONE);
+				}
+				// the launch profile is saved in the pause before the cart starts
+				profile_begin(PHASE_PAUSE);
+				uint32_t pause_start = DWT->CYCCNT;
+				launch_save(cart_type != CART_TYPE_NONE ? cartridge_image_path : 0);
+				uint32_t pause_ms = (DWT->CYCCNT - pause_start) / (SystemCoreClock / 1000);
+				if (pause_ms < 200)
+					Delayms(200 - pause_ms);
+				profile_end(PHASE_PAUSE);
 				if (cart_type != CART_TYPE_NONE)
 					emulate_cartridge(cart_type);
 				else
 					set_menu_status_msg("BAD ROM FILE");
+				// loading the rom has overwritten the directory listing in the buffer
+				if (!readDirectoryForAtari(curPath))
+					set_menu_status_msg("CANT READ SD");
+				else if (boot_command == CART_CMD_ROOT_DIR)
+				{	// the game was left with reset, the menu starts over on the rom
+					char last_launch[16];
+					boot_command = 0;
+					if (profile_last_summary(last_launch))
+						set_menu_status_msg(last_launch);
+					showDirectoryForAtari(findDirectoryItem(name));
+				}
 			}
 		}
 	}
@@ -0,0 +1,60 @@
+// Menu font and ASCII lookup, moved out of the menu ROM so the firmware can render
+// each line into sprite bytes (see render_menu_line() in cartridge_firmware.c).
+
+// maps characters to the glyph number, or to '_' (41) if we don't have one
+unsigned const char menu_font_lookup[128] = {
+  41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41,
+  41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41,
+  26, 41, 41, 41, 41, 41, 41, 41, 40, 39, 41, 41, 37, 41, 38, 41,
+  27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 41, 41, 41, 41, 41, 41,
+  41, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14,
+  15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 41, 41, 41, 41, 41,
+  41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41,
+  41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41
+};
+
+// 8x8 glyphs, bottom row first as the kernel counts down
+unsigned const char menu_font[] = {
+  0x00, 0xc6, 0xc6, 0xfe, 0xc6, 0xc6, 0x6c, 0x38,	// 'A'
+  0x00, 0xfc, 0xc6, 0xc6, 0xfc, 0xc6, 0xc6, 0xfc,	// 'B'
+  0x00, 0x3c, 0x66, 0xc0, 0xc0, 0xc0, 0x66, 0x3c,	// 'C'
+  0x00, 0xf8, 0xcc, 0xc6, 0xc6, 0xc6, 0xcc, 0xf8,	// 'D'
+  0x00, 0xfe, 0xc0, 0xc0, 0xf8, 0xc0, 0xc0, 0xfe,	// 'E'
+  0x00, 0xc0, 0xc0, 0xc0, 0xfc, 0xc0, 0xc0, 0xfe,	// 'F'
+  0x00, 0x3e, 0x66, 0xc6, 0xce, 0xc0, 0x60, 0x3e,	// 'G'
+  0x00, 0xc6, 0xc6, 0xc6, 0xfe, 0xc6, 0xc6, 0xc6,	// 'H'
+  0x00, 0x78, 0x30, 0x30, 0x30, 0x30, 0x30, 0x78,	// 'I'
+  0x00, 0x7c, 0xc6, 0x06, 0x06, 0x06, 0x06, 0x06,	// 'J'
+  0x00, 0xce, 0xdc, 0xf8, 0xf0, 0xd8, 0xcc, 0xc6,	// 'K'
+  0x00, 0xfe, 0xc0, 0xc0, 0xc0, 0xc0, 0xc0, 0xc0,	// 'L'
+  0x00, 0xc6, 0xc6, 0xd6, 0xfe, 0xfe, 0xee, 0xc6,	// 'M'
+  0x00, 0xc6, 0xce, 0xde, 0xfe, 0xf6, 0xe6, 0xc6,	// 'N'
+  0x00, 0x7c, 0xc6, 0xc6, 0xc6, 0xc6, 0xc6, 0x7c,	// 'O'
+  0x00, 0xc0, 0xc0, 0xfc, 0xc6, 0xc6, 0xc6, 0xfc,	// 'P'
+  0x00, 0x76, 0xcc, 0xda, 0xc6, 0xc6, 0xc6, 0x7c,	// 'Q'
+  0x00, 0xce, 0xdc, 0xf8, 0xce, 0xc6, 0xc6, 0xfc,	// 'R'
+  0x00, 0x7c, 0xc6, 0x06, 0x7c, 0xc0, 0xcc, 0x78,	// 'S'
+  0x00, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0xfc,	// 'T'
+  0x00, 0x7c, 0xc6, 0xc6, 0xc6, 0xc6, 0xc6, 0xc6,	// 'U'
+  0x00, 0x10, 0x38, 0x7c, 0xee, 0xc6, 0xc6, 0xc6,	// 'V'
+  0x00, 0xc6, 0xee, 0xfe, 0xfe, 0xd6, 0xc6, 0xc6,	// 'W'
+  0x00, 0xc6, 0xee, 0x7c, 0x38, 0x7c, 0xee, 0xc6,	// 'X'
+  0x00, 0x30, 0x30, 0x30, 0x78, 0xcc, 0xcc, 0xcc,	// 'Y'
+  0x00, 0xfe, 0xe0, 0x70, 0x38, 0x1c, 0x0e, 0xfe,	// 'Z'
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,	// ' '
+  0x00, 0x7c, 0xc6, 0xe6, 0xd6, 0xce, 0xc6, 0x7c,	// '0'
+  0x00, 0xfc, 0x30, 0x30, 0x30, 0x30, 0x70, 0x30,	// '1'
+  0x00, 0xfe, 0xe0, 0x78, 0x3c, 0x0e, 0xc6, 0x7c,	// '2'
+  0x00, 0x7c, 0xc6, 0x06, 0x3c, 0x18, 0x0c, 0x7e,	// '3'
+  0x00, 0x0c, 0x0c, 0xfe, 0xcc, 0x6c, 0x3c, 0x1c,	// '4'
+  0x00, 0x7c, 0xc6, 0x06, 0x06, 0xfc, 0xc0, 0xfc,	// '5'
+  0x00, 0x7c, 0xc6, 0xc6, 0xfc, 0xc0, 0x60, 0x3c,	// '6'
+  0x00, 0x30, 0x30, 0x30, 0x18, 0x0c, 0xc6, 0xfe,	// '7'
+  0x00, 0x7c, 0xc6, 0xc6, 0x7c, 0xc6, 0xc6, 0x7c,	// '8'
+  0x00, 0x78, 0x0c, 0x06, 0x7e, 0xc6, 0xc6, 0x7c,	// '9'
+  0x00, 0x60, 0x30, 0x30, 0x00, 0x00, 0x00, 0x00,	// ','
+  0x00, 0x60, 0x60, 0x00, 0x00, 0x00, 0x00, 0x00,	// '.'
+  0x00, 0x60, 0x30, 0x18, 0x18, 0x18, 0x30, 0x60,	// ')'
+  0x00, 0x18, 0x30, 0x60, 0x60, 0x60, 0x30, 0x18,	// '('
+  0x00, 0xfe, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00	// '_'
+};
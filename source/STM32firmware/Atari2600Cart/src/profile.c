@@ -0,0 +1,86 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "stm32f4xx.h"
+#include "profile.h"
+
+/* Phase Profiler
+ * --------------
+ * Each named phase adds up the DWT cycles between profile_begin() and
+ * profile_end() from boot on. A launch is timed from the
+ * selection (profile_launch) to the end of the handshake (profile_launched),
+ * when the whole breakdown is copied to .noinit. The menu shows it in its
+ * status line when the game is left for it, or after a reset that keeps the
+ * power on, with the time the rom's patches took if it had any.
+ */
+#define PROFILE_MAGIC	0x46504355	// "UCPF"
+
+static PROFILE profile;
+static PROFILE profile_last __attribute__((section(".noinit")));
+
+const char *profile_phase_names[PHASES] = { "mount", "dir", "sort", "read", "detect", "patch", "pause", "handshake" };
+
+void profile_begin(int phase) {
+	profile.start[phase] = DWT->CYCCNT;
+}
+
+void profile_end(int phase) {
+	profile.cycles[phase] += DWT->CYCCNT - profile.start[phase];
+}
+
+uint32_t profile_us(int phase) {
+	return profile.cycles[phase] / (SystemCoreClock / 1000000);
+}
+
+void profile_launch() {
+	memcpy(profile.base, profile.cycles, sizeof(profile.base));
+	profile.launch_start = DWT->CYCCNT;
+	profile.patches = 0;
+}
+
+uint32_t profile_launch_us() {
+	return (DWT->CYCCNT - profile.launch_start) / (SystemCoreClock / 1000000);
+}
+
+void profile_launched() {
+	profile.launch_cycles = DWT->CYCCNT - profile.launch_start;
+	profile.magic = PROFILE_MAGIC;
+	profile_last = profile;
+}
+
+void profile_patches(int applied) {
+	profile.patches += applied;
+}
+
+// the total time of the launch before this reset and the phase that took longest,
+// e.g. "842MS READ", or 0 if there wasn't one. A patched rom adds the patch time,
+// dropping the units and then the phase as the 12 characters need: "84MS READ P3",
+// "842 READ P3", "12345MS P3". All are in ms.
+int profile_last_summary(char *msg) {
+	static const char *patched[] = { "%uMS %s P%u", "%u %s P%u", "%uMS%.0s P%u", "%u%.0s P%u" };
+	if (profile_last.magic != PROFILE_MAGIC)
+		return 0;
+	profile_last.magic = 0;
+	int top = 0;
+	for (int i = 1; i < PHASES; i++)
+		if (profile_last.cycles[i] - profile_last.base[i] > profile_last.cycles[top] - profile_last.base[top])
+			top = i;
+	unsigned int ms = profile_last.launch_cycles / (SystemCoreClock / 1000);
+	char name[5];
+	int len;
+	for (len = 0; len < 4 && profile_phase_names[top][len]; len++)
+		name[len] = profile_phase_names[top][len] - 'a' + 'A';
+	name[len] = 0;
+	if (!profile_last.patches) {
+		sprintf(msg, "%uMS %s", ms, name);
+		return 1;
+	}
+	unsigned int patch_ms = (profile_last.cycles[PHASE_PATCH] - profile_last.base[PHASE_PATCH]) / (SystemCoreClock / 1000);
+	char line[40];
+	for (int i = 0; i < sizeof(patched) / sizeof(patched[0]); i++)
+		if ((len = sprintf(line, patched[i], ms, name, patch_ms)) <= 12)
+			break;
+	line[12] = 0;
+	strcpy(msg, line);
+	return 1;
+}
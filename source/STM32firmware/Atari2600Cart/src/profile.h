@@ -0,0 +1,37 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+
+#define PHASE_MOUNT		0	// f_mount
+#define PHASE_DIR		1	// reading a folder, from its entries or its index
+#define PHASE_SORT		2
+#define PHASE_READ		3	// loading a rom, and counting its signatures as it arrives
+#define PHASE_DETECT	4	// the cart database and the heuristics
+#define PHASE_PATCH		5	// applying the rom's patches, from /PATCHES and /PATCHES.TXT
+#define PHASE_PAUSE		6	// the Delayms(200) pauses in main(), before a cart starts or after a folder
+#define PHASE_HANDSHAKE	7	// reboot_into_cartridge()
+#define PHASES			8
+
+typedef struct {
+	uint32_t magic;	// set once a cart has started
+	uint32_t cycles[PHASES];	// since boot
+	uint32_t start[PHASES];
+	uint32_t base[PHASES];	// cycles when the rom was selected
+	uint32_t launch_start;
+	uint32_t launch_cycles;	// from the selection to the cart starting
+	uint32_t patches;	// applied to the rom of the launch
+} PROFILE;
+
+extern const char *profile_phase_names[PHASES];
+
+void profile_begin(int phase);
+void profile_end(int phase);
+uint32_t profile_us(int phase);
+void profile_launch();
+uint32_t profile_launch_us();
+void profile_launched();
+void profile_patches(int applied);
+int profile_last_summary(char *msg);
+
+#endif // PROFILE_H
@@ -51,6 +51,13 @@ defined in linker script */
 .word  _sdata
 /* end address for the .data section. defined in linker script */
 .word  _edata
+/* start address for the initialization values of the .ramfunc section.
+defined in linker script */
+.word  _siramfunc
+/* start address for the .ramfunc section. defined in linker script */
+.word  _sramfunc
+/* end address for the .ramfunc section. defined in linker script */
+.word  _eramfunc
 /* start address for the .bss section. defined in linker script */
 .word  _sbss
 /* end address for the .bss section. defined in linker script */
@@ -72,36 +79,10 @@ defined in linker script */
 Reset_Handler:  
   ldr   sp, =_estack    /* Atollic update: set stack pointer */
 
-/* Copy the data segment initializers from flash to SRAM */  
-  movs  r1, #0
-  b  LoopCopyDataInit
-
-CopyDataInit:
-  ldr  r3, =_sidata
-  ldr  r3, [r3, r1]
-  str  r3, [r0, r1]
-  adds  r1, r1, #4
-    
-LoopCopyDataInit:
-  ldr  r0, =_sdata
-  ldr  r3, =_edata
-  adds  r2, r0, r1
-  cmp  r2, r3
-  bcc  CopyDataInit
-  ldr  r2, =_sbss
-  b  LoopFillZerobss
-/* Zero fill the bss segment. */  
-FillZerobss:
-  movs  r3, #0
-  str  r3, [r2], #4
-    
-LoopFillZerobss:
-  ldr  r3, = _ebss
-  cmp  r2, r3
-  bcc  FillZerobss
-
-/* Call the clock system intitialization function.*/
-  bl  SystemInit   
+/* Serve the menu rom from reset. This also starts the clock and, once it is
+   running, copies the data segment initializers and the bus kernels from flash
+   to SRAM and zero fills the bss segment. */
+  bl  boot_firmware_cartridge
 /* Call static constructors */
     bl __libc_init_array
 /* Call the application's entry point.*/
@@ -192,6 +192,7 @@
   */
 
 static void SetSysClock(void);
+static void SwitchSysClock(void);
 #ifdef DATA_IN_ExtSRAM
   static void SystemInit_ExtMemCtl(void); 
 #endif /* DATA_IN_ExtSRAM */
@@ -212,6 +213,19 @@ static void SetSysClock(void);
   * @retval None
   */
 void SystemInit(void)
+{
+  SystemInitStart();
+  SystemInitFinish();
+}
+
+/**
+  * @brief  First half of SystemInit: resets the clock configuration and starts the
+  *         PLL, but returns without waiting for it to lock so that the caller can
+  *         get on with other work at the HSI frequency.
+  * @param  None
+  * @retval None
+  */
+void SystemInitStart(void)
 {
   /* FPU settings ------------------------------------------------------------*/
   #if (__FPU_PRESENT == 1) && (__FPU_USED == 1)
@@ -252,6 +266,17 @@ void SystemInit(void)
 #endif
 }
 
+/**
+  * @brief  Second half of SystemInit: waits for the PLL to lock, if it hasn't already,
+  *         and switches the system clock over to it.
+  * @param  None
+  * @retval None
+  */
+void SystemInitFinish(void)
+{
+  SwitchSysClock();
+}
+
 /**
    * @brief  Update SystemCoreClock variable according to Clock Register Values.
   *         The SystemCoreClock variable contains the core clock (HCLK), it can
@@ -371,7 +396,15 @@ static void SetSysClock(void)
 
   /* Enable the main PLL */
   RCC->CR |= RCC_CR_PLLON;
+}
 
+/**
+  * @brief  Switches the System clock source to the PLL started by SetSysClock()
+  * @param  None
+  * @retval None
+  */
+static void SwitchSysClock(void)
+{
   /* Wait till the main PLL is ready */
   while((RCC->CR & RCC_CR_PLLRDY) == 0)
   {
@@ -0,0 +1,421 @@
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+
+#include "unpack.h"
+
+/* Compressed Roms
+ * ---------------
+ * A rom kept in a .zip, .gz or .lz4 file is unpacked straight into the output
+ * as the file is read, so only the compressed bytes cross the SPI link. Every
+ * format here refers back into what has already been unpacked, and the whole
+ * rom sits in the output, so it serves as the history window and nothing is
+ * copied aside. The archive is read through UNPACK_IN_SIZE bytes of SRAM (the
+ * SD driver's DMA can't reach CCM), while the decoder state and the deflate
+ * code tables live in CCM.
+ */
+#define UNPACK_IN_SIZE	1024
+
+typedef struct {
+	uint16_t counts[16];	// codes of each length
+	uint16_t symbols[288];	// ordered by code
+} HUFFMAN;
+
+typedef struct {
+	UNPACK *u;
+	unsigned int in_pos, in_len;
+	int error;
+	uint32_t bits;	// deflate's bit buffer, always under a byte between codes
+	int num_bits;
+	HUFFMAN lit, dist;
+} UNPACK_STATE;
+
+static unsigned char unpack_in[UNPACK_IN_SIZE];
+static UNPACK_STATE unpack_state __attribute__((section(".ccmram")));
+
+// by format, less one
+const char *unpack_extensions[] = { "ZIP", "GZ", "LZ4", 0 };
+
+int unpack_format(char *filename) {
+	char *dot = strrchr(filename, '.');
+	if (!dot) return UNPACK_NONE;
+	for (int i = 0; unpack_extensions[i]; i++)
+		if (strcasecmp(dot + 1, unpack_extensions[i]) == 0)
+			return i + 1;
+	return UNPACK_NONE;
+}
+
+static int refill(UNPACK_STATE *s) {
+	if (s->error) return 0;
+	s->in_pos = 0;
+	s->in_len = s->u->read(unpack_in, UNPACK_IN_SIZE);
+	if (s->in_len == 0) s->error = 1;
+	return s->in_len;
+}
+
+// the next byte of the archive, 0 past its end (with error set)
+static inline int next_byte(UNPACK_STATE *s) {
+	if (s->in_pos == s->in_len && !refill(s))
+		return 0;
+	return unpack_in[s->in_pos++];
+}
+
+// copies (or skips, without dst) the next len bytes of the archive
+static void read_bytes(UNPACK_STATE *s, unsigned char *dst, unsigned int len) {
+	while (len) {
+		if (s->in_pos == s->in_len && !refill(s))
+			return;
+		unsigned int n = s->in_len - s->in_pos;
+		if (n > len) n = len;
+		if (dst) {
+			memcpy(dst, unpack_in + s->in_pos, n);
+			dst += n;
+		}
+		s->in_pos += n;
+		len -= n;
+	}
+}
+
+static uint32_t read_le(UNPACK_STATE *s, int bytes) {
+	uint32_t v = 0;
+	for (int i = 0; i < bytes; i++)
+		v |= (uint32_t)next_byte(s) << (i * 8);
+	return v;
+}
+
+// unpacked bytes go to the output, as long as it has room
+static int out_literals(UNPACK_STATE *s, unsigned int len) {
+	UNPACK *u = s->u;
+	if (len > u->out_size - u->out_pos) {
+		s->error = 1;
+		return 0;
+	}
+	read_bytes(s, u->out + u->out_pos, len);
+	u->out_pos += len;
+	return !s->error;
+}
+
+static int out_match(UNPACK_STATE *s, unsigned int dist, unsigned int len) {
+	UNPACK *u = s->u;
+	unsigned int pos = u->out_pos;
+	if (dist == 0 || dist > pos || len > u->out_size - pos) {
+		s->error = 1;
+		return 0;
+	}
+	unsigned char *dst = u->out + pos, *src = dst - dist;
+	while (len--)
+		*dst++ = *src++;	// may overlap, byte by byte
+	u->out_pos = dst - u->out;
+	return 1;
+}
+
+/* Deflate (RFC 1951), decoded a bit at a time from canonical code counts as
+ * in zlib's puff, which keeps the tables small.
+ */
+static const uint16_t length_base[29] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const uint8_t length_extra[29] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const uint16_t dist_base[30] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static const uint8_t dist_extra[30] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+static const uint8_t code_length_order[19] = {
+	16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+static inline uint32_t get_bits(UNPACK_STATE *s, int n) {
+	uint32_t bits = s->bits;
+	while (s->num_bits < n) {
+		bits |= (uint32_t)next_byte(s) << s->num_bits;
+		s->num_bits += 8;
+	}
+	s->bits = bits >> n;
+	s->num_bits -= n;
+	return bits & ((1u << n) - 1);
+}
+
+static int decode(UNPACK_STATE *s, HUFFMAN *h) {
+	int code = 0, first = 0, index = 0;
+	uint32_t bits = s->bits;
+	int num_bits = s->num_bits;
+	for (int len = 1; len < 16; len++) {
+		if (num_bits == 0) {
+			bits = next_byte(s);
+			num_bits = 8;
+		}
+		code |= bits & 1;
+		bits >>= 1;
+		num_bits--;
+		int count = h->counts[len];
+		if (code - first < count) {
+			s->bits = bits;
+			s->num_bits = num_bits;
+			return h->symbols[index + code - first];
+		}
+		index += count;
+		first = (first + count) << 1;
+		code <<= 1;
+	}
+	s->error = 1;
+	return 0;
+}
+
+static int build(HUFFMAN *h, const uint8_t *lengths, int n) {
+	uint16_t offsets[16];
+	memset(h->counts, 0, sizeof(h->counts));
+	for (int i = 0; i < n; i++)
+		h->counts[lengths[i]]++;
+	h->counts[0] = 0;
+	int left = 1;
+	for (int len = 1; len < 16; len++) {
+		left = (left << 1) - h->counts[len];
+		if (left < 0) return 0;	// over-subscribed
+	}
+	offsets[1] = 0;
+	for (int len = 1; len < 15; len++)
+		offsets[len + 1] = offsets[len] + h->counts[len];
+	for (int i = 0; i < n; i++)
+		if (lengths[i])
+			h->symbols[offsets[lengths[i]]++] = i;
+	return 1;
+}
+
+static int inflate_codes(UNPACK_STATE *s) {
+	while (!s->error) {
+		int sym = decode(s, &s->lit);
+		if (sym < 256) {
+			UNPACK *u = s->u;
+			if (u->out_pos == u->out_size) return 0;
+			u->out[u->out_pos++] = sym;
+		}
+		else if (sym == 256)
+			return 1;
+		else {
+			sym -= 257;
+			if (sym >= 29) return 0;
+			unsigned int len = length_base[sym] + get_bits(s, length_extra[sym]);
+			sym = decode(s, &s->dist);
+			if (sym >= 30) return 0;
+			if (!out_match(s, dist_base[sym] + get_bits(s, dist_extra[sym]), len)) return 0;
+		}
+	}
+	return 0;
+}
+
+static int inflate_fixed(UNPACK_STATE *s) {
+	uint8_t lengths[288];
+	memset(lengths, 8, 144);
+	memset(lengths + 144, 9, 112);
+	memset(lengths + 256, 7, 24);
+	memset(lengths + 280, 8, 8);
+	build(&s->lit, lengths, 288);
+	memset(lengths, 5, 30);
+	build(&s->dist, lengths, 30);
+	return inflate_codes(s);
+}
+
+static int inflate_dynamic(UNPACK_STATE *s) {
+	uint8_t lengths[320];
+	int nlit = get_bits(s, 5) + 257;
+	int ndist = get_bits(s, 5) + 1;
+	int ncode = get_bits(s, 4) + 4;
+	if (nlit > 286 || ndist > 30) return 0;
+	memset(lengths, 0, 19);
+	for (int i = 0; i < ncode; i++)
+		lengths[code_length_order[i]] = get_bits(s, 3);
+	if (!build(&s->lit, lengths, 19)) return 0;	// the code length code, for now
+	for (int i = 0; i < nlit + ndist; ) {
+		int sym = decode(s, &s->lit), len = 0, repeat;
+		if (s->error) return 0;
+		if (sym < 16) {
+			lengths[i++] = sym;
+			continue;
+		}
+		if (sym == 16) {
+			if (i == 0) return 0;
+			len = lengths[i - 1];
+			repeat = 3 + get_bits(s, 2);
+		}
+		else if (sym == 17)
+			repeat = 3 + get_bits(s, 3);
+		else
+			repeat = 11 + get_bits(s, 7);
+		if (i + repeat > nlit + ndist) return 0;
+		while (repeat--)
+			lengths[i++] = len;
+	}
+	if (!build(&s->lit, lengths, nlit) || !build(&s->dist, lengths + nlit, ndist)) return 0;
+	return inflate_codes(s);
+}
+
+// leaves the archive at the byte after the deflate stream
+static int inflate(UNPACK_STATE *s) {
+	int last;
+	s->bits = 0;
+	s->num_bits = 0;
+	do {
+		last = get_bits(s, 1);
+		int type = get_bits(s, 2), ok;
+		if (type == 0) {
+			s->bits = 0;	// stored, from the next byte
+			s->num_bits = 0;
+			unsigned int len = read_le(s, 2);
+			if ((len ^ read_le(s, 2)) != 0xFFFF) return 0;
+			ok = out_literals(s, len);
+		}
+		else if (type == 1)
+			ok = inflate_fixed(s);
+		else if (type == 2)
+			ok = inflate_dynamic(s);
+		else
+			ok = 0;
+		if (!ok || s->error) return 0;
+	} while (!last);
+	s->bits = 0;	// the stream ends on a byte boundary
+	s->num_bits = 0;
+	return 1;
+}
+
+// the local headers in order, up to the first member that is a rom
+static int unpack_zip(UNPACK_STATE *s) {
+	UNPACK *u = s->u;
+	unsigned char h[30];
+	while (1) {
+		read_bytes(s, h, 30);
+		if (s->error || h[0] != 'P' || h[1] != 'K' || h[2] != 3 || h[3] != 4)
+			return 0;	// the central directory, no rom in it
+		int flags = h[6] | h[7] << 8, method = h[8] | h[9] << 8;
+		uint32_t crc = h[14] | h[15] << 8 | h[16] << 16 | (uint32_t)h[17] << 24;
+		uint32_t packed = h[18] | h[19] << 8 | h[20] << 16 | (uint32_t)h[21] << 24;
+		unsigned int name_len = h[26] | h[27] << 8, extra_len = h[28] | h[29] << 8;
+		unsigned int keep = name_len < UNPACK_MAX_NAME ? name_len : UNPACK_MAX_NAME - 1;
+		read_bytes(s, (unsigned char *)u->name, keep);
+		read_bytes(s, 0, name_len - keep + extra_len);
+		u->name[keep] = 0;
+		// the name is a path within the archive
+		char *base = strrchr(u->name, '/');
+		if (base)
+			memmove(u->name, base + 1, strlen(base));
+		if (!u->name[0] || (flags & 1) || !u->accept(u->name)) {
+			if (flags & 8) return 0;	// its size follows it
+			read_bytes(s, 0, packed);
+			continue;
+		}
+		int ok;
+		if (method == 0 && !(flags & 8))
+			ok = out_literals(s, packed);
+		else if (method == 8)
+			ok = inflate(s);
+		else
+			return 0;
+		if (!ok) return 0;
+		if (flags & 8)
+		{	// the crc is in a data descriptor, which may have a signature
+			crc = read_le(s, 4);
+			if (crc == 0x08074B50)
+				crc = read_le(s, 4);
+		}
+		u->crc = crc;
+		u->has_crc = !s->error;
+		return 1;
+	}
+}
+
+static int unpack_gz(UNPACK_STATE *s) {
+	UNPACK *u = s->u;
+	unsigned char h[10];
+	read_bytes(s, h, 10);
+	if (s->error || h[0] != 0x1F || h[1] != 0x8B || h[2] != 8)
+		return 0;
+	if (h[3] & 4)
+		read_bytes(s, 0, read_le(s, 2));
+	if (h[3] & 8)
+	{	// the original file name
+		unsigned int len = 0;
+		int c;
+		while ((c = next_byte(s)) && !s->error)
+			if (len < UNPACK_MAX_NAME - 1)
+				u->name[len++] = c;
+		u->name[len] = 0;
+	}
+	if (h[3] & 16)
+		while (next_byte(s) && !s->error);
+	if (h[3] & 2)
+		read_bytes(s, 0, 2);
+	if (!inflate(s))
+		return 0;
+	u->crc = read_le(s, 4);
+	uint32_t size = read_le(s, 4);
+	u->has_crc = !s->error;
+	return !s->error && size == u->out_pos;
+}
+
+// the next byte of an lz4 block, counted off what is left of it
+static inline int block_byte(UNPACK_STATE *s, uint32_t *left) {
+	if (*left == 0) {
+		s->error = 1;
+		return 0;
+	}
+	(*left)--;
+	return next_byte(s);
+}
+
+static int unpack_lz4(UNPACK_STATE *s) {
+	if (read_le(s, 4) != 0x184D2204)
+		return 0;
+	int flags = next_byte(s);
+	next_byte(s);	// block size, everything goes to the output anyway
+	if ((flags & 0xC0) != 0x40)
+		return 0;
+	read_bytes(s, 0, ((flags & 8) ? 8 : 0) + ((flags & 1) ? 4 : 0) + 1);
+	while (!s->error) {
+		uint32_t left = read_le(s, 4);
+		if (left == 0)
+			break;
+		if (left & 0x80000000) {
+			if (!out_literals(s, left & 0x7FFFFFFF)) return 0;
+		}
+		else while (left && !s->error)
+		{	// a sequence: literals, then a match unless the block ends
+			int token = block_byte(s, &left);
+			unsigned int len = token >> 4, b;
+			if (len == 15)
+				do { b = block_byte(s, &left); len += b; } while (b == 255 && !s->error);
+			if (len > left || !out_literals(s, len)) return 0;
+			left -= len;
+			if (left == 0) break;
+			unsigned int dist = block_byte(s, &left);
+			dist |= block_byte(s, &left) << 8;
+			len = (token & 15) + 4;
+			if ((token & 15) == 15)
+				do { b = block_byte(s, &left); len += b; } while (b == 255 && !s->error);
+			if (s->error || !out_match(s, dist, len)) return 0;
+		}
+		if (flags & 0x10)
+			read_bytes(s, 0, 4);	// block checksum
+	}
+	if (flags & 4)
+		read_bytes(s, 0, 4);	// xxHash of the content, not checked
+	return !s->error;
+}
+
+// unpacks the rom in an archive of the given format into u->out, returns 0 if it
+// isn't a valid archive, holds no rom or the rom doesn't fit
+int unpack(UNPACK *u, int format) {
+	UNPACK_STATE *s = &unpack_state;
+	s->u = u;
+	s->in_pos = s->in_len = 0;
+	s->error = 0;
+	u->out_pos = 0;
+	u->has_crc = 0;
+	u->name[0] = 0;
+	if (format == UNPACK_ZIP)
+		return unpack_zip(s);
+	if (format == UNPACK_GZ)
+		return unpack_gz(s);
+	if (format == UNPACK_LZ4)
+		return unpack_lz4(s);
+	return 0;
+}
@@ -0,0 +1,31 @@
+#ifndef UNPACK_H
+#define UNPACK_H
+
+#include <stdint.h>
+
+#define UNPACK_NONE		0
+#define UNPACK_ZIP		1	// the first member the caller accepts, stored or deflated
+#define UNPACK_GZ		2
+#define UNPACK_LZ4		3	// lz4 frame format
+
+#define UNPACK_MAX_NAME	64
+
+typedef struct {
+	// set by the caller
+	unsigned int (*read)(unsigned char *dst, unsigned int len);	// fewer bytes only at the end of the file or on an error
+	int (*accept)(char *name);	// whether a zip member is a rom
+	unsigned char *out;
+	unsigned int out_size;
+	// set by unpack()
+	volatile unsigned int out_pos;	// bytes unpacked so far
+	uint32_t crc;	// the archive's CRC-32 of the rom, if has_crc is set
+	int has_crc;
+	char name[UNPACK_MAX_NAME];	// the rom's own file name, if the archive keeps it
+} UNPACK;
+
+extern const char *unpack_extensions[];
+
+int unpack_format(char *filename);
+int unpack(UNPACK *u, int format);
+
+#endif // UNPACK_H
@@ -0,0 +1,1491 @@
+#!/usr/bin/env python3
+"""Worst-case bus timing of the cartridge kernels, from the firmware ELF.
+
+Each bus kernel (the emulate_* functions, and the menu's boot, return and busy
+kernels in MENU_KERNELS) is run in a small Cortex-M4 (Thumb-2) instruction set
+simulator against a console that puts a new address on the bus every bus
+cycle: 141 CPU cycles at 168MHz for the 2600's 1.19MHz, 94 for the 7800's
+1.79MHz.
+
+The paths through a kernel are enumerated, not sampled:
+
+  - From a state where the kernel is waiting on the address pins, each of the
+    8192 addresses is put on the bus just after a read of the pins, so that
+    the kernel takes a whole turn of its wait loop to see it, and followed
+    until the kernel is waiting again.
+  - Decisions worked out from the pins go the way the address and data make
+    them go. All the others (on the bank or anything else kept in memory from
+    an earlier bus cycle, a flag, the cycle counter, a snapshot being saved,
+    the flash being busy, the PLL) are taken both ways, and table branches
+    every way, the first time each comes up in a bus cycle. That covers states
+    the console would take a long time to get the kernel into, at the price of
+    paths that may never happen; those are marked with a *, and forced runs
+    that crash are counted, not timed. Variables in KERNEL_FIXED are the
+    exception: decisions on them go the way KERNEL_MEMORY sets them.
+  - The addresses are grouped by the path they take from the first state.
+    The state the kernel is left in by each group is explored in turn with
+    the first and last address of every group, --depth bus cycles deep: the
+    work a kernel does after a write or a read of the switches is done at the
+    start of the next bus cycle.
+
+Calls are followed, into SRAM or flash, and timed like the rest of the kernel.
+The exceptions are listed in SKIP_CALLS: the menu handshake a cart kernel makes
+before its loop, and the card accesses that leave the bus on purpose. A bus
+cycle that makes one of those, or in which the kernel returns (the menu's
+commands, which the menu waits for in its own RAM), is reported as leaving
+the bus and is not timed.
+
+For every path, two things are measured from the moment the address changed:
+
+  drive  when the kernel turned the data pins to outputs (GPIOE->MODER), for
+         the cycles where it answers with a byte
+  busy   when it was back waiting on the address pins, ready to see the next
+         change
+
+A kernel fails if a path drives later than the console's budget or is still
+busy when the next address arrives (or, for the kernels in KERNEL_GAPS, the
+next one the console may put on the cart).
+
+The cycle counts follow the Cortex-M4 TRM, taking the slow end of each range:
+taken branches refill the whole pipeline, loads and stores are never pipelined
+together, GPIO accesses add wait states (--periph-ws) and flash accesses the
+ones in FLASH->ACR, less what the ART accelerator's caches hit when they are
+on. Kernels start with the clock as main() leaves it (--flash-ws). The boot
+kernel starts at the 16MHz HSI clock after reset and switches to the PLL
+itself; the RCC is modelled for that, the PLL locking PLL_LOCK_US after it is
+turned on, and a cycle at HSI counts as 10.5, so that budgets are the same
+time whatever the clock. Bus cycles missed by the sampling (GPIO synchroniser,
+a few cycles) belong in the budget, not here.
+
+usage: kernel_cycles.py [-v] [--depth N] [--kernel NAME] [--budget-2600 C] [--budget-7800 C] firmware.elf
+"""
+
+import argparse
+import copy
+import math
+import struct
+import sys
+
+GPIOC_IDR = 0x40020810
+GPIOD_IDR = 0x40020C10
+GPIOE_MODER = 0x40021000
+GPIOE_IDR = 0x40021010
+GPIOE_ODR = 0x40021014
+RCC_CR = 0x40023800
+RCC_CFGR = 0x40023808
+FLASH_ACR = 0x40023C00
+DWT_CYCCNT = 0xE0001004
+
+RCC_CR_HSION = 1 << 0
+RCC_CR_HSIRDY = 1 << 1
+RCC_CR_HSEON = 1 << 16
+RCC_CR_HSERDY = 1 << 17
+RCC_CR_PLLON = 1 << 24
+RCC_CR_PLLRDY = 1 << 25
+FLASH_ACR_ICEN = 1 << 9
+FLASH_ACR_DCEN = 1 << 10
+ICACHE_LINES = 64	# of 16 bytes
+DCACHE_LINES = 8
+HSI_SCALE = 168 / 16
+PLL_LOCK_US = 200	# the datasheet's worst case
+
+STACK_TOP = 0x20020000
+RETURN_ADDR = 0xFFFFFFFE
+
+# bus cycle length in CPU cycles, and the default drive budget
+CONSOLES = {
+	'2600': (168000000 // 1190000, 115),
+	'7800': (168000000 // 1790000, 67),
+}
+
+# the functions that only pick a kernel
+NOT_KERNELS = {'emulate_cartridge'}
+
+# the menu's kernels: serving the menu rom from reset, and answering the menu
+# while the SD card is busy (the card driver calls TM_FATFS_SD_WaitCallback()
+# over and over as it waits); sending a game back to the menu is timed as part
+# of the cart kernels, which call return_to_firmware_cartridge() when reset is
+# held down
+MENU_KERNELS = ['boot_firmware_cartridge', 'TM_FATFS_SD_WaitCallback']
+
+# arguments, for kernels that take them; names are symbols
+KERNEL_ARGS = {
+	'emulate_FxSC_cartridge': [
+		('F8', (0x1FF8, 0x1FF9, 0)), ('F6', (0x1FF6, 0x1FF9, 0)), ('F4', (0x1FF4, 0x1FFB, 0)),
+		('F8SC', (0x1FF8, 0x1FF9, 1)), ('F6SC', (0x1FF6, 0x1FF9, 1)), ('F4SC', (0x1FF4, 0x1FFB, 1)),
+		('EF', (0x1FE0, 0x1FEF, 0)), ('EFSC', (0x1FE0, 0x1FEF, 1)),
+	],
+	'emulate_supercharger_cartridge': [('AR', (0, 3 * 8448, 'buffer', 1))],
+}
+
+# the menu kernels also serve the 7800's BIOS, which runs at 1.79MHz before it
+# starts the cart in 2600 mode
+KERNEL_CONSOLES = {
+	'emulate_firmware_cartridge': ('2600', '7800'),
+	'boot_firmware_cartridge': ('2600', '7800'),
+}
+
+# kernels that start at the HSI clock
+KERNEL_HSI = {'boot_firmware_cartridge'}
+
+# variables set before a kernel starts, by symbol
+KERNEL_MEMORY = {
+	# with a rom loading, and its signature scan on a SIG_SCAN on the stack a
+	# LOAD_SCAN_SLICE behind (forcing the check on the slice the other way then
+	# scans no more than it would)
+	'TM_FATFS_SD_WaitCallback': {'comms_enabled': 1, 'menu_running': 1,
+		'load_scan': STACK_TOP - 0x1000, 'load_scan_end': 4},
+}
+
+# variables of KERNEL_MEMORY that don't change while a kernel runs: decisions on
+# them go the way they are set, they aren't forced
+KERNEL_FIXED = {
+	'TM_FATFS_SD_WaitCallback': ['comms_enabled', 'menu_running'],
+}
+
+# kernels that are called again as soon as they return, and the cycles their
+# caller takes in between
+KERNEL_POLLED = {
+	# the slowest caller, raw_scan() polling a split sector read: the slice's time
+	# check, raw_window_poll(), TM_FATFS_SD_ReadPoll() and the DMA flag test
+	'TM_FATFS_SD_WaitCallback': 100,
+}
+
+# kernels serving a console that leaves the cart alone for a number of bus cycles
+# after each access to it: a kernel may be busy for that long after the access
+# that follows one to the cart
+KERNEL_GAPS = {
+	# the menu waits from 2600 RAM, where an instruction reaching the cart has
+	# three bytes to fetch from RAM before it does
+	'TM_FATFS_SD_WaitCallback': 3,
+}
+
+# calls that are not followed: what they return, and why a bus cycle that makes
+# one leaves the bus (None for the ones only made before a kernel's loop)
+MULTILOAD = 'a supercharger multiload reads the card while the BIOS waits in 2600 RAM'
+SKIP_CALLS = {
+	'reboot_into_cartridge': (1, None),	# the menu's handshake
+	'f_mount': (0, MULTILOAD),
+	'f_open': (0, MULTILOAD),
+	'f_lseek': (0, MULTILOAD),
+	'f_read': (0, MULTILOAD),
+	'f_close': (0, MULTILOAD),
+}
+
+# the data the console puts on the bus
+BUS_DATA = 0xFF
+
+# reads of the address pins in a row from one instruction that make a kernel
+# waiting; more than a stable address check takes
+WAIT_READS = 6
+
+
+class SimError(Exception):
+	pass
+
+
+# ---------------------------------------------------------------------------
+# ELF
+
+class Elf:
+	def __init__(self, path):
+		data = open(path, 'rb').read()
+		if data[:4] != b'\x7fELF' or data[4] != 1 or data[5] != 1:
+			raise SimError('%s: not a 32-bit little endian ELF file' % path)
+		(e_shoff,) = struct.unpack_from('<I', data, 32)
+		e_shentsize, e_shnum, e_shstrndx = struct.unpack_from('<HHH', data, 46)
+		self.sections = []
+		for i in range(e_shnum):
+			self.sections.append(struct.unpack_from('<IIIIIIIIII', data, e_shoff + i * e_shentsize))
+		self.data = data
+		self.symbols = {}
+		for sh in self.sections:
+			if sh[1] != 2:	# SHT_SYMTAB
+				continue
+			strtab = self.sections[sh[6]]
+			for off in range(sh[4], sh[4] + sh[5], 16):
+				st_name, st_value, st_size, st_info, st_other, st_shndx = struct.unpack_from('<IIIBBH', data, off)
+				if st_shndx == 0 or (st_info & 0xF) not in (1, 2):	# objects and functions
+					continue
+				end = data.index(b'\0', strtab[4] + st_name)
+				name = data[strtab[4] + st_name:end].decode()
+				self.symbols[name] = (st_value, st_size, st_info & 0xF)
+
+	def load(self, memory):
+		for sh in self.sections:
+			sh_type, sh_flags, sh_addr, sh_offset, sh_size = sh[1], sh[2], sh[3], sh[4], sh[5]
+			if sh_flags & 2 and sh_type == 1:	# SHF_ALLOC, SHT_PROGBITS
+				memory.write_bytes(sh_addr, self.data[sh_offset:sh_offset + sh_size])
+
+	def functions(self):
+		return {name: (value & ~1, size) for name, (value, size, kind) in self.symbols.items() if kind == 2}
+
+	def name_of(self, addr):
+		best = None
+		for name, (value, size, kind) in self.symbols.items():
+			if kind == 2 and (value & ~1) <= addr < (value & ~1) + max(size, 1):
+				best = '%s+0x%x' % (name, addr - (value & ~1))
+		return best or '0x%08x' % addr
+
+
+# ---------------------------------------------------------------------------
+# Memory and the console's side of the bus
+
+class Memory:
+	"""Sparse memory, copied a page at a time when a clone writes to it"""
+	PAGE = 4096
+
+	def __init__(self):
+		self.pages = {}
+		self.own = set()	# pages not shared with a clone
+
+	def clone(self):
+		memory = Memory()
+		memory.pages = dict(self.pages)
+		self.own = set()
+		return memory
+
+	def _page(self, addr, write):
+		n = addr // self.PAGE
+		page = self.pages.get(n)
+		if page is None:
+			page = self.pages[n] = bytearray(self.PAGE)
+			self.own.add(n)
+		elif write and n not in self.own:
+			page = self.pages[n] = bytearray(page)
+			self.own.add(n)
+		return page
+
+	def write_bytes(self, addr, data):
+		for i, b in enumerate(data):
+			self._page(addr + i, True)[(addr + i) % self.PAGE] = b
+
+	def read(self, addr, size):
+		value = 0
+		for i in range(size):
+			value |= self._page(addr + i, False)[(addr + i) % self.PAGE] << (8 * i)
+		return value
+
+	def write(self, addr, size, value):
+		for i in range(size):
+			self._page(addr + i, True)[(addr + i) % self.PAGE] = (value >> (8 * i)) & 0xFF
+
+
+class Console:
+	"""The console: one (address, data) on the bus, then another from change_at on"""
+
+	def __init__(self, before, after, change_at):
+		self.before = before
+		self.after = after
+		self.change_at = change_at
+
+	def cycle(self, now):
+		return self.after if now >= self.change_at else self.before
+
+
+# ---------------------------------------------------------------------------
+# The CPU
+
+COND_NAMES = ['eq', 'ne', 'cs', 'cc', 'mi', 'pl', 'vs', 'vc', 'hi', 'ls', 'ge', 'lt', 'gt', 'le', 'al', 'al']
+MASK32 = 0xFFFFFFFF
+
+
+def sign_extend(value, bits):
+	value &= (1 << bits) - 1
+	return value - (1 << bits) if value & (1 << (bits - 1)) else value
+
+
+def ror(value, amount):
+	amount %= 32
+	return ((value >> amount) | (value << (32 - amount))) & MASK32 if amount else value
+
+
+def shift_c(value, kind, amount, carry):
+	"""Shift() of the ARM ARM, with the carry out. kind: 0 LSL 1 LSR 2 ASR 3 ROR 4 RRX"""
+	if kind == 4:
+		return (value >> 1) | (carry << 31), value & 1
+	if amount == 0:
+		return value, carry
+	if kind == 0:
+		if amount > 32:
+			return 0, 0
+		return (value << amount) & MASK32, (value >> (32 - amount)) & 1
+	if kind == 1:
+		if amount > 32:
+			return 0, 0
+		return value >> amount, (value >> (amount - 1)) & 1
+	if kind == 2:
+		if amount >= 32:
+			bit = value >> 31
+			return MASK32 * bit, bit
+		return (sign_extend(value, 32) >> amount) & MASK32, (value >> (amount - 1)) & 1
+	result = ror(value, amount)
+	return result, result >> 31
+
+
+def decode_imm_shift(kind, imm5):
+	if kind == 0:
+		return 0, imm5
+	if kind in (1, 2):
+		return kind, imm5 or 32
+	return (4, 1) if imm5 == 0 else (3, imm5)
+
+
+def expand_imm_c(imm12, carry):
+	"""ThumbExpandImm_C()"""
+	if imm12 >> 10 == 0:
+		imm8 = imm12 & 0xFF
+		kind = (imm12 >> 8) & 3
+		if kind == 0:
+			return imm8, carry
+		if kind == 1:
+			return imm8 << 16 | imm8, carry
+		if kind == 2:
+			return imm8 << 24 | imm8 << 8, carry
+		return imm8 * 0x01010101, carry
+	value = ror(0x80 | (imm12 & 0x7F), imm12 >> 7)
+	return value, value >> 31
+
+
+def add_with_carry(x, y, carry):
+	unsigned = x + y + carry
+	result = unsigned & MASK32
+	signed = sign_extend(x, 32) + sign_extend(y, 32) + carry
+	return result, int(unsigned > MASK32), int(sign_extend(result, 32) != signed)
+
+
+class Registers(list):
+	"""r0-r15, noting the ones each instruction reads and writes"""
+
+	def __init__(self, values):
+		list.__init__(self, values)
+		self.used = set()
+		self.written = set()
+
+	def __getitem__(self, n):
+		self.used.add(n)
+		return list.__getitem__(self, n)
+
+	def __setitem__(self, n, value):
+		self.written.add(n)
+		list.__setitem__(self, n, value)
+
+
+class Cpu:
+	def __init__(self, memory, timing, hsi):
+		self.mem = memory
+		self.console = Console((0, 0), (0, 0), 0)
+		self.r = Registers([0] * 16)
+		self.n = self.z = self.c = self.v = 0
+		self.it_cond = None
+		self.it_mask = 0
+		self.it_first = False	# the next instruction is the first of an IT block
+		self.it_invert = False	# the block's condition was forced the other way
+		self.cycles = 0		# in 168MHz cycles, whatever the clock
+		self.periph_ws, self.refill = timing
+		self.scale = HSI_SCALE if hsi else 1
+		self.pll_on = None	# when RCC->CR's PLLON was set
+		self.icache = []	# flash lines in the ART accelerator's caches, most recent last
+		self.dcache = []
+		self.symbols = {}	# function names, by address
+		self.entry = None	# (address, arguments) of the kernel
+		self.polled = False	# the kernel is called over and over, see KERNEL_POLLED
+		self.gap = 1		# bus cycles the console may leave the cart alone, see KERNEL_GAPS
+		self.fixed = set()	# bytes of the variables in KERNEL_FIXED
+		self.returned = False
+		self.left = None	# the SKIP_CALLS function a bus cycle left the bus through
+		self.read_time = 0	# of the last read of the address pins, in a saved state
+		self.taint = [False] * 16	# registers holding a value worked out from the pins
+		self.flag_taint = False
+		self.begin_cycle({}, False)
+
+	def begin_cycle(self, plan, forking):
+		"""clears the logs and the memory's taint for a bus cycle, with the decisions to force"""
+		self.mem_taint = set()	# bytes stored from a value read from the pins this cycle
+		self.plan = plan	# outcome of each forkable decision to force, by its index
+		self.forking = forking
+		self.forkable = []	# (index, outcome, other outcomes) of the decisions that can be forced
+		self.forked_pcs = set()
+		self.path = []		# (pc, outcome, forced) of each decision
+		self.reads = []		# (cycle, pc) of each read of the address pins
+		self.drives = []	# cycle of each store that turned the data pins to outputs
+
+	def clone(self):
+		cpu = copy.copy(self)
+		cpu.mem = self.mem.clone()
+		cpu.r = Registers(self.r)
+		cpu.taint = list(self.taint)
+		cpu.icache = list(self.icache)
+		cpu.dcache = list(self.dcache)
+		cpu.begin_cycle({}, False)
+		return cpu
+
+	def enter(self):
+		"""calls the kernel, as main() would"""
+		start, args = self.entry
+		for i, arg in enumerate(args):
+			self.r[i] = arg
+		self.r[13] = STACK_TOP
+		self.r[14] = RETURN_ADDR
+		self.r[15] = start
+		self.returned = False
+
+	# -- memory, with the pins, the clock and the wait states
+
+	def flash_ws(self, addr, cache):
+		"""wait states of a flash access, through one of the ART accelerator's caches if it's on"""
+		acr = self.mem.read(FLASH_ACR, 4)
+		if not acr & (FLASH_ACR_ICEN if cache is self.icache else FLASH_ACR_DCEN):
+			return acr & 7
+		line = addr >> 4
+		if line in cache:
+			cache.remove(line)
+			cache.append(line)
+			return 0
+		cache.append(line)
+		if len(cache) > (ICACHE_LINES if cache is self.icache else DCACHE_LINES):
+			del cache[0]
+		return acr & 7
+
+	def access_cost(self, addr):
+		if 0x40000000 <= addr < 0x60000000:
+			return self.periph_ws
+		if 0x08000000 <= addr < 0x08100000:
+			return self.flash_ws(addr, self.dcache)
+		return 0
+
+	def load(self, addr, size):
+		addr &= MASK32
+		now = self.cycles + self.scale
+		mask = (1 << (8 * size)) - 1
+		if addr == GPIOD_IDR:
+			self.load_taint = True
+			self.reads.append((now, self.pc_now))
+			return self.console.cycle(now)[0] & mask
+		if addr == GPIOE_IDR:
+			self.load_taint = True
+			return (self.console.cycle(now)[1] << 8) & mask
+		if addr == GPIOC_IDR:
+			return 0xFFFF & mask
+		if addr == RCC_CR:	# HSIRDY and HSERDY follow HSION and HSEON at once, PLLRDY PLL_LOCK_US after PLLON
+			value = self.mem.read(addr, 4) & ~(RCC_CR_PLLRDY | RCC_CR_HSERDY | RCC_CR_HSIRDY)
+			value |= (value & RCC_CR_HSION) << 1 | (value & RCC_CR_HSEON) << 1
+			if self.pll_on is not None and now - self.pll_on >= PLL_LOCK_US * 168:
+				value |= RCC_CR_PLLRDY
+			return value & mask
+		if addr == RCC_CFGR:	# SWS follows SW at once
+			value = self.mem.read(addr, 4)
+			return (value & ~0xC | (value & 3) << 2) & mask
+		if addr == DWT_CYCCNT:
+			return int(now) & mask
+		if self.mem_taint and any(a in self.mem_taint for a in range(addr, addr + size)):
+			self.load_taint = True
+		if self.fixed and any(a in self.fixed for a in range(addr, addr + size)):
+			self.load_taint = True	# not from the pins, but as sure
+		return self.mem.read(addr, size)
+
+	def store(self, addr, size, value):
+		addr &= MASK32
+		value &= (1 << (8 * size)) - 1
+		now = self.cycles + self.scale
+		if addr == GPIOE_MODER and value & 0xFFFF0000:
+			self.drives.append(now)
+		elif addr == RCC_CR:
+			if not value & RCC_CR_PLLON:
+				self.pll_on = None
+			elif self.pll_on is None:
+				self.pll_on = now
+		elif addr == RCC_CFGR and (value & 3) == 2 and self.load(RCC_CR, 4) & RCC_CR_PLLRDY:
+			self.scale = 1	# running from the PLL
+		tainted = self.load_taint or any(self.taint[n] for n in self.r.used)
+		for a in range(addr, addr + size):
+			if tainted:
+				self.mem_taint.add(a)
+			else:
+				self.mem_taint.discard(a)
+		self.mem.write(addr, size, value)
+
+	# -- registers and flags
+
+	def reg(self, n):
+		return (self.pc_now + 4) & MASK32 if n == 15 else self.r[n]
+
+	def set_reg(self, n, value):
+		if n == 15:
+			self.branch(value)
+		else:
+			self.r[n] = value & MASK32
+
+	def branch(self, target):
+		target &= ~1 & MASK32
+		name = self.symbols.get(target)
+		if name in SKIP_CALLS:	# not followed, it returns at once
+			value, why = SKIP_CALLS[name]
+			if why and self.forking:
+				self.left = name
+			self.r[0] = value
+			self.r[1] = self.r[2] = self.r[3] = self.r[12] = 0
+			target = self.r[14] & ~1
+		self.next_pc = target
+		self.extra += self.refill
+		if 0x08000000 <= target < 0x08100000:
+			self.extra += self.flash_ws(target, self.icache)
+
+	def set_nz(self, value):
+		self.n = (value >> 31) & 1
+		self.z = int(value & MASK32 == 0)
+		self.flags_set = True
+
+	def condition(self, cond):
+		if cond == 0: return self.z
+		if cond == 1: return not self.z
+		if cond == 2: return self.c
+		if cond == 3: return not self.c
+		if cond == 4: return self.n
+		if cond == 5: return not self.n
+		if cond == 6: return self.v
+		if cond == 7: return not self.v
+		if cond == 8: return self.c and not self.z
+		if cond == 9: return not self.c or self.z
+		if cond == 10: return self.n == self.v
+		if cond == 11: return self.n != self.v
+		if cond == 12: return not self.z and self.n == self.v
+		if cond == 13: return self.z or self.n != self.v
+		return True
+
+	def decide(self, outcome, tainted, others):
+		"""the outcome of a decision: as it comes if it depends on the pins read in this
+		bus cycle or has been forked on already, else as the plan says"""
+		pc = self.pc_now
+		forced = False
+		if not tainted and self.forking and pc not in self.forked_pcs:
+			self.forked_pcs.add(pc)
+			index = len(self.forkable)
+			self.forkable.append((index, outcome, [o for o in others if o != outcome]))
+			if index in self.plan:
+				outcome = self.plan[index]
+				forced = True
+		self.path.append((pc, outcome, forced))
+		return outcome
+
+	# -- the instruction loop
+
+	def step(self):
+		pc = self.pc_now = list.__getitem__(self.r, 15)
+		if pc == RETURN_ADDR & ~1:
+			self.returned = True
+			return
+		hw1 = self.mem.read(pc, 2)
+		wide = hw1 >> 11 in (0x1D, 0x1E, 0x1F)
+		hw2 = self.mem.read(pc + 2, 2) if wide else 0
+		self.next_pc = pc + (4 if wide else 2)
+		self.extra = 0
+		self.r.used.clear()
+		self.r.written.clear()
+		self.load_taint = self.flags_set = False
+
+		in_it = self.it_cond is not None
+		if in_it:
+			cond = self.it_cond
+			self.it_advance()
+			passed = bool(self.condition(cond))
+			if self.it_first:	# the block is one decision
+				self.it_first = False
+				outcome = self.decide(passed, self.flag_taint, (True, False))
+				self.it_invert = outcome != passed
+				passed = outcome
+			else:
+				passed = passed != self.it_invert
+			if not passed:
+				list.__setitem__(self.r, 15, self.next_pc)
+				self.cycles += self.scale
+				return
+		cost = self.execute32(hw1, hw2) if wide else self.execute16(hw1, in_it)
+		list.__setitem__(self.r, 15, self.next_pc)
+		self.cycles += (cost + self.extra) * self.scale
+		# values worked out from the pins are tainted, and so are the flags set from them
+		tainted = self.load_taint or (in_it and self.flag_taint) or any(self.taint[n] for n in self.r.used if n != 15)
+		for n in self.r.written:
+			self.taint[n] = tainted
+		if self.flags_set:
+			self.flag_taint = tainted
+
+	def it_advance(self):
+		if self.it_mask & 0xF == 0x8:
+			self.it_cond = None
+			self.it_mask = 0
+			return
+		self.it_cond = (self.it_cond & 0xE) | ((self.it_mask >> 3) & 1)
+		self.it_mask = (self.it_mask << 1) & 0xF
+
+	def call(self, target):
+		self.set_reg(14, self.next_pc | 1)
+		self.branch(target)
+
+	def conditional_branch(self, cond, target):
+		if self.decide(bool(self.condition(cond)), self.flag_taint, (True, False)):
+			self.branch(target)
+
+	def table_size(self, base, entry):
+		"""entries in a TBB/TBH table, which ends where its first case starts"""
+		n, lowest = 0, None
+		while n < 256 and (lowest is None or n * entry < lowest * 2):
+			value = self.mem.read(base + n * entry, entry)
+			lowest = value if lowest is None else min(lowest, value)
+			n += 1
+		return n
+
+	# -- 16-bit instructions
+
+	def execute16(self, hw, in_it):
+		setflags = not in_it
+		top = hw >> 11
+		if hw >> 14 == 0:
+			op = (hw >> 11) & 7
+			if op < 3:	# LSL, LSR, ASR immediate
+				rd, rm, imm5 = hw & 7, (hw >> 3) & 7, (hw >> 6) & 31
+				kind, amount = decode_imm_shift(op, imm5)
+				result, carry = shift_c(self.r[rm], kind, amount, self.c)
+				self.r[rd] = result
+				if setflags:
+					self.set_nz(result)
+					self.c = carry
+				return 1
+			if op == 3:	# ADD, SUB register or imm3
+				rd, rn = hw & 7, (hw >> 3) & 7
+				operand = (hw >> 6) & 7 if hw & 0x400 else self.r[(hw >> 6) & 7]
+				if hw & 0x200:
+					result, c, v = add_with_carry(self.r[rn], ~operand & MASK32, 1)
+				else:
+					result, c, v = add_with_carry(self.r[rn], operand, 0)
+				self.r[rd] = result
+				if setflags:
+					self.set_nz(result)
+					self.c, self.v = c, v
+				return 1
+			rdn, imm8 = (hw >> 8) & 7, hw & 0xFF
+			if op == 4:	# MOV
+				self.r[rdn] = imm8
+				if setflags:
+					self.set_nz(imm8)
+				return 1
+			if op == 5:	# CMP
+				result, self.c, self.v = add_with_carry(self.r[rdn], ~imm8 & MASK32, 1)
+				self.set_nz(result)
+				return 1
+			if op == 6:
+				result, c, v = add_with_carry(self.r[rdn], imm8, 0)
+			else:
+				result, c, v = add_with_carry(self.r[rdn], ~imm8 & MASK32, 1)
+			self.r[rdn] = result
+			if setflags:
+				self.set_nz(result)
+				self.c, self.v = c, v
+			return 1
+		if hw >> 10 == 0x10:	# data processing
+			return self.data_processing16((hw >> 6) & 15, hw & 7, (hw >> 3) & 7, setflags)
+		if hw >> 10 == 0x11:	# special data processing and branch exchange
+			op = (hw >> 8) & 3
+			rdn = (hw & 7) | ((hw >> 4) & 8)
+			rm = (hw >> 3) & 15
+			if op == 0:
+				result = (self.reg(rdn) + self.reg(rm)) & MASK32
+				if rdn == 15:
+					self.branch(result)
+				else:
+					self.r[rdn] = result
+				return 1
+			if op == 1:
+				result, self.c, self.v = add_with_carry(self.reg(rdn), ~self.reg(rm) & MASK32, 1)
+				self.set_nz(result)
+				return 1
+			if op == 2:
+				if rdn == 15:
+					self.branch(self.reg(rm))
+				else:
+					self.r[rdn] = self.reg(rm)
+				return 1
+			target = self.reg(rm)
+			if hw & 0x80:	# BLX
+				self.call(target)
+				return 1
+			if target == RETURN_ADDR:
+				self.returned = True
+			self.branch(target)
+			return 1
+		if top == 0x09:	# LDR literal
+			rt = (hw >> 8) & 7
+			self.r[rt] = self.load(((self.pc_now + 4) & ~3) + (hw & 0xFF) * 4, 4)
+			return 2 + self.access_cost(((self.pc_now + 4) & ~3) + (hw & 0xFF) * 4)
+		if hw >> 12 == 0x5:	# load/store register offset
+			op = (hw >> 9) & 7
+			rt, rn, rm = hw & 7, (hw >> 3) & 7, (hw >> 6) & 7
+			return self.load_store(op, rt, (self.r[rn] + self.r[rm]) & MASK32)
+		if hw >> 13 == 0x3:	# STR/LDR(B) immediate
+			rt, rn, imm5 = hw & 7, (hw >> 3) & 7, (hw >> 6) & 31
+			byte, load = (hw >> 12) & 1, (hw >> 11) & 1
+			addr = (self.r[rn] + (imm5 if byte else imm5 * 4)) & MASK32
+			return self.load_store(6 if byte and load else 4 if load else 2 if byte else 0, rt, addr)
+		if top == 0x10 or top == 0x11:	# STRH/LDRH immediate
+			rt, rn, imm5 = hw & 7, (hw >> 3) & 7, (hw >> 6) & 31
+			return self.load_store(5 if top == 0x11 else 1, rt, (self.r[rn] + imm5 * 2) & MASK32)
+		if top == 0x12 or top == 0x13:	# STR/LDR SP relative
+			rt = (hw >> 8) & 7
+			return self.load_store(4 if top == 0x13 else 0, rt, (self.r[13] + (hw & 0xFF) * 4) & MASK32)
+		if top == 0x14:	# ADR
+			self.r[(hw >> 8) & 7] = ((self.pc_now + 4) & ~3) + (hw & 0xFF) * 4
+			return 1
+		if top == 0x15:	# ADD SP
+			self.r[(hw >> 8) & 7] = (self.r[13] + (hw & 0xFF) * 4) & MASK32
+			return 1
+		if hw >> 12 == 0xB:
+			return self.misc16(hw)
+		if top == 0x18 or top == 0x19:	# STM, LDM
+			rn, regs = (hw >> 8) & 7, [i for i in range(8) if hw & (1 << i)]
+			addr = self.r[rn]
+			cost = 1 + len(regs) + self.access_cost(addr)
+			for i in regs:
+				if top == 0x19:
+					self.r[i] = self.load(addr, 4)
+				else:
+					self.store(addr, 4, self.r[i])
+				addr = (addr + 4) & MASK32
+			if top == 0x18 or rn not in regs:
+				self.r[rn] = addr
+			return cost
+		if hw >> 12 == 0xD:
+			cond = (hw >> 8) & 15
+			if cond >= 14:
+				raise SimError('udf/svc at 0x%08x' % self.pc_now)
+			self.conditional_branch(cond, self.pc_now + 4 + sign_extend(hw & 0xFF, 8) * 2)
+			return 1
+		if top == 0x1C:
+			self.branch(self.pc_now + 4 + sign_extend(hw & 0x7FF, 11) * 2)
+			return 1
+		raise SimError('unknown instruction %04x at 0x%08x' % (hw, self.pc_now))
+
+	def data_processing16(self, op, rdn, rm, setflags):
+		a, b = self.r[rdn], self.r[rm]
+		carry, overflow = self.c, self.v
+		if op in (2, 3, 4, 7):	# shifts by register
+			result, carry = shift_c(a, {2: 0, 3: 1, 4: 2, 7: 3}[op], b & 0xFF, self.c)
+		elif op == 0 or op == 8:
+			result = a & b
+		elif op == 1:
+			result = a ^ b
+		elif op == 5:
+			result, carry, overflow = add_with_carry(a, b, self.c)
+		elif op == 6:
+			result, carry, overflow = add_with_carry(a, ~b & MASK32, self.c)
+		elif op == 9:	# RSB #0
+			result, carry, overflow = add_with_carry(~b & MASK32, 0, 1)
+		elif op == 10:
+			result, carry, overflow = add_with_carry(a, ~b & MASK32, 1)
+		elif op == 11:
+			result, carry, overflow = add_with_carry(a, b, 0)
+		elif op == 12:
+			result = a | b
+		elif op == 13:
+			result = (a * b) & MASK32
+		elif op == 14:
+			result = a & ~b & MASK32
+		else:
+			result = ~b & MASK32
+		if op not in (8, 10, 11):
+			self.r[rdn] = result
+		if setflags or op in (8, 10, 11):
+			self.set_nz(result)
+			if op != 13:
+				self.c = carry
+				self.v = overflow
+		return 1
+
+	def misc16(self, hw):
+		if hw & 0xFF00 == 0xB000:	# ADD/SUB SP immediate
+			imm = (hw & 0x7F) * 4
+			self.r[13] = (self.r[13] + (-imm if hw & 0x80 else imm)) & MASK32
+			return 1
+		if hw & 0xF500 == 0xB100:	# CBZ, CBNZ
+			rn = hw & 7
+			target = self.pc_now + 4 + (((hw >> 9) & 1) << 6 | ((hw >> 3) & 31) << 1)
+			if self.decide((self.r[rn] != 0) == bool(hw & 0x800), self.taint[rn], (True, False)):
+				self.branch(target)
+			return 1
+		if hw & 0xFF00 == 0xB200:	# SXTH, SXTB, UXTH, UXTB
+			rd, value = hw & 7, self.r[(hw >> 3) & 7]
+			op = (hw >> 6) & 3
+			self.r[rd] = [sign_extend(value, 16) & MASK32, sign_extend(value, 8) & MASK32, value & 0xFFFF, value & 0xFF][op]
+			return 1
+		if hw & 0xFE00 == 0xB400:	# PUSH
+			regs = [i for i in range(8) if hw & (1 << i)] + ([14] if hw & 0x100 else [])
+			addr = self.r[13] - 4 * len(regs)
+			self.r[13] = addr & MASK32
+			for i in regs:
+				self.store(addr, 4, self.r[i])
+				addr += 4
+			return 1 + len(regs)
+		if hw & 0xFFE8 == 0xB660:	# CPS
+			return 1
+		if hw & 0xFF00 == 0xBA00:	# REV, REV16, REVSH
+			rd, value = hw & 7, self.r[(hw >> 3) & 7]
+			op = (hw >> 6) & 3
+			if op == 0:
+				self.r[rd] = struct.unpack('<I', struct.pack('>I', value))[0]
+			elif op == 1:
+				self.r[rd] = ((value & 0x00FF00FF) << 8 | (value >> 8) & 0x00FF00FF) & MASK32
+			else:
+				self.r[rd] = sign_extend((value & 0xFF) << 8 | (value >> 8) & 0xFF, 16) & MASK32
+			return 1
+		if hw & 0xFE00 == 0xBC00:	# POP
+			regs = [i for i in range(8) if hw & (1 << i)] + ([15] if hw & 0x100 else [])
+			addr = self.r[13]
+			for i in regs:
+				value = self.load(addr, 4)
+				if i == 15:
+					if value == RETURN_ADDR:
+						self.returned = True
+					self.branch(value)
+				else:
+					self.r[i] = value
+				addr += 4
+			self.r[13] = addr & MASK32
+			return 1 + len(regs)
+		if hw & 0xFF00 == 0xBE00:
+			raise SimError('bkpt at 0x%08x' % self.pc_now)
+		if hw & 0xFF00 == 0xBF00:
+			if hw & 0xF:	# IT
+				self.it_cond = (hw >> 4) & 15
+				self.it_mask = hw & 15
+				self.it_first = True
+				self.it_invert = False
+			return 1	# hints
+		raise SimError('unknown instruction %04x at 0x%08x' % (hw, self.pc_now))
+
+	def load_store(self, op, rt, addr):
+		"""op as in the 16-bit register offset encodings"""
+		cost = 2 + self.access_cost(addr)
+		if op == 0:
+			self.store(addr, 4, self.r[rt])
+		elif op == 1:
+			self.store(addr, 2, self.r[rt])
+		elif op == 2:
+			self.store(addr, 1, self.r[rt])
+		elif op == 3:
+			self.r[rt] = sign_extend(self.load(addr, 1), 8) & MASK32
+		elif op == 4:
+			self.r[rt] = self.load(addr, 4)
+		elif op == 5:
+			self.r[rt] = self.load(addr, 2)
+		elif op == 6:
+			self.r[rt] = self.load(addr, 1)
+		else:
+			self.r[rt] = sign_extend(self.load(addr, 2), 16) & MASK32
+		return cost
+
+	# -- 32-bit instructions
+
+	def execute32(self, hw1, hw2):
+		op1 = (hw1 >> 11) & 3
+		op2 = (hw1 >> 4) & 0x7F
+		if op1 == 1:
+			if op2 & 0x64 == 0:
+				return self.load_store_multiple(hw1, hw2)
+			if op2 & 0x64 == 4:
+				return self.load_store_dual(hw1, hw2)
+			if op2 & 0x60 == 0x20:
+				return self.data_processing_shifted(hw1, hw2)
+		elif op1 == 2:
+			if hw2 & 0x8000:
+				return self.branches(hw1, hw2)
+			if op2 & 0x20 == 0:
+				return self.data_processing_modified(hw1, hw2)
+			return self.plain_immediate(hw1, hw2)
+		elif op1 == 3:
+			if op2 & 0x71 == 0 or op2 & 0x67 in (1, 3, 5):
+				return self.load_store_single(hw1, hw2)
+			if op2 & 0x70 == 0x20:
+				return self.data_processing_register(hw1, hw2)
+			if op2 & 0x78 == 0x30:
+				return self.multiply(hw1, hw2)
+			if op2 & 0x78 == 0x38:
+				return self.long_multiply(hw1, hw2)
+		raise SimError('unknown instruction %04x %04x at 0x%08x' % (hw1, hw2, self.pc_now))
+
+	def load_store_multiple(self, hw1, hw2):
+		rn, load, wback = hw1 & 15, hw1 & 0x10, hw1 & 0x20
+		regs = [i for i in range(16) if hw2 & (1 << i)]
+		decrement = (hw1 >> 7) & 3 == 2
+		start = self.r[rn] - 4 * len(regs) if decrement else self.r[rn]
+		addr = start & MASK32
+		cost = 1 + len(regs) + self.access_cost(addr)
+		for i in regs:
+			if load:
+				value = self.load(addr, 4)
+				if i == 15:
+					if value == RETURN_ADDR:
+						self.returned = True
+					self.branch(value)
+				else:
+					self.r[i] = value
+			else:
+				self.store(addr, 4, self.reg(i))
+			addr += 4
+		if wback and not (load and rn in regs):
+			self.r[rn] = start & MASK32 if decrement else addr & MASK32
+		return cost
+
+	def load_store_dual(self, hw1, hw2):
+		rn = hw1 & 15
+		if hw1 & 0xFFF0 == 0xE8D0 and hw2 & 0xFFE0 == 0xF000:	# TBB, TBH
+			rm, entry = hw2 & 15, 2 if hw2 & 0x10 else 1
+			base, index = self.reg(rn), self.r[rm]
+			cases = range(self.table_size(base, entry)) if rn == 15 else ()
+			index = self.decide(index, self.taint[rm], cases)
+			offset = self.load((base + index * entry) & MASK32, entry)
+			self.branch(self.pc_now + 4 + offset * 2)
+			return 2 + self.access_cost(base)
+		p, u, w = (hw1 >> 8) & 1, (hw1 >> 7) & 1, (hw1 >> 5) & 1
+		if not (p or w):
+			raise SimError('exclusive access at 0x%08x' % self.pc_now)
+		rt, rt2, imm = (hw2 >> 12) & 15, (hw2 >> 8) & 15, (hw2 & 0xFF) * 4
+		base = self.reg(rn) & ~3 if rn == 15 else self.r[rn]
+		offset_addr = (base + imm if u else base - imm) & MASK32
+		addr = offset_addr if p else base
+		if hw1 & 0x10:
+			self.r[rt] = self.load(addr, 4)
+			self.r[rt2] = self.load(addr + 4, 4)
+		else:
+			self.store(addr, 4, self.r[rt])
+			self.store(addr + 4, 4, self.r[rt2])
+		if w:
+			self.r[rn] = offset_addr
+		return 3 + self.access_cost(addr)
+
+	def shifted_operand(self, hw2):
+		kind, amount = decode_imm_shift((hw2 >> 4) & 3, ((hw2 >> 12) & 7) << 2 | (hw2 >> 6) & 3)
+		return shift_c(self.reg(hw2 & 15), kind, amount, self.c)
+
+	def data_processing_shifted(self, hw1, hw2):
+		operand, carry = self.shifted_operand(hw2)
+		op = (hw1 >> 5) & 15
+		if op == 6:	# PKHBT, PKHTB
+			rn = self.reg(hw1 & 15)
+			self.r[(hw2 >> 8) & 15] = (operand & 0xFFFF0000) | (rn & 0xFFFF) if not hw2 & 0x20 else (rn & 0xFFFF0000) | (operand & 0xFFFF)
+			return 1
+		return self.alu(op, hw1, hw2, operand, carry)
+
+	def data_processing_modified(self, hw1, hw2):
+		imm12 = ((hw1 >> 10) & 1) << 11 | ((hw2 >> 12) & 7) << 8 | (hw2 & 0xFF)
+		operand, carry = expand_imm_c(imm12, self.c)
+		return self.alu((hw1 >> 5) & 15, hw1, hw2, operand, carry)
+
+	def alu(self, op, hw1, hw2, operand, carry):
+		rn, rd, setflags = hw1 & 15, (hw2 >> 8) & 15, (hw1 >> 4) & 1
+		a = self.reg(rn)
+		overflow = self.v
+		write = True
+		if op == 0:	# AND, TST
+			result = a & operand
+			write = rd != 15
+		elif op == 1:
+			result = a & ~operand & MASK32
+		elif op == 2:	# ORR, MOV
+			result = operand if rn == 15 else a | operand
+		elif op == 3:	# ORN, MVN
+			result = (~operand if rn == 15 else a | ~operand) & MASK32
+		elif op == 4:	# EOR, TEQ
+			result = a ^ operand
+			write = rd != 15
+		elif op == 8:	# ADD, CMN
+			result, carry, overflow = add_with_carry(a, operand, 0)
+			write = rd != 15
+		elif op == 10:
+			result, carry, overflow = add_with_carry(a, operand, self.c)
+		elif op == 11:
+			result, carry, overflow = add_with_carry(a, ~operand & MASK32, self.c)
+		elif op == 13:	# SUB, CMP
+			result, carry, overflow = add_with_carry(a, ~operand & MASK32, 1)
+			write = rd != 15
+		elif op == 14:
+			result, carry, overflow = add_with_carry(operand, ~a & MASK32, 1)
+		else:
+			raise SimError('unknown data processing op %d at 0x%08x' % (op, self.pc_now))
+		if write:
+			self.set_reg(rd, result)
+		if setflags:
+			self.set_nz(result)
+			self.c, self.v = carry, overflow
+		return 1
+
+	def plain_immediate(self, hw1, hw2):
+		op = (hw1 >> 4) & 31
+		rn, rd = hw1 & 15, (hw2 >> 8) & 15
+		imm12 = ((hw1 >> 10) & 1) << 11 | ((hw2 >> 12) & 7) << 8 | (hw2 & 0xFF)
+		lsb = ((hw2 >> 12) & 7) << 2 | (hw2 >> 6) & 3
+		if op == 0:	# ADDW, ADR
+			base = self.reg(rn) & ~3 if rn == 15 else self.r[rn]
+			self.r[rd] = (base + imm12) & MASK32
+		elif op == 10:	# SUBW, ADR
+			base = self.reg(rn) & ~3 if rn == 15 else self.r[rn]
+			self.r[rd] = (base - imm12) & MASK32
+		elif op == 4:	# MOVW
+			self.r[rd] = rn << 12 | imm12
+		elif op == 12:	# MOVT
+			self.r[rd] = (self.r[rd] & 0xFFFF) | (rn << 12 | imm12) << 16
+		elif op in (20, 28):	# SBFX, UBFX
+			width = (hw2 & 31) + 1
+			field = (self.r[rn] >> lsb) & ((1 << width) - 1)
+			self.r[rd] = sign_extend(field, width) & MASK32 if op == 20 else field
+		elif op == 22:	# BFI, BFC
+			msb = hw2 & 31
+			mask = ((1 << (msb - lsb + 1)) - 1) << lsb
+			value = 0 if rn == 15 else self.r[rn] << lsb
+			self.r[rd] = (self.r[rd] & ~mask | value & mask) & MASK32
+		elif op in (16, 24):	# SSAT, USAT
+			kind, amount = decode_imm_shift((hw1 >> 4) & 2, lsb)
+			value = sign_extend(shift_c(self.r[rn], kind, amount, self.c)[0], 32)
+			bits = hw2 & 31
+			if op == 16:
+				hi, lo = (1 << bits) - 1, -(1 << bits)
+			else:
+				hi, lo = (1 << bits) - 1, 0
+			self.r[rd] = max(lo, min(hi, value)) & MASK32
+		else:
+			raise SimError('unknown instruction %04x %04x at 0x%08x' % (hw1, hw2, self.pc_now))
+		return 1
+
+	def branches(self, hw1, hw2):
+		op = (hw2 >> 12) & 7
+		s = (hw1 >> 10) & 1
+		j1, j2 = (hw2 >> 13) & 1, (hw2 >> 11) & 1
+		if op & 5 == 0:
+			cond = (hw1 >> 6) & 15
+			if cond < 14:	# B<c> T3
+				imm = s << 20 | j2 << 19 | j1 << 18 | (hw1 & 0x3F) << 12 | (hw2 & 0x7FF) << 1
+				self.conditional_branch(cond, self.pc_now + 4 + sign_extend(imm, 21))
+				return 1
+			# MSR, MRS, barriers and hints
+			if hw1 & 0xFFF0 == 0xF3E0:	# MRS
+				self.r[(hw2 >> 8) & 15] = 0
+			return 1 if hw1 & 0xFFF0 != 0xF3B0 else 4
+		i1, i2 = 1 - (j1 ^ s), 1 - (j2 ^ s)
+		imm = s << 24 | i1 << 23 | i2 << 22 | (hw1 & 0x3FF) << 12 | (hw2 & 0x7FF) << 1
+		target = self.pc_now + 4 + sign_extend(imm, 25)
+		if op & 5 == 1:	# B T4
+			self.branch(target)
+			return 1
+		if op & 5 == 5:	# BL
+			self.call(target)
+			return 1
+		raise SimError('unknown instruction %04x %04x at 0x%08x' % (hw1, hw2, self.pc_now))
+
+	def load_store_single(self, hw1, hw2):
+		signed, size_bits, load, rn = (hw1 >> 8) & 1, (hw1 >> 5) & 3, (hw1 >> 4) & 1, hw1 & 15
+		size = 1 << size_bits
+		rt = (hw2 >> 12) & 15
+		if rn == 15:
+			base = (self.pc_now + 4) & ~3
+			addr = base + (hw2 & 0xFFF) if hw1 & 0x80 else base - (hw2 & 0xFFF)
+			writeback = None
+		elif hw1 & 0x80:
+			addr = self.r[rn] + (hw2 & 0xFFF)
+			writeback = None
+		elif hw2 & 0x800:
+			p, u, w = (hw2 >> 10) & 1, (hw2 >> 9) & 1, (hw2 >> 8) & 1
+			offset_addr = (self.r[rn] + (hw2 & 0xFF) if u else self.r[rn] - (hw2 & 0xFF)) & MASK32
+			addr = offset_addr if p else self.r[rn]
+			writeback = offset_addr if w else None
+		elif hw2 & 0xFC0 == 0:
+			addr = self.r[rn] + (self.r[hw2 & 15] << ((hw2 >> 4) & 3))
+			writeback = None
+		else:
+			raise SimError('unknown instruction %04x %04x at 0x%08x' % (hw1, hw2, self.pc_now))
+		addr &= MASK32
+		cost = 2 + self.access_cost(addr)
+		if load:
+			if rt == 15 and size < 4:	# PLD, PLI
+				return 1
+			value = self.load(addr, size)
+			if signed:
+				value = sign_extend(value, 8 * size) & MASK32
+			if rt == 15:
+				if value == RETURN_ADDR:
+					self.returned = True
+				self.branch(value)
+			else:
+				self.r[rt] = value
+		else:
+			self.store(addr, size, self.r[rt])
+		if writeback is not None:
+			self.r[rn] = writeback
+		return cost
+
+	def data_processing_register(self, hw1, hw2):
+		op1, op2 = (hw1 >> 4) & 15, (hw2 >> 4) & 15
+		rn, rd, rm = hw1 & 15, (hw2 >> 8) & 15, hw2 & 15
+		if op1 & 8 == 0 and op2 == 0:	# LSL, LSR, ASR, ROR register
+			result, carry = shift_c(self.r[rn], (op1 >> 1) & 3, self.r[rm] & 0xFF, self.c)
+			self.r[rd] = result
+			if op1 & 1:
+				self.set_nz(result)
+				self.c = carry
+			return 1
+		if op1 & 8 == 0 and op2 & 8:	# extends, with an add if Rn isn't the PC
+			value = ror(self.r[rm], ((hw2 >> 4) & 3) * 8)
+			op = op1 & 7
+			if op in (0, 1):
+				value = sign_extend(value, 16) & MASK32 if op == 0 else value & 0xFFFF
+			elif op in (4, 5):
+				value = sign_extend(value, 8) & MASK32 if op == 4 else value & 0xFF
+			else:
+				raise SimError('unknown extend at 0x%08x' % self.pc_now)
+			self.r[rd] = value if rn == 15 else (self.r[rn] + value) & MASK32
+			return 1
+		if op1 & 0xC == 8 and op2 & 0xC == 8:
+			value = self.r[rm]
+			if op1 == 9 and op2 == 8:
+				self.r[rd] = struct.unpack('<I', struct.pack('>I', value))[0]
+			elif op1 == 9 and op2 == 9:
+				self.r[rd] = ((value & 0x00FF00FF) << 8 | (value >> 8) & 0x00FF00FF) & MASK32
+			elif op1 == 9 and op2 == 10:
+				self.r[rd] = int('{:032b}'.format(value)[::-1], 2)
+			elif op1 == 9 and op2 == 11:
+				self.r[rd] = sign_extend((value & 0xFF) << 8 | (value >> 8) & 0xFF, 16) & MASK32
+			elif op1 == 11 and op2 == 8:
+				self.r[rd] = 32 - value.bit_length()
+			else:
+				raise SimError('unknown instruction %04x %04x at 0x%08x' % (hw1, hw2, self.pc_now))
+			return 1
+		raise SimError('unknown instruction %04x %04x at 0x%08x' % (hw1, hw2, self.pc_now))
+
+	def multiply(self, hw1, hw2):
+		rn, ra, rd, rm = hw1 & 15, (hw2 >> 12) & 15, (hw2 >> 8) & 15, hw2 & 15
+		product = self.r[rn] * self.r[rm]
+		op = (hw2 >> 4) & 3
+		if (hw1 >> 4) & 7 or op > 1:
+			raise SimError('unknown multiply at 0x%08x' % self.pc_now)
+		if op == 1:	# MLS
+			self.r[rd] = (self.r[ra] - product) & MASK32
+		else:
+			self.r[rd] = (product + (0 if ra == 15 else self.r[ra])) & MASK32
+		return 1 if ra == 15 else 2
+
+	def long_multiply(self, hw1, hw2):
+		op1, op2 = (hw1 >> 4) & 7, (hw2 >> 4) & 15
+		rn, lo, hi, rm = hw1 & 15, (hw2 >> 12) & 15, (hw2 >> 8) & 15, hw2 & 15
+		if op2 == 15 and op1 in (1, 3):	# SDIV, UDIV
+			a, b = self.r[rn], self.r[rm]
+			if op1 == 1:
+				a, b = sign_extend(a, 32), sign_extend(b, 32)
+			q = 0 if b == 0 else abs(a) // abs(b) * (1 if (a < 0) == (b < 0) else -1)
+			self.r[hi] = q & MASK32
+			return 12
+		if op2 != 0 or op1 not in (0, 2, 4, 6):
+			raise SimError('unknown long multiply at 0x%08x' % self.pc_now)
+		a, b = self.r[rn], self.r[rm]
+		if op1 in (0, 4):
+			a, b = sign_extend(a, 32), sign_extend(b, 32)
+		result = a * b
+		if op1 in (4, 6):
+			result += self.r[hi] << 32 | self.r[lo]
+		self.r[lo] = result & MASK32
+		self.r[hi] = (result >> 32) & MASK32
+		return 1
+
+
+# ---------------------------------------------------------------------------
+# Running a kernel
+
+class Cycle:
+	"""What a kernel did in one bus cycle"""
+
+	def __init__(self, cpu, addr, end, drive, busy, state):
+		seen = []
+		for pc, outcome, forced in cpu.path:
+			if (pc, outcome) not in seen:
+				seen.append((pc, outcome))
+		self.key = (tuple(seen), end)
+		self.addr = addr
+		self.end = end		# 'waits', 'overrun', 'returns' or 'leaves <function>'
+		self.drive = drive
+		self.busy = busy
+		self.forced = any(forced for pc, outcome, forced in cpu.path)
+		self.forkable = cpu.forkable
+		self.state = state	# the kernel waiting on the next address, if asked for
+
+
+def settle(cpu, since, limit, want_state):
+	"""Runs the kernel until it is waiting on the address pins, that is reading them
+	from one instruction, the same number of steps apart, WAIT_READS times in a row.
+	Returns (how it ended, when it started waiting, the state it waits in)."""
+	steps = 0
+	run_pc, run_gap, run_length = None, None, 0
+	last_read = None	# (step, time, state) of the last read of the pins
+	start = None		# (time, state) of the first read of the run
+	while True:
+		if cpu.returned:
+			if not cpu.polled:
+				return 'returns', None, None
+			cpu.cycles += cpu.polled
+			cpu.enter()
+		n = len(cpu.reads)
+		cpu.step()
+		steps += 1
+		if cpu.left:
+			return 'leaves ' + cpu.left, None, None
+		if len(cpu.reads) > n:
+			time, pc = cpu.reads[-1]
+			state = None
+			if want_state:
+				state = cpu.clone()
+				state.read_time = time
+			if time > since:
+				gap = steps - last_read[0] if last_read else None
+				if pc == run_pc and (run_length == 1 or gap == run_gap):
+					run_length += 1
+				elif pc == run_pc:	# the loop starts at the last read
+					start = last_read[1:]
+					run_length = 2
+				else:
+					start = (time, state)
+					run_length = 1
+				run_pc, run_gap = pc, gap
+				if run_length >= WAIT_READS:
+					return 'waits', start[0], start[1]
+			last_read = (steps, time, state)
+		if cpu.cycles > limit:
+			return 'overrun', None, None
+		if steps > 50000000:
+			raise SimError('stuck at %s' % hex(cpu.pc_now))
+
+
+def start_kernel(elf, name, args, hsi, flash_ws, timing):
+	"""Loads the firmware and runs the kernel until it first waits on the bus"""
+	memory = Memory()
+	elf.load(memory)
+	for symbol, value in KERNEL_MEMORY.get(name, {}).items():
+		if symbol not in elf.symbols:
+			raise SimError('no %s for %s' % (symbol, name))
+		addr, size, kind = elf.symbols[symbol]
+		memory.write(addr, min(size, 4) or 4, value)
+	cpu = Cpu(memory, timing, hsi)
+	for symbol in KERNEL_FIXED.get(name, []):
+		addr, size, kind = elf.symbols[symbol]
+		cpu.fixed.update(range(addr, addr + (size or 4)))
+	if hsi:	# as at reset
+		memory.write(RCC_CR, 4, RCC_CR_HSION)
+	else:	# as SystemInitFinish() leaves it
+		memory.write(RCC_CR, 4, RCC_CR_HSION | RCC_CR_PLLON)
+		memory.write(RCC_CFGR, 4, 2)
+		memory.write(FLASH_ACR, 4, FLASH_ACR_ICEN | FLASH_ACR_DCEN | flash_ws)
+		cpu.pll_on = -PLL_LOCK_US * 168
+	cpu.symbols = {addr: symbol for symbol, (addr, size) in elf.functions().items()}
+	start = elf.functions()[name][0]
+	cpu.entry = (start, [elf.symbols[arg][0] if isinstance(arg, str) else arg for arg in args])
+	cpu.polled = KERNEL_POLLED.get(name, 0)
+	cpu.gap = KERNEL_GAPS.get(name, 1)
+	cpu.console = Console((0x0080, BUS_DATA), (0x0080, BUS_DATA), 0)
+	cpu.enter()
+	end, time, state = settle(cpu, -1, math.inf, True)
+	if end != 'waits':
+		raise SimError('%s before it served the bus' % end)
+	return state
+
+
+def run_cycle(state, addr, period, plan, want_state):
+	"""Puts addr on the bus just after the kernel read the pins, and follows it until it
+	waits on the next address"""
+	cpu = state.clone()
+	cpu.begin_cycle(plan, True)
+	change = state.read_time + 1
+	cpu.console = Console(state.console.after, (addr, BUS_DATA), change)
+	allowed = period
+	if state.console.after[0] & 0x1000 and not addr & 0x1000:
+		allowed *= state.gap
+	end, time, after = settle(cpu, change, change + 4 * allowed, want_state)
+	busy = time - change if end == 'waits' else cpu.cycles - change
+	if end == 'waits' and busy > allowed:
+		end = 'overrun'
+	drive = next((t - change for t in cpu.drives if t >= change), None)
+	return Cycle(cpu, addr, end, drive, busy, after)
+
+
+def search(state, addr, period, first, max_forks, want_state):
+	"""The cycles addr makes with the decisions that don't depend on it forced every way,
+	each new decision after the last one forced, so that every plan is run once"""
+	cycles = []
+	crashed = 0
+	queue = [({}, first)]
+	while queue and len(cycles) + crashed < max_forks:
+		plan, cycle = queue.pop()
+		last = max(plan, default=-1)
+		for index, outcome, others in cycle.forkable:
+			if index <= last:
+				continue
+			for other in others:
+				forced = dict(plan)
+				forced[index] = other
+				try:
+					new = run_cycle(state, addr, period, forced, want_state)
+				except SimError:
+					crashed += 1	# a forced path that can't happen
+					continue
+				cycles.append(new)
+				queue.append((forced, new))
+	return cycles, crashed, bool(queue)
+
+
+class Path:
+	def __init__(self, key):
+		self.key = key
+		self.end = key[1]
+		self.count = 0
+		self.natural = False	# taken without forcing any decision
+		self.drive = None	# worst (cycles, addresses that led to it)
+		self.busy = None
+		self.overruns = 0
+
+	def add(self, cycle, history):
+		self.count += 1
+		self.natural |= not cycle.forced
+		if cycle.end == 'overrun':
+			self.overruns += 1
+		if cycle.drive is not None and (self.drive is None or cycle.drive > self.drive[0]):
+			self.drive = (cycle.drive, history)
+		if cycle.busy is not None and (self.busy is None or cycle.busy > self.busy[0]):
+			self.busy = (cycle.busy, history)
+
+
+def explore(start, period, opts):
+	"""The paths of a kernel from the state it first waits in, see the top of the file"""
+	paths = {}
+	stats = {'runs': 0, 'crashed': 0, 'truncated': 0}
+
+	def record(cycle, history):
+		stats['runs'] += 1
+		path = paths.get(cycle.key)
+		if path is None:
+			path = paths[cycle.key] = Path(cycle.key)
+		path.add(cycle, history)
+
+	states = [(start, ())]
+	explored = set()
+	picks = None
+	for depth in range(opts.depth + 1):
+		deeper = depth < opts.depth
+		following = []
+		for state, history in states:
+			current = state.console.after[0]
+			addresses = range(0x2000) if picks is None else picks
+			groups = {}
+			for addr in addresses:
+				if addr == current:
+					continue
+				cycle = run_cycle(state, addr, period, {}, False)
+				record(cycle, history + (addr,))
+				groups.setdefault(cycle.key[0], []).append(addr)
+			if picks is None:
+				picks = sorted({a for group in groups.values() for a in (group[0], group[-1])})
+			for group in groups.values():
+				for addr in sorted({group[0], group[-1]}):
+					first = run_cycle(state, addr, period, {}, deeper)
+					cycles, crashed, truncated = search(state, addr, period, first, opts.max_forks, deeper)
+					stats['crashed'] += crashed
+					stats['truncated'] += truncated
+					for cycle in cycles:
+						record(cycle, history + (addr,))
+					for cycle in [first] + cycles:
+						if cycle.state and cycle.key not in explored and len(explored) < opts.max_states:
+							explored.add(cycle.key)
+							following.append((cycle.state, history + (addr,)))
+		states = following
+	return paths, stats
+
+
+def describe(elf, key):
+	return ' '.join('%s:%s' % (elf.name_of(pc).split('+')[-1], outcome) for pc, outcome in key[0]) or '-'
+
+
+def history_text(history):
+	return ' '.join('$%04X' % a for a in history)
+
+
+def main():
+	parser = argparse.ArgumentParser(description='Worst-case bus timing of the cartridge kernels.')
+	parser.add_argument('elf')
+	parser.add_argument('-v', '--verbose', action='store_true', help='list every path')
+	parser.add_argument('--depth', type=int, default=1, help='bus cycles to follow the states a kernel is left in')
+	parser.add_argument('--max-forks', type=int, default=256, help='forced runs per state and address')
+	parser.add_argument('--max-states', type=int, default=64, help='states to follow per kernel')
+	parser.add_argument('--budget-2600', type=int, default=CONSOLES['2600'][1], help='latest drive, in 168MHz cycles')
+	parser.add_argument('--budget-7800', type=int, default=CONSOLES['7800'][1])
+	parser.add_argument('--periph-ws', type=int, default=2, help='wait states of a GPIO access')
+	parser.add_argument('--flash-ws', type=int, default=5, help='wait states of a flash access at 168MHz')
+	parser.add_argument('--refill', type=int, default=3, help='cycles to refill the pipeline after a branch')
+	parser.add_argument('--kernel', action='append', help='only check this kernel')
+	opts = parser.parse_args()
+
+	budgets = {'2600': opts.budget_2600, '7800': opts.budget_7800}
+	timing = (opts.periph_ws, opts.refill)
+	try:
+		elf = Elf(opts.elf)
+	except (OSError, SimError) as e:
+		print('kernel_cycles: %s' % e, file=sys.stderr)
+		return 2
+	functions = elf.functions()
+	kernels = sorted(name for name in functions if name.startswith('emulate_') and name not in NOT_KERNELS)
+	kernels += [name for name in MENU_KERNELS if name in functions]
+	if opts.kernel:
+		kernels = [name for name in kernels if name in opts.kernel]
+	if not kernels:
+		print('kernel_cycles: no kernels in %s' % opts.elf, file=sys.stderr)
+		return 2
+
+	failed = False
+	print('%-40s %-7s %-5s %6s %12s %12s  %s' % ('kernel', 'console', 'clock', 'paths', 'drive', 'busy', 'result'))
+	for name in kernels:
+		for variant, args in KERNEL_ARGS.get(name, [('', ())]):
+			label = '%s(%s)' % (name, variant) if variant else name
+			for console in KERNEL_CONSOLES.get(name, ('2600',)):
+				period, budget = CONSOLES[console][0], budgets[console]
+				try:
+					start = start_kernel(elf, name, args, name in KERNEL_HSI, opts.flash_ws, timing)
+					paths, stats = explore(start, period, opts)
+				except SimError as e:
+					print('%-40s %-7s %-5s %s' % (label, console, '', e))
+					failed = True
+					continue
+				clock = 'hsi' if start.scale != 1 else 'pll'
+				timed = [p for p in paths.values() if p.end in ('waits', 'overrun')]
+				drive = max((p.drive for p in timed if p.drive), default=None, key=lambda d: d[0])
+				busy = max((p.busy for p in timed if p.busy), default=None, key=lambda b: b[0])
+				bad = [p for p in timed if p.overruns or (p.drive and p.drive[0] > budget)]
+				if bad:
+					result = 'FAIL: %d path%s over budget' % (len(bad), 's' if len(bad) > 1 else '')
+					failed = True
+				else:
+					result = 'ok'
+				ends = {}
+				for p in paths.values():
+					if p not in timed:
+						ends[p.end] = ends.get(p.end, 0) + 1
+				for end, count in sorted(ends.items()):
+					result += ', %d path%s %s' % (count, 's' if count > 1 else '', end)
+				if stats['crashed']:
+					result += ', %d forced runs crashed' % stats['crashed']
+				if stats['truncated']:
+					result += ', search cut short %d times' % stats['truncated']
+				print('%-40s %-7s %-5s %6d %5s / %-4d %5s / %-4d  %s' % (label, console, clock, len(paths),
+					'%d' % drive[0] if drive else '-', budget, '%d' % busy[0] if busy else '-', period, result))
+				for p in sorted(paths.values(), key=lambda p: -(p.busy[0] if p.busy else 0)):
+					if not (opts.verbose or p in bad):
+						continue
+					print('    %s%5d cycles, drive %s, busy %s, %s%s: %s' % (' ' if p.natural else '*', p.count,
+						'%d after %s' % (p.drive[0], history_text(p.drive[1])) if p.drive else '-',
+						'%d after %s' % (p.busy[0], history_text(p.busy[1])) if p.busy else '-',
+						p.end, ', %d overruns' % p.overruns if p.overruns else '', describe(elf, p.key)))
+	return 1 if failed else 0
+
+
+if __name__ == '__main__':
+	sys.exit(main())